@@ -27,7 +27,9 @@ using namespace cyclone;
 /**
  * Internal function that checks the validity of an inverse inertia tensor.
  */
-static inline void _checkInverseInertiaTensor(const Matrix3 &iitWorld)
+template <class Precision>
+static inline void _checkInverseInertiaTensor(
+    const BasicMatrix3<Precision> &iitWorld)
 {
     // TODO: Perform a validity check in an assert.
 }
@@ -37,11 +39,14 @@ static inline void _checkInverseInertiaTensor(const Matrix3 &iitWorld)
  * Note that the implementation of this function was created by an
  * automated code-generator and optimizer.
  */
-static inline void _transformInertiaTensor(Matrix3 &iitWorld,
-                                           const Quaternion &q,
-                                           const Matrix3 &iitBody,
-                                           const Matrix4 &rotmat)
+template <class Precision>
+static inline void _transformInertiaTensor(BasicMatrix3<Precision> &iitWorld,
+                                           const BasicQuaternion<Precision> &q,
+                                           const BasicMatrix3<Precision> &iitBody,
+                                           const BasicMatrix4<Precision> &rotmat)
 {
+    typedef typename Precision::real real;
+
     real t4 = rotmat.data[0]*iitBody.data[0]+
         rotmat.data[1]*iitBody.data[3]+
         rotmat.data[2]*iitBody.data[6];
@@ -103,9 +108,10 @@ static inline void _transformInertiaTensor(Matrix3 &iitWorld,
  * Inline function that creates a transform matrix from a
  * position and orientation.
  */
-static inline void _calculateTransformMatrix(Matrix4 &transformMatrix,
-                                             const Vector3 &position,
-                                             const Quaternion &orientation)
+template <class Precision>
+static inline void _calculateTransformMatrix(BasicMatrix4<Precision> &transformMatrix,
+                                             const BasicVector3<Precision> &position,
+                                             const BasicQuaternion<Precision> &orientation)
 {
     transformMatrix.data[0] = 1-2*orientation.j*orientation.j-
         2*orientation.k*orientation.k;
@@ -137,23 +143,40 @@ static inline void _calculateTransformMatrix(Matrix4 &transformMatrix,
  * FUNCTIONS DECLARED IN HEADER:
  * --------------------------------------------------------------------------
  */
-void RigidBody::calculateDerivedData()
+template <class Precision>
+void BasicRigidBody<Precision>::calculateDerivedData()
 {
     orientation.normalise();
 
     // Calculate the transform matrix for the body.
     _calculateTransformMatrix(transformMatrix, position, orientation);
 
-    // Calculate the inertiaTensor in world space.
-    _transformInertiaTensor(inverseInertiaTensorWorld,
-        orientation,
-        inverseInertiaTensor,
-        transformMatrix);
+    // Calculate the inertiaTensor in world space. Bodies that are
+    // not dynamic have no inertia to transform.
+    if (bodyType == DYNAMIC_BODY) {
+        _transformInertiaTensor(inverseInertiaTensorWorld,
+            orientation,
+            inverseInertiaTensor,
+            transformMatrix);
+    }
 
 }
 
-void RigidBody::integrate(real duration)
+template <class Precision>
+void BasicRigidBody<Precision>::integrate(real duration, bool clearForces)
 {
+    if (bodyType == STATIC_BODY) return;
+
+    if (bodyType == KINEMATIC_BODY) {
+        // Kinematic bodies follow the velocity they have been given,
+        // whatever forces or contacts would otherwise say.
+        position.addScaledVector(velocity, duration);
+        orientation.addScaledVector(rotation, duration);
+        calculateDerivedData();
+        if (clearForces) clearAccumulators();
+        return;
+    }
+
     if (!isAwake) return;
 
     // Calculate linear acceleration from force inputs.
@@ -172,8 +195,8 @@ void RigidBody::integrate(real duration)
     rotation.addScaledVector(angularAcceleration, duration);
 
     // Impose drag.
-    velocity *= real_pow(linearDamping, duration);
-    rotation *= real_pow(angularDamping, duration);
+    velocity *= Precision::pow(linearDamping, duration);
+    rotation *= Precision::pow(angularDamping, duration);
 
     // Adjust positions
     // Update linear position.
@@ -187,7 +210,7 @@ void RigidBody::integrate(real duration)
     calculateDerivedData();
 
     // Clear accumulators.
-    clearAccumulators();
+    if (clearForces) clearAccumulators();
 
     // Update the kinetic energy store, and possibly put the body to
     // sleep.
@@ -195,7 +218,7 @@ void RigidBody::integrate(real duration)
         real currentMotion = velocity.scalarProduct(velocity) +
             rotation.scalarProduct(rotation);
 
-        real bias = real_pow(0.5, duration);
+        real bias = Precision::pow(0.5, duration);
         motion = bias*motion + (1-bias)*currentMotion;
 
         if (motion < sleepEpsilon) setAwake(false);
@@ -203,148 +226,174 @@ void RigidBody::integrate(real duration)
     }
 }
 
-void RigidBody::setMass(const real mass)
+template <class Precision>
+void BasicRigidBody<Precision>::setMass(const real mass)
 {
     assert(mass != 0);
     RigidBody::inverseMass = ((real)1.0)/mass;
 }
 
-real RigidBody::getMass() const
+template <class Precision>
+typename BasicRigidBody<Precision>::real BasicRigidBody<Precision>::getMass() const
 {
     if (inverseMass == 0) {
-        return REAL_MAX;
+        return Precision::maximum();
     } else {
         return ((real)1.0)/inverseMass;
     }
 }
 
-void RigidBody::setInverseMass(const real inverseMass)
+template <class Precision>
+void BasicRigidBody<Precision>::setInverseMass(const real inverseMass)
 {
     RigidBody::inverseMass = inverseMass;
 }
 
-real RigidBody::getInverseMass() const
+template <class Precision>
+typename BasicRigidBody<Precision>::real BasicRigidBody<Precision>::getInverseMass() const
 {
     return inverseMass;
 }
 
-bool RigidBody::hasFiniteMass() const
+template <class Precision>
+bool BasicRigidBody<Precision>::hasFiniteMass() const
 {
     return inverseMass >= 0.0f;
 }
 
-void RigidBody::setInertiaTensor(const Matrix3 &inertiaTensor)
+template <class Precision>
+void BasicRigidBody<Precision>::setInertiaTensor(const Matrix3 &inertiaTensor)
 {
     inverseInertiaTensor.setInverse(inertiaTensor);
     _checkInverseInertiaTensor(inverseInertiaTensor);
 }
 
-void RigidBody::getInertiaTensor(Matrix3 *inertiaTensor) const
+template <class Precision>
+void BasicRigidBody<Precision>::getInertiaTensor(Matrix3 *inertiaTensor) const
 {
     inertiaTensor->setInverse(inverseInertiaTensor);
 }
 
-Matrix3 RigidBody::getInertiaTensor() const
+template <class Precision>
+typename BasicRigidBody<Precision>::Matrix3 BasicRigidBody<Precision>::getInertiaTensor() const
 {
     Matrix3 it;
     getInertiaTensor(&it);
     return it;
 }
 
-void RigidBody::getInertiaTensorWorld(Matrix3 *inertiaTensor) const
+template <class Precision>
+void BasicRigidBody<Precision>::getInertiaTensorWorld(Matrix3 *inertiaTensor) const
 {
     inertiaTensor->setInverse(inverseInertiaTensorWorld);
 }
 
-Matrix3 RigidBody::getInertiaTensorWorld() const
+template <class Precision>
+typename BasicRigidBody<Precision>::Matrix3 BasicRigidBody<Precision>::getInertiaTensorWorld() const
 {
     Matrix3 it;
     getInertiaTensorWorld(&it);
     return it;
 }
 
-void RigidBody::setInverseInertiaTensor(const Matrix3 &inverseInertiaTensor)
+template <class Precision>
+void BasicRigidBody<Precision>::setInverseInertiaTensor(const Matrix3 &inverseInertiaTensor)
 {
     _checkInverseInertiaTensor(inverseInertiaTensor);
     RigidBody::inverseInertiaTensor = inverseInertiaTensor;
 }
 
-void RigidBody::getInverseInertiaTensor(Matrix3 *inverseInertiaTensor) const
+template <class Precision>
+void BasicRigidBody<Precision>::getInverseInertiaTensor(Matrix3 *inverseInertiaTensor) const
 {
     *inverseInertiaTensor = RigidBody::inverseInertiaTensor;
 }
 
-Matrix3 RigidBody::getInverseInertiaTensor() const
+template <class Precision>
+typename BasicRigidBody<Precision>::Matrix3 BasicRigidBody<Precision>::getInverseInertiaTensor() const
 {
     return inverseInertiaTensor;
 }
 
-void RigidBody::getInverseInertiaTensorWorld(Matrix3 *inverseInertiaTensor) const
+template <class Precision>
+void BasicRigidBody<Precision>::getInverseInertiaTensorWorld(Matrix3 *inverseInertiaTensor) const
 {
     *inverseInertiaTensor = inverseInertiaTensorWorld;
 }
 
-Matrix3 RigidBody::getInverseInertiaTensorWorld() const
+template <class Precision>
+typename BasicRigidBody<Precision>::Matrix3 BasicRigidBody<Precision>::getInverseInertiaTensorWorld() const
 {
     return inverseInertiaTensorWorld;
 }
 
-void RigidBody::setDamping(const real linearDamping,
+template <class Precision>
+void BasicRigidBody<Precision>::setDamping(const real linearDamping,
                const real angularDamping)
 {
     RigidBody::linearDamping = linearDamping;
     RigidBody::angularDamping = angularDamping;
 }
 
-void RigidBody::setLinearDamping(const real linearDamping)
+template <class Precision>
+void BasicRigidBody<Precision>::setLinearDamping(const real linearDamping)
 {
     RigidBody::linearDamping = linearDamping;
 }
 
-real RigidBody::getLinearDamping() const
+template <class Precision>
+typename BasicRigidBody<Precision>::real BasicRigidBody<Precision>::getLinearDamping() const
 {
     return linearDamping;
 }
 
-void RigidBody::setAngularDamping(const real angularDamping)
+template <class Precision>
+void BasicRigidBody<Precision>::setAngularDamping(const real angularDamping)
 {
     RigidBody::angularDamping = angularDamping;
 }
 
-real RigidBody::getAngularDamping() const
+template <class Precision>
+typename BasicRigidBody<Precision>::real BasicRigidBody<Precision>::getAngularDamping() const
 {
     return angularDamping;
 }
 
-void RigidBody::setPosition(const Vector3 &position)
+template <class Precision>
+void BasicRigidBody<Precision>::setPosition(const Vector3 &position)
 {
     RigidBody::position = position;
 }
 
-void RigidBody::setPosition(const real x, const real y, const real z)
+template <class Precision>
+void BasicRigidBody<Precision>::setPosition(const real x, const real y, const real z)
 {
     position.x = x;
     position.y = y;
     position.z = z;
 }
 
-void RigidBody::getPosition(Vector3 *position) const
+template <class Precision>
+void BasicRigidBody<Precision>::getPosition(Vector3 *position) const
 {
     *position = RigidBody::position;
 }
 
-Vector3 RigidBody::getPosition() const
+template <class Precision>
+typename BasicRigidBody<Precision>::Vector3 BasicRigidBody<Precision>::getPosition() const
 {
     return position;
 }
 
-void RigidBody::setOrientation(const Quaternion &orientation)
+template <class Precision>
+void BasicRigidBody<Precision>::setOrientation(const Quaternion &orientation)
 {
     RigidBody::orientation = orientation;
     RigidBody::orientation.normalise();
 }
 
-void RigidBody::setOrientation(const real r, const real i,
+template <class Precision>
+void BasicRigidBody<Precision>::setOrientation(const real r, const real i,
                    const real j, const real k)
 {
     orientation.r = r;
@@ -354,22 +403,26 @@ void RigidBody::setOrientation(const real r, const real i,
     orientation.normalise();
 }
 
-void RigidBody::getOrientation(Quaternion *orientation) const
+template <class Precision>
+void BasicRigidBody<Precision>::getOrientation(Quaternion *orientation) const
 {
     *orientation = RigidBody::orientation;
 }
 
-Quaternion RigidBody::getOrientation() const
+template <class Precision>
+typename BasicRigidBody<Precision>::Quaternion BasicRigidBody<Precision>::getOrientation() const
 {
     return orientation;
 }
 
-void RigidBody::getOrientation(Matrix3 *matrix) const
+template <class Precision>
+void BasicRigidBody<Precision>::getOrientation(Matrix3 *matrix) const
 {
     getOrientation(matrix->data);
 }
 
-void RigidBody::getOrientation(real matrix[9]) const
+template <class Precision>
+void BasicRigidBody<Precision>::getOrientation(real matrix[9]) const
 {
     matrix[0] = transformMatrix.data[0];
     matrix[1] = transformMatrix.data[1];
@@ -384,19 +437,22 @@ void RigidBody::getOrientation(real matrix[9]) const
     matrix[8] = transformMatrix.data[10];
 }
 
-void RigidBody::getTransform(Matrix4 *transform) const
+template <class Precision>
+void BasicRigidBody<Precision>::getTransform(Matrix4 *transform) const
 {
     memcpy(transform, &transformMatrix.data, sizeof(Matrix4));
 }
 
-void RigidBody::getTransform(real matrix[16]) const
+template <class Precision>
+void BasicRigidBody<Precision>::getTransform(real matrix[16]) const
 {
     memcpy(matrix, transformMatrix.data, sizeof(real)*12);
     matrix[12] = matrix[13] = matrix[14] = 0;
     matrix[15] = 1;
 }
 
-void RigidBody::getGLTransform(float matrix[16]) const
+template <class Precision>
+void BasicRigidBody<Precision>::getGLTransform(float matrix[16]) const
 {
     matrix[0] = (float)transformMatrix.data[0];
     matrix[1] = (float)transformMatrix.data[4];
@@ -419,89 +475,132 @@ void RigidBody::getGLTransform(float matrix[16]) const
     matrix[15] = 1;
 }
 
-Matrix4 RigidBody::getTransform() const
+template <class Precision>
+typename BasicRigidBody<Precision>::Matrix4 BasicRigidBody<Precision>::getTransform() const
 {
     return transformMatrix;
 }
 
 
-Vector3 RigidBody::getPointInLocalSpace(const Vector3 &point) const
+template <class Precision>
+typename BasicRigidBody<Precision>::Vector3 BasicRigidBody<Precision>::getPointInLocalSpace(const Vector3 &point) const
 {
     return transformMatrix.transformInverse(point);
 }
 
-Vector3 RigidBody::getPointInWorldSpace(const Vector3 &point) const
+template <class Precision>
+typename BasicRigidBody<Precision>::Vector3 BasicRigidBody<Precision>::getPointInWorldSpace(const Vector3 &point) const
 {
     return transformMatrix.transform(point);
 }
 
-Vector3 RigidBody::getDirectionInLocalSpace(const Vector3 &direction) const
+template <class Precision>
+typename BasicRigidBody<Precision>::Vector3 BasicRigidBody<Precision>::getDirectionInLocalSpace(const Vector3 &direction) const
 {
     return transformMatrix.transformInverseDirection(direction);
 }
 
-Vector3 RigidBody::getDirectionInWorldSpace(const Vector3 &direction) const
+template <class Precision>
+typename BasicRigidBody<Precision>::Vector3 BasicRigidBody<Precision>::getDirectionInWorldSpace(const Vector3 &direction) const
 {
     return transformMatrix.transformDirection(direction);
 }
 
 
-void RigidBody::setVelocity(const Vector3 &velocity)
+template <class Precision>
+void BasicRigidBody<Precision>::setVelocity(const Vector3 &velocity)
 {
     RigidBody::velocity = velocity;
 }
 
-void RigidBody::setVelocity(const real x, const real y, const real z)
+template <class Precision>
+void BasicRigidBody<Precision>::setVelocity(const real x, const real y, const real z)
 {
     velocity.x = x;
     velocity.y = y;
     velocity.z = z;
 }
 
-void RigidBody::getVelocity(Vector3 *velocity) const
+template <class Precision>
+void BasicRigidBody<Precision>::getVelocity(Vector3 *velocity) const
 {
     *velocity = RigidBody::velocity;
 }
 
-Vector3 RigidBody::getVelocity() const
+template <class Precision>
+typename BasicRigidBody<Precision>::Vector3 BasicRigidBody<Precision>::getVelocity() const
 {
     return velocity;
 }
 
-void RigidBody::addVelocity(const Vector3 &deltaVelocity)
+template <class Precision>
+void BasicRigidBody<Precision>::addVelocity(const Vector3 &deltaVelocity)
 {
     velocity += deltaVelocity;
 }
 
-void RigidBody::setRotation(const Vector3 &rotation)
+template <class Precision>
+void BasicRigidBody<Precision>::setRotation(const Vector3 &rotation)
 {
     RigidBody::rotation = rotation;
 }
 
-void RigidBody::setRotation(const real x, const real y, const real z)
+template <class Precision>
+void BasicRigidBody<Precision>::setRotation(const real x, const real y, const real z)
 {
     rotation.x = x;
     rotation.y = y;
     rotation.z = z;
 }
 
-void RigidBody::getRotation(Vector3 *rotation) const
+template <class Precision>
+void BasicRigidBody<Precision>::getRotation(Vector3 *rotation) const
 {
     *rotation = RigidBody::rotation;
 }
 
-Vector3 RigidBody::getRotation() const
+template <class Precision>
+typename BasicRigidBody<Precision>::Vector3 BasicRigidBody<Precision>::getRotation() const
 {
     return rotation;
 }
 
-void RigidBody::addRotation(const Vector3 &deltaRotation)
+template <class Precision>
+void BasicRigidBody<Precision>::addRotation(const Vector3 &deltaRotation)
 {
     rotation += deltaRotation;
 }
 
-void RigidBody::setAwake(const bool awake)
+template <class Precision>
+void BasicRigidBody<Precision>::setBodyType(const BodyType type)
 {
+    bodyType = type;
+    if (type == DYNAMIC_BODY) return;
+
+    // Non-dynamic bodies behave as if they had infinite mass in
+    // every contact they take part in.
+    inverseMass = 0;
+    inverseInertiaTensor = Matrix3();
+    inverseInertiaTensorWorld = Matrix3();
+    lastFrameAcceleration.clear();
+    clearAccumulators();
+
+    if (type == STATIC_BODY) {
+        isAwake = false;
+        canSleep = true;
+        velocity.clear();
+        rotation.clear();
+    } else {
+        isAwake = true;
+        canSleep = false;
+    }
+}
+
+template <class Precision>
+void BasicRigidBody<Precision>::setAwake(const bool awake)
+{
+    if (bodyType != DYNAMIC_BODY) return;
+
     if (awake) {
         isAwake= true;
 
@@ -514,37 +613,47 @@ void RigidBody::setAwake(const bool awake)
     }
 }
 
-void RigidBody::setCanSleep(const bool canSleep)
+template <class Precision>
+void BasicRigidBody<Precision>::setCanSleep(const bool canSleep)
 {
+    if (bodyType != DYNAMIC_BODY) return;
+
     RigidBody::canSleep = canSleep;
 
     if (!canSleep && !isAwake) setAwake();
 }
 
 
-void RigidBody::getLastFrameAcceleration(Vector3 *acceleration) const
+template <class Precision>
+void BasicRigidBody<Precision>::getLastFrameAcceleration(Vector3 *acceleration) const
 {
     *acceleration = lastFrameAcceleration;
 }
 
-Vector3 RigidBody::getLastFrameAcceleration() const
+template <class Precision>
+typename BasicRigidBody<Precision>::Vector3 BasicRigidBody<Precision>::getLastFrameAcceleration() const
 {
     return lastFrameAcceleration;
 }
 
-void RigidBody::clearAccumulators()
+template <class Precision>
+void BasicRigidBody<Precision>::clearAccumulators()
 {
     forceAccum.clear();
     torqueAccum.clear();
 }
 
-void RigidBody::addForce(const Vector3 &force)
+template <class Precision>
+void BasicRigidBody<Precision>::addForce(const Vector3 &force)
 {
+    if (bodyType != DYNAMIC_BODY) return;
+
     forceAccum += force;
     isAwake = true;
 }
 
-void RigidBody::addForceAtBodyPoint(const Vector3 &force,
+template <class Precision>
+void BasicRigidBody<Precision>::addForceAtBodyPoint(const Vector3 &force,
                                     const Vector3 &point)
 {
     // Convert to coordinates relative to center of mass.
@@ -553,9 +662,12 @@ void RigidBody::addForceAtBodyPoint(const Vector3 &force,
 
 }
 
-void RigidBody::addForceAtPoint(const Vector3 &force,
+template <class Precision>
+void BasicRigidBody<Precision>::addForceAtPoint(const Vector3 &force,
                                 const Vector3 &point)
 {
+    if (bodyType != DYNAMIC_BODY) return;
+
     // Convert to coordinates relative to center of mass.
     Vector3 pt = point;
     pt -= position;
@@ -566,31 +678,44 @@ void RigidBody::addForceAtPoint(const Vector3 &force,
     isAwake = true;
 }
 
-void RigidBody::addTorque(const Vector3 &torque)
+template <class Precision>
+void BasicRigidBody<Precision>::addTorque(const Vector3 &torque)
 {
+    if (bodyType != DYNAMIC_BODY) return;
+
     std::cout << "Adding torque: " << torque.x << ", " << torque.y << ", " << torque.z << std::endl;
     torqueAccum += torque;
     isAwake = true;
 }
 
-void RigidBody::setAcceleration(const Vector3 &acceleration)
+template <class Precision>
+void BasicRigidBody<Precision>::setAcceleration(const Vector3 &acceleration)
 {
     RigidBody::acceleration = acceleration;
 }
 
-void RigidBody::setAcceleration(const real x, const real y, const real z)
+template <class Precision>
+void BasicRigidBody<Precision>::setAcceleration(const real x, const real y, const real z)
 {
     acceleration.x = x;
     acceleration.y = y;
     acceleration.z = z;
 }
 
-void RigidBody::getAcceleration(Vector3 *acceleration) const
+template <class Precision>
+void BasicRigidBody<Precision>::getAcceleration(Vector3 *acceleration) const
 {
     *acceleration = RigidBody::acceleration;
 }
 
-Vector3 RigidBody::getAcceleration() const
+template <class Precision>
+typename BasicRigidBody<Precision>::Vector3 BasicRigidBody<Precision>::getAcceleration() const
 {
     return acceleration;
 }
+
+/*
+ * Rigid bodies are compiled here at both precisions.
+ */
+template class cyclone::BasicRigidBody<SinglePrecision>;
+template class cyclone::BasicRigidBody<DoublePrecision>;
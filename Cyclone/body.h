@@ -38,13 +38,45 @@ namespace cyclone {
      * functions, so should take up exactly 64 words in memory. Of
      * this total 15 words are padding, distributed among the
      * Vector3 data members.
+     *
+     * The body is a template on a precision policy, as the core
+     * types are, so bodies at single and double precision can be
+     * simulated side by side. RigidBody is the body at the default
+     * precision, and is the one the rest of Cyclone works with.
      */
-    class RigidBody
+    template <class Precision>
+    class BasicRigidBody
     {
     public:
+        typedef typename Precision::real real;
+        typedef BasicVector3<Precision> Vector3;
+        typedef BasicQuaternion<Precision> Quaternion;
+        typedef BasicMatrix3<Precision> Matrix3;
+        typedef BasicMatrix4<Precision> Matrix4;
+        typedef BasicRigidBody RigidBody;
 
         // ... Other RigidBody code as before ...
 
+        /**
+         * The ways in which a rigid body can take part in the
+         * simulation.
+         *
+         * Dynamic bodies are fully simulated: they respond to forces
+         * and to contacts. Kinematic bodies are moved by the
+         * application through their velocity and rotation only; they
+         * push dynamic bodies around but are never pushed back.
+         * Static bodies never move at all. Neither kinematic nor
+         * static bodies are integrated in the usual way, and the
+         * contact resolver treats both as having infinite mass.
+         * Bodies are dynamic unless set otherwise.
+         */
+        enum BodyType
+        {
+            DYNAMIC_BODY = 0,
+            KINEMATIC_BODY,
+            STATIC_BODY
+        };
+
 
     protected:
         /**
@@ -195,6 +227,13 @@ namespace cyclone {
          */
         Matrix4 transformMatrix;
 
+        /**
+         * Holds the way this body takes part in the simulation.
+         *
+         * @see BodyType
+         */
+        BodyType bodyType = DYNAMIC_BODY;
+
         /*@}*/
 
 
@@ -278,8 +317,18 @@ namespace cyclone {
          * This function uses a Newton-Euler integration method, which is a
          * linear approximation to the correct integral. For this reason it
          * may be inaccurate in some cases.
+         *
+         * Static bodies are left untouched. Kinematic bodies are simply
+         * moved by their current velocity and rotation: no forces,
+         * damping or sleeping are applied to them.
+         *
+         * @param duration The time to integrate over.
+         *
+         * @param clearForces Set this to false to keep the accumulated
+         * forces and torques, so that a step can be split into several
+         * sub-steps that all feel the same forces.
          */
-        void integrate(real duration);
+        void integrate(real duration, bool clearForces = true);
 
         /*@}*/
 
@@ -792,6 +841,36 @@ namespace cyclone {
          */
         void addRotation(const Vector3 &deltaRotation);
 
+        /**
+         * Sets the way in which the body takes part in the
+         * simulation. Making a body static or kinematic gives it
+         * infinite mass and inertia, and clears any accumulated
+         * forces. Static bodies are put to sleep and kinematic
+         * bodies are kept awake. Switching a body back to dynamic
+         * does not restore its mass: set it again afterwards.
+         *
+         * @param type The new type of the body.
+         */
+        void setBodyType(const BodyType type);
+
+        /**
+         * Returns the way in which the body takes part in the
+         * simulation.
+         */
+        BodyType getBodyType() const
+        {
+            return bodyType;
+        }
+
+        /**
+         * Returns true if the body is fully simulated, i.e. it is
+         * neither static nor kinematic.
+         */
+        bool isDynamic() const
+        {
+            return bodyType == DYNAMIC_BODY;
+        }
+
         /**
          * Returns true if the body is awake and responding to
          * integration.
@@ -807,7 +886,8 @@ namespace cyclone {
          * Sets the awake state of the body. If the body is set to be
          * not awake, then its velocities are also cancelled, since
          * a moving body that is not awake can cause problems in the
-         * simulation.
+         * simulation. Static and kinematic bodies ignore this: the
+         * former are always asleep and the latter always awake.
          *
          * @param awake The new awake state of the body.
          */
@@ -973,6 +1053,8 @@ namespace cyclone {
 
     };
 
+    typedef BasicRigidBody<DefaultPrecision> RigidBody;
+
 } // namespace cyclone
 
 #endif // CYCLONE_BODY_H
@@ -0,0 +1,275 @@
+/*
+ * Implementation file for the bounding volume tree broadphase.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+#include <broadphase.h>
+#include <algorithm>
+
+using namespace cyclone;
+
+/**
+ * The largest number of objects held in a single leaf of the tree.
+ */
+static const unsigned MAX_LEAF_SIZE = 4;
+
+/**
+ * The deepest tree that can be queried. Splitting at the median keeps
+ * the depth at log2 of the number of objects, so this is never reached.
+ */
+static const unsigned MAX_DEPTH = 64;
+
+AABB AABB::fromBox(const CollisionBox &box)
+{
+    return fromBox(box.getTransform(), box.halfSize);
+}
+
+AABB AABB::fromBox(const Matrix4 &transform, const Vector3 &halfSize)
+{
+    Vector3 centre = transform.getAxisVector(3);
+
+    // Each world axis extent is the half-size projected onto it.
+    Vector3 extent;
+    extent.x = real_abs(transform.data[0]) * halfSize.x +
+        real_abs(transform.data[1]) * halfSize.y +
+        real_abs(transform.data[2]) * halfSize.z;
+    extent.y = real_abs(transform.data[4]) * halfSize.x +
+        real_abs(transform.data[5]) * halfSize.y +
+        real_abs(transform.data[6]) * halfSize.z;
+    extent.z = real_abs(transform.data[8]) * halfSize.x +
+        real_abs(transform.data[9]) * halfSize.y +
+        real_abs(transform.data[10]) * halfSize.z;
+
+    return AABB(centre - extent, centre + extent);
+}
+
+AABB AABB::fromSphere(const Vector3 &centre, real radius)
+{
+    Vector3 extent(radius, radius, radius);
+    return AABB(centre - extent, centre + extent);
+}
+
+void AABB::enclose(const AABB &other)
+{
+    if (other.min.x < min.x) min.x = other.min.x;
+    if (other.min.y < min.y) min.y = other.min.y;
+    if (other.min.z < min.z) min.z = other.min.z;
+    if (other.max.x > max.x) max.x = other.max.x;
+    if (other.max.y > max.y) max.y = other.max.y;
+    if (other.max.z > max.z) max.z = other.max.z;
+}
+
+bool AABB::intersectsRay(const Vector3 &origin,
+                         const Vector3 &inverseDirection,
+                         real maxDistance, real *entry) const
+{
+    real nearest = 0;
+    real farthest = maxDistance;
+    for (unsigned i = 0; i < 3; i++)
+    {
+        real t1 = (min[i] - origin[i]) * inverseDirection[i];
+        real t2 = (max[i] - origin[i]) * inverseDirection[i];
+        if (t1 > t2) std::swap(t1, t2);
+        if (t1 > nearest) nearest = t1;
+        if (t2 < farthest) farthest = t2;
+        if (nearest > farthest) return false;
+    }
+    *entry = nearest;
+    return true;
+}
+
+void AABBTree::clear()
+{
+    items.clear();
+    nodes.clear();
+}
+
+void AABBTree::insert(const AABB &volume, unsigned id)
+{
+    Item item;
+    item.volume = volume;
+    item.centre = volume.getCentre();
+    item.id = id;
+    items.push_back(item);
+}
+
+void AABBTree::build()
+{
+    nodes.clear();
+    if (items.empty()) return;
+
+    // A binary tree with n leaves has fewer than 2n nodes.
+    nodes.reserve(2 * (items.size() / MAX_LEAF_SIZE + 1));
+    buildNode(0, (unsigned)items.size());
+}
+
+unsigned AABBTree::buildNode(unsigned first, unsigned count)
+{
+    unsigned index = (unsigned)nodes.size();
+    nodes.push_back(Node());
+
+    // Work out the bounds of the items, and of their centres.
+    AABB volume, centres;
+    for (unsigned i = first; i < first + count; i++)
+    {
+        volume.enclose(items[i].volume);
+        centres.enclose(AABB(items[i].centre, items[i].centre));
+    }
+    nodes[index].volume = volume;
+
+    if (count <= MAX_LEAF_SIZE)
+    {
+        nodes[index].first = first;
+        nodes[index].count = count;
+        nodes[index].secondChild = 0;
+        return index;
+    }
+
+    // Split at the median centre along the longest axis.
+    Vector3 spread = centres.max - centres.min;
+    unsigned axis = 0;
+    if (spread.y > spread.x) axis = 1;
+    if (spread.z > spread[axis]) axis = 2;
+
+    unsigned half = count / 2;
+    std::nth_element(
+        items.begin() + first,
+        items.begin() + first + half,
+        items.begin() + first + count,
+        [axis](const Item &a, const Item &b) {
+            return a.centre[axis] < b.centre[axis];
+        });
+
+    // The child calls may reallocate the node array, so we
+    // don't hold a reference across them.
+    unsigned firstChild = buildNode(first, half);
+    unsigned secondChild = buildNode(first + half, count - half);
+    nodes[index].first = firstChild;
+    nodes[index].count = 0;
+    nodes[index].secondChild = secondChild;
+    return index;
+}
+
+unsigned AABBTree::query(const AABB &volume,
+                         std::vector<unsigned> &results) const
+{
+    if (nodes.empty()) return 0;
+
+    unsigned found = 0;
+    unsigned stack[MAX_DEPTH];
+    unsigned top = 0;
+    stack[top++] = 0;
+
+    while (top > 0)
+    {
+        const Node &node = nodes[stack[--top]];
+        if (!node.volume.overlaps(volume)) continue;
+
+        if (node.count > 0)
+        {
+            for (unsigned i = node.first; i < node.first + node.count; i++)
+            {
+                if (items[i].volume.overlaps(volume))
+                {
+                    results.push_back(items[i].id);
+                    found++;
+                }
+            }
+        }
+        else
+        {
+            stack[top++] = node.secondChild;
+            stack[top++] = node.first;
+        }
+    }
+    return found;
+}
+
+bool AABBTree::raycast(const Vector3 &origin, const Vector3 &direction,
+                       real maxDistance, const RayTest &test,
+                       unsigned *id, real *distance) const
+{
+    if (nodes.empty()) return false;
+
+    // A ray parallel to an axis never crosses that axis' slabs, so
+    // use the largest finite inverse rather than dividing by zero.
+    Vector3 inverse;
+    for (unsigned i = 0; i < 3; i++)
+    {
+        inverse[i] = direction[i] != 0 ? ((real)1.0) / direction[i] : REAL_MAX;
+    }
+
+    bool found = false;
+    real nearest = maxDistance;
+
+    unsigned stack[MAX_DEPTH];
+    real stackEntry[MAX_DEPTH];
+    unsigned top = 0;
+
+    real entry;
+    if (!nodes[0].volume.intersectsRay(origin, inverse, nearest, &entry))
+    {
+        return false;
+    }
+    stack[top] = 0;
+    stackEntry[top++] = entry;
+
+    while (top > 0)
+    {
+        top--;
+        if (stackEntry[top] > nearest) continue;
+        const Node &node = nodes[stack[top]];
+
+        if (node.count > 0)
+        {
+            for (unsigned i = node.first; i < node.first + node.count; i++)
+            {
+                if (!items[i].volume.intersectsRay(origin, inverse, nearest, &entry))
+                {
+                    continue;
+                }
+                real hit = test(items[i].id);
+                if (hit >= 0 && hit <= nearest)
+                {
+                    nearest = hit;
+                    *id = items[i].id;
+                    found = true;
+                }
+            }
+            continue;
+        }
+
+        // Push the farther child first, so the nearer one is walked
+        // first and gives the best chance of skipping the other.
+        unsigned children[2] = { node.first, node.secondChild };
+        real entries[2];
+        bool hits[2];
+        for (unsigned c = 0; c < 2; c++)
+        {
+            hits[c] = nodes[children[c]].volume.intersectsRay(
+                origin, inverse, nearest, &entries[c]);
+        }
+        unsigned nearer = (hits[1] && (!hits[0] || entries[1] < entries[0])) ? 1 : 0;
+        unsigned farther = 1 - nearer;
+        if (hits[farther])
+        {
+            stack[top] = children[farther];
+            stackEntry[top++] = entries[farther];
+        }
+        if (hits[nearer])
+        {
+            stack[top] = children[nearer];
+            stackEntry[top++] = entries[nearer];
+        }
+    }
+
+    if (found) *distance = nearest;
+    return found;
+}
@@ -0,0 +1,235 @@
+/*
+ * Interface file for the bounding volume tree broadphase.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+/**
+ * @file
+ *
+ * This file contains a flat, array based bounding volume tree used to
+ * find the pairs of objects that might be in contact. Unlike the
+ * BVHNode hierarchy in collide_coarse.h, the tree is not updated one
+ * insertion at a time: its leaves are collected and the whole tree is
+ * built in one pass. This suits both sets of objects that hardly ever
+ * change (static level geometry, which is built once) and sets where
+ * every object moves each frame (which are rebuilt each frame).
+ */
+#ifndef CYCLONE_BROADPHASE_H
+#define CYCLONE_BROADPHASE_H
+
+#include <functional>
+#include <vector>
+#include "collide_fine.h"
+
+namespace cyclone {
+
+    /**
+     * An axis aligned bounding box, given by its minimum and maximum
+     * corners.
+     */
+    struct AABB
+    {
+        Vector3 min;
+        Vector3 max;
+
+        /**
+         * Creates a bounding box that encloses nothing.
+         */
+        AABB()
+            : min(REAL_MAX, REAL_MAX, REAL_MAX),
+              max(-REAL_MAX, -REAL_MAX, -REAL_MAX)
+        {}
+
+        /**
+         * Creates a bounding box with the given corners.
+         */
+        AABB(const Vector3 &min, const Vector3 &max)
+            : min(min), max(max)
+        {}
+
+        /**
+         * Creates the tightest bounding box around the given
+         * collision box. The box's internals must be up to date.
+         */
+        static AABB fromBox(const CollisionBox &box);
+
+        /**
+         * Creates the tightest bounding box around a box with the
+         * given transform and half-sizes.
+         */
+        static AABB fromBox(const Matrix4 &transform,
+                            const Vector3 &halfSize);
+
+        /**
+         * Creates a bounding box around a sphere.
+         */
+        static AABB fromSphere(const Vector3 &centre, real radius);
+
+        /**
+         * Checks if the bounding boxes overlap.
+         */
+        bool overlaps(const AABB &other) const
+        {
+            return min.x <= other.max.x && max.x >= other.min.x &&
+                min.y <= other.max.y && max.y >= other.min.y &&
+                min.z <= other.max.z && max.z >= other.min.z;
+        }
+
+        /**
+         * Grows this bounding box so that it also encloses the
+         * given one.
+         */
+        void enclose(const AABB &other);
+
+        /**
+         * Checks if the ray from the given origin crosses the box
+         * before the given distance. The ray is given by the inverse
+         * of each component of its direction, and distances are in
+         * units of the direction's length. If it does, the distance
+         * at which the ray enters the box (zero if it starts inside)
+         * is written to entry.
+         */
+        bool intersectsRay(const Vector3 &origin,
+                           const Vector3 &inverseDirection,
+                           real maxDistance, real *entry) const;
+
+        /**
+         * Returns the point at the centre of the box.
+         */
+        Vector3 getCentre() const
+        {
+            return (min + max) * ((real)0.5);
+        }
+    };
+
+    /**
+     * A static bounding volume tree over a set of objects, each given
+     * by its bounding box and an integer id chosen by the caller
+     * (normally its index in the caller's own array).
+     *
+     * Objects are added with insert and the tree is then made with
+     * build. After that it can be queried as many times as needed.
+     * Changing the set of objects means clearing it and building it
+     * again, which is O(n log n).
+     */
+    class AABBTree
+    {
+    public:
+        /**
+         * Removes every object from the tree.
+         */
+        void clear();
+
+        /**
+         * Adds an object to the set the tree will be built over. The
+         * object will not be found by queries until build is called.
+         */
+        void insert(const AABB &volume, unsigned id);
+
+        /**
+         * Builds the tree over the objects that have been inserted.
+         */
+        void build();
+
+        /**
+         * Returns the number of objects in the tree.
+         */
+        unsigned getSize() const
+        {
+            return (unsigned)items.size();
+        }
+
+        /**
+         * Returns the bounding box of the whole tree.
+         */
+        AABB getBounds() const
+        {
+            return nodes.empty() ? AABB() : nodes[0].volume;
+        }
+
+        /**
+         * Appends to the given list the id of every object whose
+         * bounding box overlaps the given one, and returns how many
+         * were found.
+         */
+        unsigned query(const AABB &volume,
+                       std::vector<unsigned> &results) const;
+
+        /**
+         * Tests one object against a ray, returning the distance
+         * along the ray at which it is hit, or a negative number if
+         * the ray misses it.
+         */
+        typedef std::function<real(unsigned id)> RayTest;
+
+        /**
+         * Finds the nearest object hit by the ray from the given
+         * origin along the given direction, no further than the
+         * given distance. Distances are in units of the direction's
+         * length.
+         *
+         * The tree only knows the objects' bounding boxes, so each
+         * object whose box the ray crosses is handed to the given
+         * test, which checks the object's real shape. Nearer parts of
+         * the tree are walked first, and boxes beyond the nearest hit
+         * so far are skipped without being tested.
+         *
+         * Returns true if anything was hit, writing the id of the
+         * nearest object and its distance.
+         */
+        bool raycast(const Vector3 &origin, const Vector3 &direction,
+                     real maxDistance, const RayTest &test,
+                     unsigned *id, real *distance) const;
+
+    protected:
+        /**
+         * Holds one object in the tree.
+         */
+        struct Item
+        {
+            AABB volume;
+            Vector3 centre;
+            unsigned id;
+        };
+
+        /**
+         * Holds one node of the tree. Leaves point at a run of items,
+         * other nodes at their first child: the second child always
+         * follows the first child's subtree in the node array.
+         */
+        struct Node
+        {
+            AABB volume;
+            unsigned first;
+            unsigned count;
+            unsigned secondChild;
+        };
+
+        /**
+         * The objects in the tree, ordered so that each leaf holds a
+         * contiguous run of them.
+         */
+        std::vector<Item> items;
+
+        /**
+         * The nodes of the tree, with the root first.
+         */
+        std::vector<Node> nodes;
+
+        /**
+         * Builds the subtree over the given run of items, returning
+         * the index of its root node.
+         */
+        unsigned buildNode(unsigned first, unsigned count);
+    };
+
+} // namespace cyclone
+
+#endif // CYCLONE_BROADPHASE_H
@@ -0,0 +1,114 @@
+/*
+ * Implementation file for the continuous collision detection system.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+#include <collide_continuous.h>
+
+using namespace cyclone;
+
+/**
+ * Returns the smallest of the half-sizes of the box.
+ */
+static inline real smallestHalfSize(const CollisionBox &box)
+{
+    real size = box.halfSize.x;
+    if (box.halfSize.y < size) size = box.halfSize.y;
+    if (box.halfSize.z < size) size = box.halfSize.z;
+    return size;
+}
+
+/**
+ * Returns an upper bound on the speed of any point of the box: the
+ * linear speed plus the fastest the rotation can move a corner.
+ */
+static inline real speedBound(const CollisionBox &box)
+{
+    return box.body->getVelocity().magnitude() +
+        box.body->getRotation().magnitude() * box.halfSize.magnitude();
+}
+
+bool ContinuousDetector::needsSweep(const CollisionBox &box, real duration)
+{
+    return box.body->getVelocity().magnitude() * duration >
+        smallestHalfSize(box);
+}
+
+real ContinuousDetector::getSafeStep(const CollisionBox &box)
+{
+    real speed = speedBound(box);
+    if (speed <= 0) return REAL_MAX;
+    return smallestHalfSize(box) / speed;
+}
+
+real ContinuousDetector::boxAndHalfSpace(
+    const CollisionBox &box,
+    const CollisionPlane &plane,
+    real duration,
+    real depth
+    )
+{
+    // Work out how far the deepest corner is above the plane.
+    real projectedRadius =
+        box.halfSize.x * real_abs(plane.direction * box.getAxis(0)) +
+        box.halfSize.y * real_abs(plane.direction * box.getAxis(1)) +
+        box.halfSize.z * real_abs(plane.direction * box.getAxis(2));
+    real distance = plane.direction * box.getAxis(3) -
+        projectedRadius - plane.offset + depth;
+    if (distance <= 0) return 0;
+
+    // The corner can approach no faster than the centre does, plus
+    // however fast the rotation can swing a corner round.
+    real closingSpeed = -(plane.direction * box.body->getVelocity()) +
+        box.body->getRotation().magnitude() * box.halfSize.magnitude();
+    if (closingSpeed * duration <= distance) return duration;
+
+    return distance / closingSpeed;
+}
+
+real ContinuousDetector::boxAndStatic(
+    const CollisionBox &box,
+    const AABB &other,
+    real duration
+    )
+{
+    AABB volume = AABB::fromBox(box);
+    if (volume.overlaps(other)) return 0;
+
+    // Sweep the moving box's bounds along its velocity, one slab
+    // at a time.
+    Vector3 velocity = box.body->getVelocity();
+    real enter = 0;
+    real exit = duration;
+    for (unsigned i = 0; i < 3; i++)
+    {
+        if (velocity[i] == 0)
+        {
+            // Not moving on this axis: they must already be in range.
+            if (volume.max[i] < other.min[i] ||
+                volume.min[i] > other.max[i]) return duration;
+            continue;
+        }
+
+        real first = (other.min[i] - volume.max[i]) / velocity[i];
+        real last = (other.max[i] - volume.min[i]) / velocity[i];
+        if (first > last)
+        {
+            real temp = first;
+            first = last;
+            last = temp;
+        }
+
+        if (first > enter) enter = first;
+        if (last < exit) exit = last;
+        if (enter > exit) return duration;
+    }
+    return enter;
+}
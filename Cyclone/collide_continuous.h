@@ -0,0 +1,82 @@
+/*
+ * Interface file for the continuous collision detection system.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+/**
+ * @file
+ *
+ * This file contains time of impact tests for fast moving boxes. The
+ * fine collision detector only looks at where bodies are at the end
+ * of a step, so a body that moves further than its own size in one
+ * step can pass straight through thin geometry. These tests tell the
+ * caller how far such a body can safely be integrated before the
+ * fine detector has to look at it again.
+ */
+#ifndef CYCLONE_COLLISION_CONTINUOUS_H
+#define CYCLONE_COLLISION_CONTINUOUS_H
+
+#include "broadphase.h"
+
+namespace cyclone {
+
+    /**
+     * A wrapper class that holds the time of impact tests.
+     *
+     * The tests use conservative advancement: the time they return is
+     * never later than the first contact, though it may be earlier.
+     * Callers integrate to that time, run the fine detector, and ask
+     * again, until the step is used up.
+     */
+    class ContinuousDetector
+    {
+    public:
+        /**
+         * Returns true if the box travels further than its smallest
+         * half-size in the given time, so that integrating it in one
+         * step could let it tunnel.
+         */
+        static bool needsSweep(const CollisionBox &box, real duration);
+
+        /**
+         * Returns the longest time the box can be integrated for
+         * without any of its points moving further than its smallest
+         * half-size. Rotation is included.
+         */
+        static real getSafeStep(const CollisionBox &box);
+
+        /**
+         * Returns the time, up to the given duration, at which the box
+         * may first penetrate the half-space by the given depth.
+         * Returns zero if it already does.
+         */
+        static real boxAndHalfSpace(
+            const CollisionBox &box,
+            const CollisionPlane &plane,
+            real duration,
+            real depth
+            );
+
+        /**
+         * Returns the time, up to the given duration, at which the
+         * bounding box of the moving box would first touch the given
+         * stationary bounding box. Returns zero if they already
+         * overlap.
+         */
+        static real boxAndStatic(
+            const CollisionBox &box,
+            const AABB &other,
+            real duration
+            );
+    };
+
+} // namespace cyclone
+
+#endif // CYCLONE_COLLISION_CONTINUOUS_H
@@ -15,6 +15,13 @@
 #include <assert.h>
 #include <cstdlib>
 #include <cstdio>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CYCLONE_BATCH_SSE2
+#endif
 
 using namespace cyclone;
 
@@ -139,6 +146,81 @@ bool IntersectionTests::boxAndHalfSpace(
     return boxDistance <= plane.offset;
 }
 
+bool IntersectionTests::rayAndSphere(
+    const Vector3 &origin,
+    const Vector3 &direction,
+    const Vector3 &centre,
+    real radius,
+    real *distance
+    )
+{
+    // Solve |origin + direction * t - centre| = radius for the
+    // smallest t that isn't behind the origin.
+    Vector3 offset = origin - centre;
+    real a = direction.squareMagnitude();
+    if (a <= 0) return false;
+    real b = offset * direction;
+    real c = offset.squareMagnitude() - radius * radius;
+    if (c <= 0)
+    {
+        *distance = 0;
+        return true;
+    }
+    if (b >= 0) return false;
+
+    real discriminant = b * b - a * c;
+    if (discriminant < 0) return false;
+    *distance = (-b - real_sqrt(discriminant)) / a;
+    return true;
+}
+
+bool IntersectionTests::rayAndBox(
+    const Vector3 &origin,
+    const Vector3 &direction,
+    const CollisionBox &box,
+    real *distance
+    )
+{
+    return rayAndBox(origin, direction, box.getTransform(), box.halfSize,
+                     distance);
+}
+
+bool IntersectionTests::rayAndBox(
+    const Vector3 &origin,
+    const Vector3 &direction,
+    const Matrix4 &transform,
+    const Vector3 &halfSize,
+    real *distance
+    )
+{
+    // In the box's own coordinates it is axis aligned, so the ray
+    // can be clipped against each pair of faces in turn.
+    Vector3 localOrigin = transform.transformInverse(origin);
+    Vector3 localDirection = transform.transformInverseDirection(direction);
+
+    real nearest = 0;
+    real farthest = REAL_MAX;
+    for (unsigned i = 0; i < 3; i++)
+    {
+        real extent = halfSize[i];
+        if (localDirection[i] == 0)
+        {
+            if (real_abs(localOrigin[i]) > extent) return false;
+            continue;
+        }
+
+        real t1 = (-extent - localOrigin[i]) / localDirection[i];
+        real t2 = (extent - localOrigin[i]) / localDirection[i];
+        if (t1 > t2) std::swap(t1, t2);
+        if (t1 > nearest) nearest = t1;
+        if (t2 < farthest) farthest = t2;
+        if (nearest > farthest) return false;
+    }
+
+    *distance = nearest;
+    return true;
+}
+
 unsigned CollisionDetector::sphereAndTruePlane(
     const CollisionSphere &sphere,
     const CollisionPlane &plane,
@@ -291,7 +373,8 @@ static inline bool tryAxis(
 
     // These values may be updated
     real& smallestPenetration,
-    unsigned &smallestCase
+    unsigned &smallestCase,
+    real margin
     )
 {
     // Make sure we have a normalized axis, and don't check almost parallel axes
@@ -300,7 +383,9 @@ static inline bool tryAxis(
 
     real penetration = penetrationOnAxis(one, two, axis, toCentre);
 
-    if (penetration < 0) return false;
+    // Boxes apart by no more than the margin still get a
+    // (speculative) contact.
+    if (penetration < -margin) return false;
     if (penetration < smallestPenetration) {
         smallestPenetration = penetration;
         smallestCase = index;
@@ -404,7 +489,7 @@ static inline Vector3 contactPoint(
 // This preprocessor definition is only used as a convenience
 // in the boxAndBox contact generation method.
 #define CHECK_OVERLAP(axis, index) \
-    if (!tryAxis(one, two, (axis), toCentre, (index), pen, best)) return 0;
+    if (!tryAxis(one, two, (axis), toCentre, (index), pen, best, margin)) return 0;
 
 unsigned CollisionDetector::boxAndBox(
     const CollisionBox &one,
@@ -421,6 +506,15 @@ unsigned CollisionDetector::boxAndBox(
     real pen = REAL_MAX;
     unsigned best = 0xffffff;
 
+    // Look for speculative contacts as far as the boxes can close
+    // on each other in the speculative time.
+    real margin = 0;
+    if (data->speculativeTime > 0)
+    {
+        margin = (one.body->getVelocity() - two.body->getVelocity())
+            .magnitude() * data->speculativeTime;
+    }
+
     // Now we check each axes, returning if it gives us
     // a separating axis, and keeping track of the axis with
     // the smallest penetration otherwise.
@@ -701,3 +795,126 @@ unsigned CollisionDetector::boxAndHalfSpace(
     data->addContacts(contactsUsed);
     return contactsUsed;
 }
+
+/**
+ * Works out which corners of a box are on or behind a plane, given the
+ * signed distance of the box centre from the plane and the projections
+ * of its three half-size axes onto the plane normal. Corner i is
+ * centre + sum of +-axis, with the sign of axis n negative when bit n
+ * of i is set (the same order as the mults table above). Bit i of the
+ * result is set if corner i is in contact.
+ */
+static inline unsigned cornersBehindPlane(real centre,
+                                          real e0, real e1, real e2)
+{
+#if defined(CYCLONE_BATCH_SSE2) && defined(SINGLE_PRECISION)
+    // Two registers of four corners each.
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 x = _mm_set_ps(-e0, e0, -e0, e0);
+    const __m128 y = _mm_set_ps(-e1, -e1, e1, e1);
+    const __m128 base = _mm_add_ps(_mm_set1_ps(centre), _mm_add_ps(x, y));
+    const __m128 low = _mm_add_ps(base, _mm_set1_ps(e2));
+    const __m128 high = _mm_sub_ps(base, _mm_set1_ps(e2));
+    return (unsigned)_mm_movemask_ps(_mm_cmple_ps(low, zero)) |
+        ((unsigned)_mm_movemask_ps(_mm_cmple_ps(high, zero)) << 4);
+#elif defined(CYCLONE_BATCH_SSE2)
+    // Four registers of two corners each.
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d x = _mm_add_pd(_mm_set1_pd(centre), _mm_set_pd(-e0, e0));
+    const __m128d yz0 = _mm_add_pd(x, _mm_set1_pd(e1 + e2));
+    const __m128d yz1 = _mm_add_pd(x, _mm_set1_pd(-e1 + e2));
+    const __m128d yz2 = _mm_add_pd(x, _mm_set1_pd(e1 - e2));
+    const __m128d yz3 = _mm_add_pd(x, _mm_set1_pd(-e1 - e2));
+    return (unsigned)_mm_movemask_pd(_mm_cmple_pd(yz0, zero)) |
+        ((unsigned)_mm_movemask_pd(_mm_cmple_pd(yz1, zero)) << 2) |
+        ((unsigned)_mm_movemask_pd(_mm_cmple_pd(yz2, zero)) << 4) |
+        ((unsigned)_mm_movemask_pd(_mm_cmple_pd(yz3, zero)) << 6);
+#else
+    unsigned mask = 0;
+    for (unsigned i = 0; i < 8; i++)
+    {
+        real distance = centre +
+            ((i & 1) ? -e0 : e0) +
+            ((i & 2) ? -e1 : e1) +
+            ((i & 4) ? -e2 : e2);
+        if (distance <= 0) mask |= 1u << i;
+    }
+    return mask;
+#endif
+}
+
+unsigned CollisionDetector::boxesAndHalfSpace(
+    const Matrix4 *transforms,
+    const Vector3 *halfSizes,
+    RigidBody *const *bodies,
+    unsigned count,
+    const CollisionPlane &plane,
+    CollisionData *data
+    )
+{
+    const Vector3 &normal = plane.direction;
+    Contact* contact = data->contacts;
+    unsigned contactsUsed = 0;
+    unsigned contactsLeft = data->contactsLeft > 0 ? data->contactsLeft : 0;
+    const real speculativeTime = data->speculativeTime;
+
+    for (unsigned b = 0; b < count && contactsUsed < contactsLeft; b++)
+    {
+        const real *m = transforms[b].data;
+        const Vector3 &halfSize = halfSizes[b];
+
+        // Project the centre and each half-size axis onto the normal.
+        real centre = normal.x*m[3] + normal.y*m[7] + normal.z*m[11] -
+            plane.offset;
+        real e0 = halfSize.x *
+            (normal.x*m[0] + normal.y*m[4] + normal.z*m[8]);
+        real e1 = halfSize.y *
+            (normal.x*m[1] + normal.y*m[5] + normal.z*m[9]);
+        real e2 = halfSize.z *
+            (normal.x*m[2] + normal.y*m[6] + normal.z*m[10]);
+
+        // Corners within the distance the box falls this step get
+        // speculative contacts.
+        real margin = 0;
+        if (speculativeTime > 0)
+        {
+            real closing = -(normal * bodies[b]->getVelocity());
+            if (closing > 0) margin = closing * speculativeTime;
+        }
+
+        // The deepest corner decides whether there is anything to do.
+        if (centre - real_abs(e0) - real_abs(e1) - real_abs(e2) > margin)
+        {
+            continue;
+        }
+
+        unsigned mask = cornersBehindPlane(centre - margin, e0, e1, e2);
+        for (unsigned i = 0; mask != 0; i++, mask >>= 1)
+        {
+            if (!(mask & 1)) continue;
+
+            Vector3 vertexPos(
+                (i & 1) ? -halfSize.x : halfSize.x,
+                (i & 2) ? -halfSize.y : halfSize.y,
+                (i & 4) ? -halfSize.z : halfSize.z);
+            vertexPos = transforms[b].transform(vertexPos);
+            real vertexDistance = vertexPos * normal;
+
+            // Same contact data as boxAndHalfSpace.
+            contact->contactPoint = normal;
+            contact->contactPoint *= (vertexDistance-plane.offset);
+            contact->contactPoint += vertexPos;
+            contact->contactNormal = normal;
+            contact->penetration = plane.offset - vertexDistance;
+            contact->setBodyData(bodies[b], NULL,
+                data->friction, data->restitution);
+
+            contact++;
+            contactsUsed++;
+            if (contactsUsed == contactsLeft) break;
+        }
+    }
+
+    data->addContacts(contactsUsed);
+    return contactsUsed;
+}
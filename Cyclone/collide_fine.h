@@ -173,6 +173,41 @@ namespace cyclone {
         static bool boxAndHalfSpace(
             const CollisionBox &box,
             const CollisionPlane &plane);
+
+        /**
+         * Checks if a ray hits a sphere. The ray starts at the given
+         * origin and runs along the given direction, which needn't be
+         * a unit vector: the distance to the hit, written if there is
+         * one, is in units of the direction's length. A ray starting
+         * inside the sphere hits it at distance zero.
+         */
+        static bool rayAndSphere(
+            const Vector3 &origin,
+            const Vector3 &direction,
+            const Vector3 &centre,
+            real radius,
+            real *distance);
+
+        /**
+         * Checks if a ray hits an arbitrarily aligned box, with the
+         * ray given as for rayAndSphere.
+         */
+        static bool rayAndBox(
+            const Vector3 &origin,
+            const Vector3 &direction,
+            const CollisionBox &box,
+            real *distance);
+
+        /**
+         * Checks if a ray hits a box with the given transform and
+         * half-sizes, with the ray given as for rayAndSphere.
+         */
+        static bool rayAndBox(
+            const Vector3 &origin,
+            const Vector3 &direction,
+            const Matrix4 &transform,
+            const Vector3 &halfSize,
+            real *distance);
     };
 
 
@@ -211,6 +246,17 @@ namespace cyclone {
          */
         real tolerance;
 
+        /**
+         * Holds how far ahead to look for speculative contacts. Bodies
+         * that are still apart, but close enough to meet within this
+         * time at their current closing speed, get a contact with a
+         * negative penetration (the size of the gap). The resolver
+         * then removes just enough closing velocity to stop them
+         * overlapping. Set this to the step duration to use them, or
+         * to zero for contacts only between touching bodies.
+         */
+        real speculativeTime;
+
         /**
          * Checks if there are more contacts available in the contact
          * data.
@@ -286,6 +332,32 @@ namespace cyclone {
             CollisionData *data
             );
 
+        /**
+         * Does the same test as boxAndHalfSpace for a whole batch of
+         * boxes against one half-space, writing contacts straight
+         * into the contact data.
+         *
+         * The boxes are given as contiguous arrays of transforms (as
+         * returned by CollisionPrimitive::getTransform), half-sizes
+         * and the bodies that own them. Boxes that are clear of the
+         * plane are rejected with three dot products, and the eight
+         * corners of the rest are tested together, using SIMD where
+         * it is available. Only corners that are in contact are
+         * transformed into world space.
+         *
+         * Corners above the plane are given speculative contacts if
+         * their box is falling fast enough to reach the plane within
+         * the data's speculative time.
+         */
+        static unsigned boxesAndHalfSpace(
+            const Matrix4 *transforms,
+            const Vector3 *halfSizes,
+            RigidBody *const *bodies,
+            unsigned count,
+            const CollisionPlane &plane,
+            CollisionData *data
+            );
+
         static unsigned boxAndBox(
             const CollisionBox &one,
             const CollisionBox &two,
@@ -29,7 +29,9 @@ void Contact::setBodyData(RigidBody* one, RigidBody *two,
 
 void Contact::matchAwakeState()
 {
-    // Collisions with the world never cause a body to wake up.
+    // Collisions with the world never cause a body to wake up. Nor do
+    // collisions with static bodies, which ignore setAwake, while
+    // kinematic bodies are always awake and so wake what they touch.
     if (!body[1]) return;
 
     bool body0awake = body[0]->getAwake();
@@ -149,6 +151,17 @@ void Contact::calculateDesiredDeltaVelocity(real duration)
 {
     const static real velocityLimit = (real)0.25f;
 
+    // A speculative contact's bodies are still apart. They may keep
+    // closing as long as they don't cover the gap in this step, so
+    // only the excess closing velocity is removed, without bounce.
+    if (penetration < 0)
+    {
+        desiredDeltaVelocity = -contactVelocity.x;
+        if (duration > 0) desiredDeltaVelocity += penetration / duration;
+        if (desiredDeltaVelocity < 0) desiredDeltaVelocity = 0;
+        return;
+    }
+
     // Calculate the acceleration induced velocity accumulated this frame
     real velocityFromAcc = 0;
 
@@ -242,7 +255,9 @@ void Contact::applyVelocityChange(Vector3 velocityChange[2],
     body[0]->addVelocity(velocityChange[0]);
     body[0]->addRotation(rotationChange[0]);
 
-    if (body[1])
+    // Static and kinematic bodies have infinite mass, so there is
+    // nothing to apply to them.
+    if (body[1] && body[1]->isDynamic())
     {
         // Work out body one's linear and angular changes
         Vector3 impulsiveTorque = impulse % relativeContactPosition[1];
@@ -392,6 +407,13 @@ void Contact::applyPositionChange(Vector3 linearChange[2],
     // of the contact normal, due to angular inertia only.
     for (unsigned i = 0; i < 2; i++) if (body[i])
     {
+        // Static and kinematic bodies cannot be moved.
+        if (!body[i]->isDynamic())
+        {
+            linearInertia[i] = angularInertia[i] = 0;
+            continue;
+        }
+
         Matrix3 inverseInertiaTensor;
         body[i]->getInverseInertiaTensorWorld(&inverseInertiaTensor);
 
@@ -420,6 +442,13 @@ void Contact::applyPositionChange(Vector3 linearChange[2],
     // Loop through again calculating and applying the changes
     for (unsigned i = 0; i < 2; i++) if (body[i])
     {
+        if (!body[i]->isDynamic())
+        {
+            linearChange[i].clear();
+            angularChange[i].clear();
+            continue;
+        }
+
         // The linear and angular movements required are in proportion to
         // the two inverse inertias.
         real sign = (i == 0)?1:-1;
@@ -522,7 +551,7 @@ ContactResolver::ContactResolver(unsigned velocityIterations,
                                  real velocityEpsilon,
                                  real positionEpsilon)
 {
-    setIterations(velocityIterations);
+    setIterations(velocityIterations, positionIterations);
     setEpsilon(velocityEpsilon, positionEpsilon);
 }
 
@@ -618,7 +647,10 @@ void ContactResolver::adjustVelocities(Contact *c,
                 // resolved contact
                 for (unsigned d = 0; d < 2; d++)
                 {
-                    if (c[i].body[b] == c[index].body[d])
+                    // Bodies that are not dynamic were not changed,
+                    // however many contacts they share.
+                    if (c[i].body[b] == c[index].body[d] &&
+                        c[index].body[d]->isDynamic())
                     {
                         deltaVel = velocityChange[d] +
                             rotationChange[d].vectorProduct(
@@ -684,7 +716,8 @@ void ContactResolver::adjustPositions(Contact *c,
                 // resolved contact
                 for (unsigned d = 0; d < 2; d++)
                 {
-                    if (c[i].body[b] == c[index].body[d])
+                    if (c[i].body[b] == c[index].body[d] &&
+                        c[index].body[d]->isDynamic())
                     {
                         deltaPosition = linearChange[d] +
                             angularChange[d].vectorProduct(
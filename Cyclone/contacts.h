@@ -96,7 +96,10 @@ namespace cyclone {
         /**
          * Holds the depth of penetration at the contact point. If both
          * bodies are specified then the contact point should be midway
-         * between the inter-penetrating points.
+         * between the inter-penetrating points. A negative value marks
+         * a speculative contact: the bodies are that far apart, and
+         * the resolver only stops them closing the gap within the
+         * step.
          */
         real penetration;
 
@@ -14,14 +14,30 @@
 
 using namespace cyclone;
 
-const Vector3 Vector3::GRAVITY = Vector3(0, -9.81, 0);
-const Vector3 Vector3::HIGH_GRAVITY = Vector3(0, -19.62, 0);
-const Vector3 Vector3::UP = Vector3(0, 1, 0);
-const Vector3 Vector3::RIGHT = Vector3(1, 0, 0);
-const Vector3 Vector3::OUT_OF_SCREEN = Vector3(0, 0, 1);
-const Vector3 Vector3::X = Vector3(0, 1, 0);
-const Vector3 Vector3::Y = Vector3(1, 0, 0);
-const Vector3 Vector3::Z = Vector3(0, 0, 1);
+template <class Precision>
+const BasicVector3<Precision> BasicVector3<Precision>::GRAVITY =
+    BasicVector3<Precision>(0, (real)-9.81, 0);
+template <class Precision>
+const BasicVector3<Precision> BasicVector3<Precision>::HIGH_GRAVITY =
+    BasicVector3<Precision>(0, (real)-19.62, 0);
+template <class Precision>
+const BasicVector3<Precision> BasicVector3<Precision>::UP =
+    BasicVector3<Precision>(0, 1, 0);
+template <class Precision>
+const BasicVector3<Precision> BasicVector3<Precision>::RIGHT =
+    BasicVector3<Precision>(1, 0, 0);
+template <class Precision>
+const BasicVector3<Precision> BasicVector3<Precision>::OUT_OF_SCREEN =
+    BasicVector3<Precision>(0, 0, 1);
+template <class Precision>
+const BasicVector3<Precision> BasicVector3<Precision>::X =
+    BasicVector3<Precision>(0, 1, 0);
+template <class Precision>
+const BasicVector3<Precision> BasicVector3<Precision>::Y =
+    BasicVector3<Precision>(1, 0, 0);
+template <class Precision>
+const BasicVector3<Precision> BasicVector3<Precision>::Z =
+    BasicVector3<Precision>(0, 0, 1);
 
 /*
  * Definition of the sleep epsilon extern.
@@ -41,7 +57,8 @@ real cyclone::getSleepEpsilon()
     return cyclone::sleepEpsilon;
 }
 
-real Matrix4::getDeterminant() const
+template <class Precision>
+typename Precision::real BasicMatrix4<Precision>::getDeterminant() const
 {
     return -data[8]*data[5]*data[2]+
         data[4]*data[9]*data[2]+
@@ -51,10 +68,51 @@ real Matrix4::getDeterminant() const
         data[0]*data[5]*data[10];
 }
 
-void Matrix4::setInverse(const Matrix4 &m)
+template <class Precision>
+void BasicMatrix4<Precision>::setInverse(const Matrix4 &m)
 {
+#ifdef CYCLONE_SIMD_BACKEND
+    // The rows of the inverse rotation are the cross products of the
+    // columns, divided by the determinant, as for Matrix3. Each cross
+    // product is worked out with a lane per component.
+    const real *d = m.data;
+    Lanes pyzx = Lanes::set(d[4], d[8], d[0], 0);
+    Lanes pzxy = Lanes::set(d[8], d[0], d[4], 0);
+    Lanes qyzx = Lanes::set(d[5], d[9], d[1], 0);
+    Lanes qzxy = Lanes::set(d[9], d[1], d[5], 0);
+    Lanes ryzx = Lanes::set(d[6], d[10], d[2], 0);
+    Lanes rzxy = Lanes::set(d[10], d[2], d[6], 0);
+    Lanes translation = Lanes::set(d[3], d[7], d[11], 0);
+
+    Lanes row0 = Lanes::sub(Lanes::mul(qyzx, rzxy), Lanes::mul(qzxy, ryzx));
+    Lanes row1 = Lanes::sub(Lanes::mul(ryzx, pzxy), Lanes::mul(rzxy, pyzx));
+    Lanes row2 = Lanes::sub(Lanes::mul(pyzx, qzxy), Lanes::mul(pzxy, qyzx));
+
     // Make sure the determinant is non-zero.
-    real det = getDeterminant();
+    real det = Lanes::sum(Lanes::mul(row0, Lanes::set(d[0], d[4], d[8], 0)));
+    if (det == 0) return;
+    Lanes scale = Lanes::splat(((real)1.0)/det);
+    row0 = Lanes::mul(row0, scale);
+    row1 = Lanes::mul(row1, scale);
+    row2 = Lanes::mul(row2, scale);
+
+    // The new translation undoes the old one, in the inverse
+    // rotation's frame.
+    real moved[4];
+    Lanes::store3(moved, Lanes::sum3(
+        Lanes::mul(row0, translation),
+        Lanes::mul(row1, translation),
+        Lanes::mul(row2, translation)));
+
+    Lanes::store(data, row0);
+    Lanes::store(data + 4, row1);
+    Lanes::store(data + 8, row2);
+    data[3] = -moved[0];
+    data[7] = -moved[1];
+    data[11] = -moved[2];
+#else
+    // Make sure the determinant is non-zero.
+    real det = m.getDeterminant();
     if (det == 0) return;
     det = ((real)1.0)/det;
 
@@ -88,9 +146,12 @@ void Matrix4::setInverse(const Matrix4 &m)
                +m.data[0]*m.data[9]*m.data[7]
                +m.data[4]*m.data[1]*m.data[11]
                -m.data[0]*m.data[5]*m.data[11])*det;
+#endif
 }
 
-Matrix3 Matrix3::linearInterpolate(const Matrix3& a, const Matrix3& b, real prop)
+template <class Precision>
+BasicMatrix3<Precision> BasicMatrix3<Precision>::linearInterpolate(
+    const Matrix3& a, const Matrix3& b, real prop)
 {
     Matrix3 result;
     for (unsigned i = 0; i < 9; i++) {
@@ -98,3 +159,16 @@ Matrix3 Matrix3::linearInterpolate(const Matrix3& a, const Matrix3& b, real prop
     }
     return result;
 }
+
+/*
+ * The core types are compiled here at both precisions, so that the
+ * out of line members and the constants are only built once.
+ */
+template class cyclone::BasicVector3<SinglePrecision>;
+template class cyclone::BasicVector3<DoublePrecision>;
+template class cyclone::BasicQuaternion<SinglePrecision>;
+template class cyclone::BasicQuaternion<DoublePrecision>;
+template class cyclone::BasicMatrix4<SinglePrecision>;
+template class cyclone::BasicMatrix4<DoublePrecision>;
+template class cyclone::BasicMatrix3<SinglePrecision>;
+template class cyclone::BasicMatrix3<DoublePrecision>;
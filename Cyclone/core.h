@@ -98,6 +98,7 @@
 #define CYCLONE_CORE_H
 
 #include "precision.h"
+#include "simd.h"
 #include <string>
 #include <sstream>
 /**
@@ -150,13 +151,30 @@ namespace cyclone {
      * Holds a vector in 3 dimensions. Four data members are allocated
      * to ensure alignment in an array.
      *
+     * The vector is a template on a precision policy, SinglePrecision
+     * or DoublePrecision, which gives its real number type. Vector3 is
+     * the vector at the default precision.
+     *
+     * When Cyclone is built with CYCLONE_SIMD, the vector is aligned
+     * for the target's vector instructions, and the component-wise
+     * operators work on all four members at once. The padding member
+     * starts at zero, and stays there while the components are
+     * finite.
+     *
      * @note This class contains a lot of inline methods for basic
      * mathematics. The implementations are included in the header
      * file.
      */
-    class Vector3
+    template <class Precision>
+    class alignas(simd::Alignment<typename Precision::real>::value) BasicVector3
     {
     public:
+        typedef typename Precision::real real;
+        typedef BasicVector3 Vector3;
+#ifdef CYCLONE_SIMD_BACKEND
+        typedef simd::Lanes<real> Lanes;
+#endif
+
          /** Holds the value along the x axis. */
         real x;
 
@@ -172,14 +190,41 @@ namespace cyclone {
 
     public:
         /** The default constructor creates a zero vector. */
-        Vector3() : x(0), y(0), z(0) {}
+        BasicVector3() : x(0), y(0), z(0), pad(0) {}
 
         /**
          * The explicit constructor creates a vector with the given
          * components.
          */
-        Vector3(const real x, const real y, const real z)
-            : x(x), y(y), z(z) {}
+        BasicVector3(const real x, const real y, const real z)
+            : x(x), y(y), z(z), pad(0) {}
+
+        /**
+         * Creates a vector from one at another precision.
+         */
+        template <class OtherPrecision>
+        explicit BasicVector3(const BasicVector3<OtherPrecision> &other)
+            : x((real)other.x), y((real)other.y), z((real)other.z), pad(0) {}
+
+#ifdef CYCLONE_SIMD_BACKEND
+        /**
+         * Creates a vector from a set of lanes. The fourth lane must
+         * be zero, as it becomes the padding.
+         */
+        explicit BasicVector3(const Lanes &lanes)
+        {
+            Lanes::store(&x, lanes);
+        }
+
+        /**
+         * Returns the vector as a set of lanes, with the padding in
+         * the fourth.
+         */
+        Lanes lanes() const
+        {
+            return Lanes::load(&x);
+        }
+#endif
 
         const static Vector3 GRAVITY;
         const static Vector3 HIGH_GRAVITY;
@@ -210,9 +255,13 @@ namespace cyclone {
         /** Adds the given vector to this. */
         void operator+=(const Vector3& v)
         {
+#ifdef CYCLONE_SIMD_BACKEND
+            Lanes::store(&x, Lanes::add(lanes(), v.lanes()));
+#else
             x += v.x;
             y += v.y;
             z += v.z;
+#endif
         }
 
         /**
@@ -220,15 +269,23 @@ namespace cyclone {
          */
         Vector3 operator+(const Vector3& v) const
         {
+#ifdef CYCLONE_SIMD_BACKEND
+            return Vector3(Lanes::add(lanes(), v.lanes()));
+#else
             return Vector3(x+v.x, y+v.y, z+v.z);
+#endif
         }
 
         /** Subtracts the given vector from this. */
         void operator-=(const Vector3& v)
         {
+#ifdef CYCLONE_SIMD_BACKEND
+            Lanes::store(&x, Lanes::sub(lanes(), v.lanes()));
+#else
             x -= v.x;
             y -= v.y;
             z -= v.z;
+#endif
         }
 
         /**
@@ -236,15 +293,23 @@ namespace cyclone {
          */
         Vector3 operator-(const Vector3& v) const
         {
+#ifdef CYCLONE_SIMD_BACKEND
+            return Vector3(Lanes::sub(lanes(), v.lanes()));
+#else
             return Vector3(x-v.x, y-v.y, z-v.z);
+#endif
         }
 
         /** Multiplies this vector by the given scalar. */
         void operator*=(const real value)
         {
+#ifdef CYCLONE_SIMD_BACKEND
+            Lanes::store(&x, Lanes::mul(lanes(), Lanes::splat(value)));
+#else
             x *= value;
             y *= value;
             z *= value;
+#endif
         }
 
         void operator/=(const real value)
@@ -257,7 +322,11 @@ namespace cyclone {
 
         Vector3 operator*(const real value) const
         {
+#ifdef CYCLONE_SIMD_BACKEND
+            return Vector3(Lanes::mul(lanes(), Lanes::splat(value)));
+#else
             return Vector3(x * value, y * value, z * value);
+#endif
         }
 
      
@@ -284,7 +353,11 @@ namespace cyclone {
          */
         Vector3 componentProduct(const Vector3 &vector) const
         {
+#ifdef CYCLONE_SIMD_BACKEND
+            return Vector3(Lanes::mul(lanes(), vector.lanes()));
+#else
             return Vector3(x * vector.x, y * vector.y, z * vector.z);
+#endif
         }
 
         /**
@@ -293,9 +366,13 @@ namespace cyclone {
          */
         void componentProductUpdate(const Vector3 &vector)
         {
+#ifdef CYCLONE_SIMD_BACKEND
+            Lanes::store(&x, Lanes::mul(lanes(), vector.lanes()));
+#else
             x *= vector.x;
             y *= vector.y;
             z *= vector.z;
+#endif
         }
 
         /**
@@ -370,15 +447,19 @@ namespace cyclone {
          */
         void addScaledVector(const Vector3& vector, real scale)
         {
+#ifdef CYCLONE_SIMD_BACKEND
+            Lanes::store(&x, Lanes::scaleAdd(vector.lanes(), scale, lanes()));
+#else
             x += vector.x * scale;
             y += vector.y * scale;
             z += vector.z * scale;
+#endif
         }
 
         /** Gets the magnitude of this vector. */
         real magnitude() const
         {
-            return real_sqrt(x*x+y*y+z*z);
+            return Precision::sqrt(x*x+y*y+z*z);
         }
 
         /** Gets the squared magnitude of this vector. */
@@ -507,7 +588,9 @@ namespace cyclone {
 
 
 
-    static Vector3 operator * (const real l, const Vector3& r)
+    template <class Precision>
+    BasicVector3<Precision> operator * (
+        const typename Precision::real l, const BasicVector3<Precision>& r)
     {
         return  r * l;
     }
@@ -529,10 +612,21 @@ namespace cyclone {
      * @note Angular velocity and acceleration can be correctly
      * represented as vectors. Quaternions are only needed for
      * orientation.
+     *
+     * As with BasicVector3, the quaternion is a template on a
+     * precision policy, and Quaternion is the default precision.
      */
-    class Quaternion
+    template <class Precision>
+    class alignas(simd::Alignment<typename Precision::real>::value) BasicQuaternion
     {
     public:
+        typedef typename Precision::real real;
+        typedef BasicVector3<Precision> Vector3;
+        typedef BasicQuaternion Quaternion;
+#ifdef CYCLONE_SIMD_BACKEND
+        typedef simd::Lanes<real> Lanes;
+#endif
+
         union {
             struct {
                 /**
@@ -571,7 +665,7 @@ namespace cyclone {
          * The default constructor creates a quaternion representing
          * a zero rotation.
          */
-        Quaternion() : r(1), i(0), j(0), k(0) {}
+        BasicQuaternion() : r(1), i(0), j(0), k(0) {}
 
         /**
          * The explicit constructor creates a quaternion with the given
@@ -597,11 +691,21 @@ namespace cyclone {
          *
          * @see normalise
          */
-        Quaternion(const real r, const real i, const real j, const real k)
+        BasicQuaternion(const real r, const real i, const real j, const real k)
             : r(r), i(i), j(j), k(k)
         {
         }
 
+        /**
+         * Creates a quaternion from one at another precision.
+         */
+        template <class OtherPrecision>
+        explicit BasicQuaternion(const BasicQuaternion<OtherPrecision> &other)
+            : r((real)other.r), i((real)other.i), j((real)other.j),
+            k((real)other.k)
+        {
+        }
+
         /**
          * Normalises the quaternion to unit length, making it a valid
          * orientation quaternion.
@@ -612,12 +716,12 @@ namespace cyclone {
 
             // Check for zero length quaternion, and use the no-rotation
             // quaternion in that case.
-            if (d < real_epsilon) {
+            if (d < Precision::epsilon()) {
                 r = 1;
                 return;
             }
 
-            d = ((real)1.0)/real_sqrt(d);
+            d = ((real)1.0)/Precision::sqrt(d);
             r *= d;
             i *= d;
             j *= d;
@@ -631,6 +735,25 @@ namespace cyclone {
          */
         void operator *=(const Quaternion &multiplier)
         {
+#ifdef CYCLONE_SIMD_BACKEND
+            // Each component of this scales a shuffled, sign flipped
+            // copy of the multiplier, and the four are summed.
+            Lanes m = Lanes::load(multiplier.data);
+            const real n = -(real)0;
+            Lanes mi = Lanes::flipSigns(Lanes::swapPairs(m),
+                Lanes::set(n, 0, n, 0));
+            Lanes mj = Lanes::flipSigns(Lanes::swapHalves(m),
+                Lanes::set(n, 0, 0, n));
+            Lanes mk = Lanes::flipSigns(
+                Lanes::swapHalves(Lanes::swapPairs(m)),
+                Lanes::set(n, n, 0, 0));
+
+            Lanes result = Lanes::mul(Lanes::splat(r), m);
+            result = Lanes::add(result, Lanes::mul(Lanes::splat(i), mi));
+            result = Lanes::add(result, Lanes::mul(Lanes::splat(j), mj));
+            result = Lanes::add(result, Lanes::mul(Lanes::splat(k), mk));
+            Lanes::store(data, result);
+#else
             Quaternion q = *this;
             r = q.r*multiplier.r - q.i*multiplier.i -
                 q.j*multiplier.j - q.k*multiplier.k;
@@ -640,6 +763,7 @@ namespace cyclone {
                 q.k*multiplier.i - q.i*multiplier.k;
             k = q.r*multiplier.k + q.k*multiplier.r +
                 q.i*multiplier.j - q.j*multiplier.i;
+#endif
         }
 
         /**
@@ -678,10 +802,22 @@ namespace cyclone {
      * Holds a transform matrix, consisting of a rotation matrix and
      * a position. The matrix has 12 elements, it is assumed that the
      * remaining four are (0,0,0,1); producing a homogenous matrix.
+     *
+     * When Cyclone is built with CYCLONE_SIMD, each row of four
+     * elements is aligned for the target's vector instructions.
      */
-    class Matrix4
+    template <class Precision>
+    class alignas(simd::Alignment<typename Precision::real>::value) BasicMatrix4
     {
     public:
+        typedef typename Precision::real real;
+        typedef BasicVector3<Precision> Vector3;
+        typedef BasicQuaternion<Precision> Quaternion;
+        typedef BasicMatrix4 Matrix4;
+#ifdef CYCLONE_SIMD_BACKEND
+        typedef simd::Lanes<real> Lanes;
+#endif
+
         /**
          * Holds the transform matrix data in array form.
          */
@@ -693,7 +829,7 @@ namespace cyclone {
         /**
          * Creates an identity matrix.
          */
-        Matrix4()
+        BasicMatrix4()
         {
             data[1] = data[2] = data[3] = data[4] = data[6] =
                 data[7] = data[8] = data[9] = data[11] = 0;
@@ -717,6 +853,21 @@ namespace cyclone {
         Matrix4 operator*(const Matrix4 &o) const
         {
             Matrix4 result;
+#ifdef CYCLONE_SIMD_BACKEND
+            // Each row of the result is a sum of the rows of the
+            // other matrix, plus this row's translation.
+            Lanes row0 = Lanes::load(o.data);
+            Lanes row1 = Lanes::load(o.data + 4);
+            Lanes row2 = Lanes::load(o.data + 8);
+            for (unsigned i = 0; i < 12; i += 4)
+            {
+                Lanes row = Lanes::mul(Lanes::splat(data[i]), row0);
+                row = Lanes::add(row, Lanes::mul(Lanes::splat(data[i+1]), row1));
+                row = Lanes::add(row, Lanes::mul(Lanes::splat(data[i+2]), row2));
+                row = Lanes::add(row, Lanes::set(0, 0, 0, data[i+3]));
+                Lanes::store(result.data + i, row);
+            }
+#else
             result.data[0] = (o.data[0]*data[0]) + (o.data[4]*data[1]) + (o.data[8]*data[2]);
             result.data[4] = (o.data[0]*data[4]) + (o.data[4]*data[5]) + (o.data[8]*data[6]);
             result.data[8] = (o.data[0]*data[8]) + (o.data[4]*data[9]) + (o.data[8]*data[10]);
@@ -732,6 +883,7 @@ namespace cyclone {
             result.data[3] = (o.data[3]*data[0]) + (o.data[7]*data[1]) + (o.data[11]*data[2]) + data[3];
             result.data[7] = (o.data[3]*data[4]) + (o.data[7]*data[5]) + (o.data[11]*data[6]) + data[7];
             result.data[11] = (o.data[3]*data[8]) + (o.data[7]*data[9]) + (o.data[11]*data[10]) + data[11];
+#endif
 
             return result;
         }
@@ -743,6 +895,16 @@ namespace cyclone {
          */
         Vector3 operator*(const Vector3 &vector) const
         {
+#ifdef CYCLONE_SIMD_BACKEND
+            // Each component is the dot product of a row with the
+            // vector, extended with a one to pick up the translation.
+            Lanes v = Lanes::add(Lanes::clearLast(vector.lanes()),
+                Lanes::set(0, 0, 0, 1));
+            return Vector3(Lanes::sum3(
+                Lanes::mul(Lanes::load(data), v),
+                Lanes::mul(Lanes::load(data + 4), v),
+                Lanes::mul(Lanes::load(data + 8), v)));
+#else
             return Vector3(
                 vector.x * data[0] +
                 vector.y * data[1] +
@@ -756,6 +918,7 @@ namespace cyclone {
                 vector.y * data[9] +
                 vector.z * data[10] + data[11]
             );
+#endif
         }
 
         /**
@@ -806,6 +969,13 @@ namespace cyclone {
          */
         Vector3 transformDirection(const Vector3 &vector) const
         {
+#ifdef CYCLONE_SIMD_BACKEND
+            Lanes v = Lanes::clearLast(vector.lanes());
+            return Vector3(Lanes::sum3(
+                Lanes::mul(Lanes::load(data), v),
+                Lanes::mul(Lanes::load(data + 4), v),
+                Lanes::mul(Lanes::load(data + 8), v)));
+#else
             return Vector3(
                 vector.x * data[0] +
                 vector.y * data[1] +
@@ -819,6 +989,7 @@ namespace cyclone {
                 vector.y * data[9] +
                 vector.z * data[10]
             );
+#endif
         }
 
         /**
@@ -839,6 +1010,17 @@ namespace cyclone {
          */
         Vector3 transformInverseDirection(const Vector3 &vector) const
         {
+#ifdef CYCLONE_SIMD_BACKEND
+            // Multiplying by the transpose sums the rows, scaled by
+            // each component in turn.
+            Lanes result = Lanes::mul(Lanes::splat(vector.x),
+                Lanes::load(data));
+            result = Lanes::add(result, Lanes::mul(Lanes::splat(vector.y),
+                Lanes::load(data + 4)));
+            result = Lanes::add(result, Lanes::mul(Lanes::splat(vector.z),
+                Lanes::load(data + 8)));
+            return Vector3(Lanes::clearLast(result));
+#else
             return Vector3(
                 vector.x * data[0] +
                 vector.y * data[4] +
@@ -852,6 +1034,7 @@ namespace cyclone {
                 vector.y * data[6] +
                 vector.z * data[10]
             );
+#endif
         }
 
         /**
@@ -869,6 +1052,12 @@ namespace cyclone {
          */
         Vector3 transformInverse(const Vector3 &vector) const
         {
+#ifdef CYCLONE_SIMD_BACKEND
+            return transformInverseDirection(Vector3(
+                vector.x - data[3],
+                vector.y - data[7],
+                vector.z - data[11]));
+#else
             Vector3 tmp = vector;
             tmp.x -= data[3];
             tmp.y -= data[7];
@@ -886,6 +1075,7 @@ namespace cyclone {
                 tmp.y * data[6] +
                 tmp.z * data[10]
             );
+#endif
         }
 
         /**
@@ -960,9 +1150,18 @@ namespace cyclone {
      * damping coefficients to make the 12-element characteristics array
      * of a rigid body.
      */
-    class Matrix3
+    template <class Precision>
+    class BasicMatrix3
     {
     public:
+        typedef typename Precision::real real;
+        typedef BasicVector3<Precision> Vector3;
+        typedef BasicQuaternion<Precision> Quaternion;
+        typedef BasicMatrix3 Matrix3;
+#ifdef CYCLONE_SIMD_BACKEND
+        typedef simd::Lanes<real> Lanes;
+#endif
+
         /**
          * Holds the tensor matrix data in array form.
          */
@@ -973,7 +1172,7 @@ namespace cyclone {
         /**
          * Creates a new matrix.
          */
-        Matrix3()
+        BasicMatrix3()
         {
             data[0] = data[1] = data[2] = data[3] = data[4] = data[5] =
                 data[6] = data[7] = data[8] = 0;
@@ -983,7 +1182,7 @@ namespace cyclone {
          * Creates a new matrix with the given three vectors making
          * up its columns.
          */
-        Matrix3(const Vector3 &compOne, const Vector3 &compTwo,
+        BasicMatrix3(const Vector3 &compOne, const Vector3 &compTwo,
             const Vector3 &compThree)
         {
             setComponents(compOne, compTwo, compThree);
@@ -992,7 +1191,7 @@ namespace cyclone {
         /**
          * Creates a new matrix with explicit coefficients.
          */
-        Matrix3(real c0, real c1, real c2, real c3, real c4, real c5,
+        BasicMatrix3(real c0, real c1, real c2, real c3, real c4, real c5,
             real c6, real c7, real c8)
         {
             data[0] = c0; data[1] = c1; data[2] = c2;
@@ -1079,11 +1278,19 @@ namespace cyclone {
          */
         Vector3 operator*(const Vector3 &vector) const
         {
+#ifdef CYCLONE_SIMD_BACKEND
+            Lanes v = Lanes::clearLast(vector.lanes());
+            return Vector3(Lanes::sum3(
+                Lanes::mul(Lanes::load3(data), v),
+                Lanes::mul(Lanes::load3(data + 3), v),
+                Lanes::mul(Lanes::load3(data + 6), v)));
+#else
             return Vector3(
                 vector.x * data[0] + vector.y * data[1] + vector.z * data[2],
                 vector.x * data[3] + vector.y * data[4] + vector.z * data[5],
                 vector.x * data[6] + vector.y * data[7] + vector.z * data[8]
             );
+#endif
         }
 
         /**
@@ -1103,11 +1310,23 @@ namespace cyclone {
          */
         Vector3 transformTranspose(const Vector3 &vector) const
         {
+#ifdef CYCLONE_SIMD_BACKEND
+            // The rows are loaded with a zero fourth lane, so the sum
+            // has one too.
+            Lanes result = Lanes::mul(Lanes::splat(vector.x),
+                Lanes::load3(data));
+            result = Lanes::add(result, Lanes::mul(Lanes::splat(vector.y),
+                Lanes::load3(data + 3)));
+            result = Lanes::add(result, Lanes::mul(Lanes::splat(vector.z),
+                Lanes::load3(data + 6)));
+            return Vector3(result);
+#else
             return Vector3(
                 vector.x * data[0] + vector.y * data[3] + vector.z * data[6],
                 vector.x * data[1] + vector.y * data[4] + vector.z * data[7],
                 vector.x * data[2] + vector.y * data[5] + vector.z * data[8]
             );
+#endif
         }
 
         /**
@@ -1139,6 +1358,36 @@ namespace cyclone {
          */
         void setInverse(const Matrix3 &m)
         {
+#ifdef CYCLONE_SIMD_BACKEND
+            // Each row of the inverse is the cross product of two
+            // columns, divided by the determinant. The cross products
+            // are worked out with a lane per component, from copies
+            // of the columns rotated by one and two places.
+            const real *d = m.data;
+            Lanes pyzx = Lanes::set(d[3], d[6], d[0], 0);
+            Lanes pzxy = Lanes::set(d[6], d[0], d[3], 0);
+            Lanes qyzx = Lanes::set(d[4], d[7], d[1], 0);
+            Lanes qzxy = Lanes::set(d[7], d[1], d[4], 0);
+            Lanes ryzx = Lanes::set(d[5], d[8], d[2], 0);
+            Lanes rzxy = Lanes::set(d[8], d[2], d[5], 0);
+
+            Lanes row0 = Lanes::sub(Lanes::mul(qyzx, rzxy),
+                Lanes::mul(qzxy, ryzx));
+            Lanes row1 = Lanes::sub(Lanes::mul(ryzx, pzxy),
+                Lanes::mul(rzxy, pyzx));
+            Lanes row2 = Lanes::sub(Lanes::mul(pyzx, qzxy),
+                Lanes::mul(pzxy, qyzx));
+
+            // Make sure the determinant is non-zero.
+            real det = Lanes::sum(Lanes::mul(row0,
+                Lanes::set(d[0], d[3], d[6], 0)));
+            if (det == (real)0.0f) return;
+            Lanes scale = Lanes::splat(1/det);
+
+            Lanes::storeUnaligned(data, Lanes::mul(row0, scale));
+            Lanes::storeUnaligned(data + 3, Lanes::mul(row1, scale));
+            Lanes::store3(data + 6, Lanes::mul(row2, scale));
+#else
             real t4 = m.data[0]*m.data[4];
             real t6 = m.data[0]*m.data[5];
             real t8 = m.data[1]*m.data[3];
@@ -1163,6 +1412,7 @@ namespace cyclone {
             data[6] = (m.data[3]*m.data[7]-m.data[4]*m.data[6])*t17;
             data[7] = -(m.data[0]*m.data[7]-t12)*t17;
             data[8] = (t4-t8)*t17;
+#endif
         }
 
         /** Returns a new matrix containing the inverse of this matrix. */
@@ -1233,6 +1483,28 @@ namespace cyclone {
          */
         void operator*=(const Matrix3 &o)
         {
+#ifdef CYCLONE_SIMD_BACKEND
+            // Each row of the product is a sum of the rows of the
+            // other matrix, scaled by a row of this one. All three
+            // are worked out before any is stored.
+            Lanes o0 = Lanes::load3(o.data);
+            Lanes o1 = Lanes::load3(o.data + 3);
+            Lanes o2 = Lanes::load3(o.data + 6);
+            Lanes rows[3];
+            for (unsigned i = 0; i < 3; i++)
+            {
+                const real *row = data + i*3;
+                rows[i] = Lanes::mul(Lanes::splat(row[0]), o0);
+                rows[i] = Lanes::add(rows[i], Lanes::mul(Lanes::splat(row[1]), o1));
+                rows[i] = Lanes::add(rows[i], Lanes::mul(Lanes::splat(row[2]), o2));
+            }
+
+            // The first two rows spill into the start of the next,
+            // which is then overwritten.
+            Lanes::storeUnaligned(data, rows[0]);
+            Lanes::storeUnaligned(data + 3, rows[1]);
+            Lanes::store3(data + 6, rows[2]);
+#else
             real t1;
             real t2;
             real t3;
@@ -1257,8 +1529,10 @@ namespace cyclone {
             data[6] = t1;
             data[7] = t2;
             data[8] = t3;
+#endif
         }
 
+
         /**
          * Multiplies this matrix in place by the given scalar.
          */
@@ -1303,6 +1577,14 @@ namespace cyclone {
         static Matrix3 linearInterpolate(const Matrix3& a, const Matrix3& b, real prop);
     };
 
+    /*
+     * The default precision types, used by the rest of Cyclone.
+     */
+    typedef BasicVector3<DefaultPrecision> Vector3;
+    typedef BasicQuaternion<DefaultPrecision> Quaternion;
+    typedef BasicMatrix4<DefaultPrecision> Matrix4;
+    typedef BasicMatrix3<DefaultPrecision> Matrix3;
+
 }
 
 #endif // CYCLONE_CORE_H
@@ -10,13 +10,19 @@
  * software licence.
  */
 #include "precision.h"
+#include "simd.h"
 #include "core.h"
 #include "random.h"
+#include "pool.h"
 #include "particle.h"
 #include "body.h"
 #include "pcontacts.h"
 #include "pworld.h"
+#include "pstore.h"
+#include "pxpbd.h"
 #include "collide_fine.h"
+#include "broadphase.h"
 #include "contacts.h"
 #include "fgen.h"
+#include "explosion.h"
 #include "joints.h"
\ No newline at end of file
@@ -0,0 +1,58 @@
+/*
+ * Implementation file for the explosion system.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+#include <explosion.h>
+
+using namespace cyclone;
+
+void ExplosionSystem::add(const Explosion &explosion)
+{
+    explosions.push_back(explosion);
+}
+
+void ExplosionSystem::clear()
+{
+    explosions.clear();
+}
+
+unsigned ExplosionSystem::getCount() const
+{
+    return (unsigned)explosions.size();
+}
+
+void ExplosionSystem::update(const AABBTree &tree, RigidBody *const *bodies,
+                             real duration)
+{
+    for (unsigned i = 0; i < explosions.size(); )
+    {
+        Explosion &explosion = explosions[i];
+
+        // Only bodies inside the current shell or chimney can feel it.
+        found.clear();
+        tree.query(explosion.getBounds(), found);
+        for (unsigned j = 0; j < found.size(); j++)
+        {
+            explosion.updateForce(bodies[found[j]], duration);
+        }
+
+        explosion.advance(duration);
+        if (explosion.isFinished())
+        {
+            explosions[i] = explosions.back();
+            explosions.pop_back();
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
@@ -0,0 +1,77 @@
+/*
+ * Interface file for the explosion system.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+/**
+ * @file
+ *
+ * This file contains a system that runs any number of explosions
+ * against a set of rigid bodies. Rather than registering every body
+ * with every explosion, each explosion looks up the bodies inside its
+ * current area of effect in a bounding volume tree.
+ */
+#ifndef CYCLONE_EXPLOSION_H
+#define CYCLONE_EXPLOSION_H
+
+#include <vector>
+#include "broadphase.h"
+#include "fgen.h"
+
+namespace cyclone {
+
+    /**
+     * Holds the explosions in progress, and applies their forces.
+     *
+     * The system keeps its own copies of the explosions it is given,
+     * and drops them once they have finished.
+     */
+    class ExplosionSystem
+    {
+    public:
+        /**
+         * Starts the given explosion.
+         */
+        void add(const Explosion &explosion);
+
+        /**
+         * Removes every explosion.
+         */
+        void clear();
+
+        /**
+         * Returns the number of explosions in progress.
+         */
+        unsigned getCount() const;
+
+        /**
+         * Applies the force of every explosion to the bodies near it,
+         * then moves the explosions on by the given time. The tree
+         * should hold the bounds of the bodies, with each body's
+         * index in the given array as its id.
+         */
+        void update(const AABBTree &tree, RigidBody *const *bodies,
+                    real duration);
+
+    protected:
+        /**
+         * Holds the explosions in progress.
+         */
+        std::vector<Explosion> explosions;
+
+        /**
+         * Holds the ids found by the last tree query.
+         */
+        std::vector<unsigned> found;
+    };
+
+} // namespace cyclone
+
+#endif // CYCLONE_EXPLOSION_H
@@ -11,24 +11,140 @@
  */
 
 #include <fgen.h>
+#include <algorithm>
+#include <typeindex>
 
 using namespace cyclone;
 
+void ForceGenerator::updateForces(RigidBody **bodies, unsigned count,
+                                  real duration)
+{
+    for (unsigned i = 0; i < count; i++)
+    {
+        updateForce(bodies[i], duration);
+    }
+}
+
+ForceRegistry::ForceRegistry()
+: sorted(true)
+{
+}
+
+void ForceRegistry::sort()
+{
+    // Keep generators of the same type together, in the order they
+    // were first registered.
+    std::stable_sort(groups.begin(), groups.end(),
+        [](const ForceGroup &a, const ForceGroup &b) {
+            return std::type_index(typeid(*a.fg)) <
+                std::type_index(typeid(*b.fg));
+        });
+
+    // Groups have moved, so their indices and slots need updating.
+    for (unsigned i = 0; i < groups.size(); i++)
+    {
+        groupIndex[groups[i].fg] = i;
+        for (unsigned j = 0; j < groups[i].handles.size(); j++)
+        {
+            slots[groups[i].handles[j]].group = i;
+        }
+    }
+    sorted = true;
+}
+
 void ForceRegistry::updateForces(real duration)
 {
-    Registry::iterator i = registrations.begin();
-    for (; i != registrations.end(); i++)
+    if (!sorted) sort();
+
+    Registry::iterator i = groups.begin();
+    for (; i != groups.end(); i++)
     {
-        i->fg->updateForce(i->body, duration);
+        if (i->bodies.empty()) continue;
+        i->fg->updateForces(i->bodies.data(),
+            (unsigned)i->bodies.size(), duration);
     }
 }
 
-void ForceRegistry::add(RigidBody *body, ForceGenerator *fg)
+ForceRegistry::Handle ForceRegistry::add(RigidBody *body, ForceGenerator *fg)
 {
-    ForceRegistry::ForceRegistration registration;
-    registration.body = body;
-    registration.fg = fg;
-    registrations.push_back(registration);
+    unsigned group;
+    std::unordered_map<ForceGenerator*, unsigned>::iterator found =
+        groupIndex.find(fg);
+    if (found == groupIndex.end())
+    {
+        group = (unsigned)groups.size();
+        groupIndex[fg] = group;
+        groups.push_back(ForceGroup());
+        groups.back().fg = fg;
+        sorted = false;
+    }
+    else
+    {
+        group = found->second;
+    }
+
+    Handle handle;
+    if (freeHandles.empty())
+    {
+        handle = (Handle)slots.size();
+        slots.push_back(Slot());
+    }
+    else
+    {
+        handle = freeHandles.back();
+        freeHandles.pop_back();
+    }
+
+    slots[handle].group = group;
+    slots[handle].index = (unsigned)groups[group].bodies.size();
+    groups[group].bodies.push_back(body);
+    groups[group].handles.push_back(handle);
+    return handle;
+}
+
+void ForceRegistry::remove(Handle handle)
+{
+    if (handle >= slots.size()) return;
+    Slot &slot = slots[handle];
+    if (slot.group == INVALID_HANDLE) return;
+
+    // Move the group's last registration into the gap.
+    ForceGroup &group = groups[slot.group];
+    Handle moved = group.handles.back();
+    group.bodies[slot.index] = group.bodies.back();
+    group.handles[slot.index] = moved;
+    slots[moved].index = slot.index;
+    group.bodies.pop_back();
+    group.handles.pop_back();
+
+    slot.group = INVALID_HANDLE;
+    freeHandles.push_back(handle);
+}
+
+void ForceRegistry::remove(RigidBody *body, ForceGenerator *fg)
+{
+    std::unordered_map<ForceGenerator*, unsigned>::iterator found =
+        groupIndex.find(fg);
+    if (found == groupIndex.end()) return;
+
+    ForceGroup &group = groups[found->second];
+    for (unsigned i = 0; i < group.bodies.size(); i++)
+    {
+        if (group.bodies[i] == body)
+        {
+            remove(group.handles[i]);
+            return;
+        }
+    }
+}
+
+void ForceRegistry::clear()
+{
+    groups.clear();
+    groupIndex.clear();
+    slots.clear();
+    freeHandles.clear();
+    sorted = true;
 }
 
 Buoyancy::Buoyancy(const Vector3 &cOfB, real maxDepth, real volume,
@@ -65,6 +181,15 @@ void Buoyancy::updateForce(RigidBody *body, real duration)
     body->addForceAtBodyPoint(force, centreOfBuoyancy);
 }
 
+void Buoyancy::updateForces(RigidBody **bodies, unsigned count,
+                            real duration)
+{
+    for (unsigned i = 0; i < count; i++)
+    {
+        Buoyancy::updateForce(bodies[i], duration);
+    }
+}
+
 Gravity::Gravity(const Vector3& gravity)
 : gravity(gravity)
 {
@@ -79,6 +204,16 @@ void Gravity::updateForce(RigidBody* body, real duration)
     body->addForce(gravity * body->getMass());
 }
 
+void Gravity::updateForces(RigidBody **bodies, unsigned count,
+                           real)
+{
+    for (unsigned i = 0; i < count; i++)
+    {
+        if (!bodies[i]->hasFiniteMass()) continue;
+        bodies[i]->addForce(gravity * bodies[i]->getMass());
+    }
+}
+
 Spring::Spring(const Vector3 &localConnectionPt,
                RigidBody *other,
                const Vector3 &otherConnectionPt,
@@ -124,6 +259,14 @@ void Aero::updateForce(RigidBody *body, real duration)
     Aero::updateForceFromTensor(body, duration, tensor);
 }
 
+void Aero::updateForces(RigidBody **bodies, unsigned count, real duration)
+{
+    for (unsigned i = 0; i < count; i++)
+    {
+        Aero::updateForceFromTensor(bodies[i], duration, tensor);
+    }
+}
+
 void Aero::updateForceFromTensor(RigidBody *body, real duration,
                                  const Matrix3 &tensor)
 {
@@ -178,7 +321,145 @@ void AeroControl::updateForce(RigidBody *body, real duration)
     Aero::updateForceFromTensor(body, duration, tensor);
 }
 
-void Explosion::updateForce(RigidBody* body, real duration)
+void AeroControl::updateForces(RigidBody **bodies, unsigned count,
+                               real duration)
+{
+    Matrix3 tensor = getTensor();
+    for (unsigned i = 0; i < count; i++)
+    {
+        Aero::updateForceFromTensor(bodies[i], duration, tensor);
+    }
+}
+
+Explosion::Explosion()
+: timePassed(0),
+  detonation(0, 0, 0),
+  implosionMaxRadius(10),
+  implosionMinRadius(2),
+  implosionDuration(0.1f),
+  implosionForce(500),
+  shockwaveSpeed(50),
+  shockwaveThickness(3),
+  peakConcussionForce(5000),
+  concussionDuration(0.5f),
+  peakConvectionForce(500),
+  chimneyRadius(5),
+  chimneyHeight(20),
+  convectionDuration(2)
+{
+}
+
+Vector3 Explosion::calculateForce(const Vector3 &position,
+                                  const Vector3 &velocity) const
+{
+    Vector3 force;
+    Vector3 offset = position - detonation;
+    real distance = offset.magnitude();
+
+    // Implosion: objects in a ring around the detonation are drawn
+    // in towards it.
+    if (timePassed < implosionDuration &&
+        distance > implosionMinRadius && distance < implosionMaxRadius)
+    {
+        force.addScaledVector(offset, -implosionForce / distance);
+    }
+
+    // Concussion: a shell moving out from the detonation pushes
+    // objects outwards, hardest at the middle of the shell, and
+    // hardest on objects that aren't already moving away.
+    real concussionTime = timePassed - implosionDuration;
+    if (concussionTime >= 0 && concussionTime < concussionDuration &&
+        distance > 0)
+    {
+        real front = shockwaveSpeed * concussionTime;
+        real halfThickness = shockwaveThickness * 0.5f;
+        real fromFront = real_abs(distance - front);
+        if (fromFront < halfThickness)
+        {
+            Vector3 direction = offset * (((real)1.0) / distance);
+            real closing = ((real)1.0) - (velocity * direction) / shockwaveSpeed;
+            if (closing < 0) closing = 0;
+            if (closing > 2) closing = 2;
+
+            real strength = peakConcussionForce *
+                (((real)1.0) - fromFront / halfThickness) *
+                (((real)1.0) - concussionTime / concussionDuration) *
+                closing;
+            force.addScaledVector(direction, strength);
+        }
+    }
+
+    // Convection: hot air rising in a chimney above the detonation
+    // lifts whatever is inside it.
+    if (timePassed < convectionDuration &&
+        offset.y >= 0 && offset.y <= chimneyHeight)
+    {
+        real across = real_sqrt(offset.x*offset.x + offset.z*offset.z);
+        if (across < chimneyRadius)
+        {
+            force.y += peakConvectionForce *
+                (((real)1.0) - across / chimneyRadius) *
+                (((real)1.0) - timePassed / convectionDuration);
+        }
+    }
+
+    return force;
+}
+
+AABB Explosion::getBounds() const
+{
+    AABB bounds;
+    if (timePassed < implosionDuration)
+    {
+        bounds.enclose(AABB::fromSphere(detonation, implosionMaxRadius));
+    }
+
+    real concussionTime = timePassed - implosionDuration;
+    if (concussionTime >= 0 && concussionTime < concussionDuration)
+    {
+        bounds.enclose(AABB::fromSphere(detonation,
+            shockwaveSpeed * concussionTime + shockwaveThickness * 0.5f));
+    }
+
+    if (timePassed < convectionDuration)
+    {
+        bounds.enclose(AABB(
+            detonation - Vector3(chimneyRadius, 0, chimneyRadius),
+            detonation + Vector3(chimneyRadius, chimneyHeight, chimneyRadius)
+            ));
+    }
+    return bounds;
+}
+
+void Explosion::advance(real duration)
+{
+    timePassed += duration;
+}
+
+bool Explosion::isFinished() const
+{
+    return timePassed >= implosionDuration + concussionDuration &&
+        timePassed >= convectionDuration;
+}
+
+real Explosion::getTimePassed() const
+{
+    return timePassed;
+}
+
+void Explosion::updateForce(RigidBody* body, real)
+{
+    if (!body->hasFiniteMass()) return;
+
+    Vector3 force = calculateForce(body->getPosition(), body->getVelocity());
+    body->addForce(force);
+}
+
+void Explosion::updateForce(Particle* particle, real)
 {
+    if (!particle->hasFiniteMass()) return;
 
+    Vector3 force = calculateForce(particle->getPosition(),
+        particle->getVelocity());
+    particle->addForce(force);
 }
\ No newline at end of file
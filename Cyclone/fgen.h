@@ -19,7 +19,9 @@
 #define CYCLONE_FGEN_H
 
 #include "body.h"
+#include "broadphase.h"
 #include "pfgen.h"
+#include <unordered_map>
 #include <vector>
 
 namespace cyclone {
@@ -31,12 +33,22 @@ namespace cyclone {
     class ForceGenerator
     {
     public:
+        virtual ~ForceGenerator() = default;
 
         /**
          * Overload this in implementations of the interface to calculate
          * and update the force applied to the given rigid body.
          */
         virtual void updateForce(RigidBody *body, real duration) = 0;
+
+        /**
+         * Calculates and updates the force applied to each of the
+         * given rigid bodies. By default this calls updateForce for
+         * each one; generators that can do the whole batch faster
+         * should overload it.
+         */
+        virtual void updateForces(RigidBody **bodies, unsigned count,
+            real duration);
     };
 
     /**
@@ -55,6 +67,10 @@ namespace cyclone {
 
         /** Applies the gravitational force to the given rigid body. */
         virtual void updateForce(RigidBody *body, real duration);
+
+        /** Applies the gravitational force to each given rigid body. */
+        virtual void updateForces(RigidBody **bodies, unsigned count,
+            real duration);
     };
 
     /**
@@ -101,6 +117,10 @@ namespace cyclone {
      * This force generator is intended to represent a single
      * explosion effect for multiple rigid bodies. The force generator
      * can also act as a particle force generator.
+     *
+     * The explosion doesn't know how often it is asked for forces, so
+     * it doesn't move its own clock on: call advance once per step,
+     * after its forces have been applied.
      */
     class Explosion : public ForceGenerator,
                       public ParticleForceGenerator
@@ -223,8 +243,37 @@ namespace cyclone {
          * Calculates and applies the force that the explosion has
          * on the given particle.
          */
-        virtual void updateForce(Particle *particle, real duration) = 0;
+        virtual void updateForce(Particle *particle, real duration);
 
+        /**
+         * Returns the force the explosion currently has on an object
+         * at the given position, moving at the given velocity.
+         */
+        Vector3 calculateForce(const Vector3 &position,
+            const Vector3 &velocity) const;
+
+        /**
+         * Returns a box enclosing every point the explosion can
+         * currently push on. Objects outside it feel no force, so
+         * only objects found by querying a broadphase with it need
+         * to be passed to updateForce.
+         */
+        AABB getBounds() const;
+
+        /**
+         * Moves the explosion on by the given time.
+         */
+        void advance(real duration);
+
+        /**
+         * Returns true once every phase of the explosion is over.
+         */
+        bool isFinished() const;
+
+        /**
+         * Returns how long the explosion has been in operation.
+         */
+        real getTimePassed() const;
     };
 
     /**
@@ -266,6 +315,12 @@ namespace cyclone {
          */
         virtual void updateForce(RigidBody *body, real duration);
 
+        /**
+         * Applies the force to each given rigid body.
+         */
+        virtual void updateForces(RigidBody **bodies, unsigned count,
+            real duration);
+
     protected:
         /**
          * Uses an explicit tensor matrix to update the force on
@@ -335,6 +390,13 @@ namespace cyclone {
          * Applies the force to the given rigid body.
          */
         virtual void updateForce(RigidBody *body, real duration);
+
+        /**
+         * Applies the force to each given rigid body, working out
+         * the control tensor once for the whole batch.
+         */
+        virtual void updateForces(RigidBody **bodies, unsigned count,
+            real duration);
     };
 
     /**
@@ -414,45 +476,114 @@ namespace cyclone {
          * Applies the force to the given rigid body.
          */
         virtual void updateForce(RigidBody *body, real duration);
+
+        /**
+         * Applies the force to each given rigid body.
+         */
+        virtual void updateForces(RigidBody **bodies, unsigned count,
+            real duration);
     };
 
     /**
     * Holds all the force generators and the bodies they apply to.
+    *
+    * Registrations are grouped by generator, so each generator is
+    * called once per update with all of its bodies, and the groups
+    * are kept sorted by the type of their generator. Each
+    * registration has a handle, which removes it in constant time.
     */
     class ForceRegistry
     {
+    public:
+        /**
+        * Identifies one registration.
+        */
+        typedef unsigned Handle;
+
+        /**
+        * A handle that never refers to a registration.
+        */
+        static const Handle INVALID_HANDLE = ~0u;
+
     protected:
 
         /**
-        * Keeps track of one force generator and the body it
-        * applies to.
+        * Keeps track of one force generator and the bodies it
+        * applies to. The handles are those of the registrations
+        * for each body.
         */
-        struct ForceRegistration
+        struct ForceGroup
         {
-            RigidBody *body;
             ForceGenerator *fg;
+            std::vector<RigidBody*> bodies;
+            std::vector<Handle> handles;
+        };
+
+        /**
+        * Holds where a handle's registration is: its group, and
+        * its place in that group.
+        */
+        struct Slot
+        {
+            unsigned group;
+            unsigned index;
         };
 
         /**
-        * Holds the list of registrations.
+        * Holds the list of groups.
+        */
+        typedef std::vector<ForceGroup> Registry;
+        Registry groups;
+
+        /**
+        * Holds the index in the groups list of each generator.
+        */
+        std::unordered_map<ForceGenerator*, unsigned> groupIndex;
+
+        /**
+        * Holds the slot of each handle, and the handles that are
+        * free to be reused.
+        */
+        std::vector<Slot> slots;
+        std::vector<Handle> freeHandles;
+
+        /**
+        * True if groups have been added since they were last
+        * sorted by type.
+        */
+        bool sorted;
+
+        /**
+        * Sorts the groups by the type of their generator.
         */
-        typedef std::vector<ForceRegistration> Registry;
-        Registry registrations;
+        void sort();
 
     public:
+        /**
+        * Creates an empty registry.
+        */
+        ForceRegistry();
+
         /**
         * Registers the given force generator to apply to the
-        * given body.
+        * given body, and returns the handle of the registration.
         */
-        void add(RigidBody* body, ForceGenerator *fg);
+        Handle add(RigidBody* body, ForceGenerator *fg);
 
         /**
         * Removes the given registered pair from the registry.
         * If the pair is not registered, this method will have
-        * no effect.
+        * no effect. This has to search the generator's bodies:
+        * removing by handle is faster.
         */
         void remove(RigidBody* body, ForceGenerator *fg);
 
+        /**
+        * Removes the registration with the given handle. The
+        * handle may be reused by a later registration.
+        */
+        void remove(Handle handle);
+
         /**
         * Clears all registrations from the registry. This will
         * not delete the bodies or the force generators
@@ -11,6 +11,7 @@
  */
 
 #include <pcontacts.h>
+#include <algorithm>
 
 using namespace cyclone;
 
@@ -134,58 +135,155 @@ void ParticleContactResolver::setIterations(unsigned iterations)
     ParticleContactResolver::iterations = iterations;
 }
 
+real ParticleContactResolver::calculatePriority(
+    const ParticleContact &contact) const
+{
+    real sepVel = contact.calculateSeparatingVelocity();
+    if (sepVel < 0 || contact.penetration > 0) return sepVel;
+    return REAL_MAX;
+}
+
+bool ParticleContactResolver::isBefore(unsigned a, unsigned b) const
+{
+    // Ties go to the earlier contact, as a scan from the start would.
+    if (priority[a] != priority[b]) return priority[a] < priority[b];
+    return a < b;
+}
+
+void ParticleContactResolver::siftUp(unsigned position)
+{
+    unsigned index = heap[position];
+    while (position > 0)
+    {
+        unsigned parent = (position - 1) / 2;
+        if (!isBefore(index, heap[parent])) break;
+        heap[position] = heap[parent];
+        heapPosition[heap[position]] = position;
+        position = parent;
+    }
+    heap[position] = index;
+    heapPosition[index] = position;
+}
+
+void ParticleContactResolver::siftDown(unsigned position)
+{
+    unsigned index = heap[position];
+    unsigned size = (unsigned)heap.size();
+    for (;;)
+    {
+        unsigned child = position * 2 + 1;
+        if (child >= size) break;
+        if (child + 1 < size && isBefore(heap[child + 1], heap[child]))
+        {
+            child++;
+        }
+        if (!isBefore(heap[child], index)) break;
+        heap[position] = heap[child];
+        heapPosition[heap[position]] = position;
+        position = child;
+    }
+    heap[position] = index;
+    heapPosition[index] = position;
+}
+
+void ParticleContactResolver::updatePriority(ParticleContact *contactArray,
+                                             unsigned index)
+{
+    real old = priority[index];
+    priority[index] = calculatePriority(contactArray[index]);
+    if (priority[index] < old) siftUp(heapPosition[index]);
+    else if (priority[index] > old) siftDown(heapPosition[index]);
+}
+
+void ParticleContactResolver::buildAdjacency(ParticleContact *contactArray,
+                                             unsigned numContacts)
+{
+    ends.clear();
+    for (unsigned i = 0; i < numContacts; i++)
+    {
+        ends.push_back(std::make_pair(contactArray[i].particle[0], i * 2));
+        if (contactArray[i].particle[1])
+        {
+            ends.push_back(
+                std::make_pair(contactArray[i].particle[1], i * 2 + 1));
+        }
+    }
+    std::sort(ends.begin(), ends.end());
+
+    groupStart.resize(numContacts * 2);
+    unsigned start = 0;
+    for (unsigned k = 0; k < ends.size(); k++)
+    {
+        if (ends[k].first != ends[start].first) start = k;
+        groupStart[ends[k].second] = start;
+    }
+}
+
 void ParticleContactResolver::resolveContacts(ParticleContact *contactArray,
                                               unsigned numContacts,
                                               real duration)
 {
-    unsigned i;
-
     iterationsUsed = 0;
+    if (numContacts == 0) return;
+
+    buildAdjacency(contactArray, numContacts);
+
+    // Put every contact in the heap.
+    priority.resize(numContacts);
+    heap.resize(numContacts);
+    heapPosition.resize(numContacts);
+    for (unsigned i = 0; i < numContacts; i++)
+    {
+        priority[i] = calculatePriority(contactArray[i]);
+        heap[i] = i;
+        heapPosition[i] = i;
+    }
+    for (unsigned i = numContacts / 2; i > 0; i--) siftDown(i - 1);
+
     while(iterationsUsed < iterations)
     {
-        // Find the contact with the largest closing velocity;
-        real max = REAL_MAX;
-        unsigned maxIndex = numContacts;
-        for (i = 0; i < numContacts; i++)
-        {
-            real sepVel = contactArray[i].calculateSeparatingVelocity();
-            if (sepVel < max &&
-                (sepVel < 0 || contactArray[i].penetration > 0))
-            {
-                max = sepVel;
-                maxIndex = i;
-            }
-        }
+        // The contact with the largest closing velocity is at the front.
+        unsigned maxIndex = heap[0];
 
         // Do we have anything worth resolving?
-        if (maxIndex == numContacts) break;
+        if (priority[maxIndex] == REAL_MAX) break;
 
         // Resolve this contact
-        contactArray[maxIndex].resolve(duration);
+        ParticleContact &resolved = contactArray[maxIndex];
+        resolved.resolve(duration);
 
-        // Update the interpenetrations for all particles
-        Vector3 *move = contactArray[maxIndex].particleMovement;
-        for (i = 0; i < numContacts; i++)
+        // Update the interpenetrations and priorities of every contact
+        // that shares a particle with this one.
+        for (unsigned end = 0; end < 2; end++)
         {
-            if (contactArray[i].particle[0] == contactArray[maxIndex].particle[0])
-            {
-                contactArray[i].penetration -= move[0] * contactArray[i].contactNormal;
-            }
-            else if (contactArray[i].particle[0] == contactArray[maxIndex].particle[1])
-            {
-                contactArray[i].penetration -= move[1] * contactArray[i].contactNormal;
-            }
-            if (contactArray[i].particle[1])
+            Particle *particle = resolved.particle[end];
+            if (!particle) continue;
+
+            // A contact between a particle and itself would be
+            // visited twice.
+            if (end == 1 && particle == resolved.particle[0]) continue;
+
+            const Vector3 &move = resolved.particleMovement[end];
+            for (unsigned k = groupStart[maxIndex * 2 + end];
+                k < ends.size() && ends[k].first == particle;
+                k++)
             {
-                if (contactArray[i].particle[1] == contactArray[maxIndex].particle[0])
+                ParticleContact &other = contactArray[ends[k].second / 2];
+                if (ends[k].second & 1)
                 {
-                    contactArray[i].penetration += move[0] * contactArray[i].contactNormal;
+                    other.penetration += move * other.contactNormal;
                 }
-                else if (contactArray[i].particle[1] == contactArray[maxIndex].particle[1])
+                else
                 {
-                    contactArray[i].penetration += move[1] * contactArray[i].contactNormal;
+                    other.penetration -= move * other.contactNormal;
                 }
             }
+            for (unsigned k = groupStart[maxIndex * 2 + end];
+                k < ends.size() && ends[k].first == particle;
+                k++)
+            {
+                updatePriority(contactArray, ends[k].second / 2);
+            }
         }
 
         iterationsUsed++;
@@ -24,6 +24,8 @@
 #ifndef CYCLONE_PCONTACTS_H
 #define CYCLONE_PCONTACTS_H
 
+#include <utility>
+#include <vector>
 #include "particle.h"
 
 namespace cyclone {
@@ -111,6 +113,14 @@ namespace cyclone {
     /**
      * The contact resolution routine for particle contacts. One
      * resolver instance can be shared for the whole simulation.
+     *
+     * Each iteration resolves the contact with the largest closing
+     * velocity. Rather than scanning every contact to find it, the
+     * resolver keeps the contacts in a heap, and indexes which
+     * contacts touch each particle. Resolving a contact then only
+     * updates the contacts that share one of its particles, so an
+     * iteration costs time in proportion to the number of those
+     * neighbours, not to the total number of contacts.
      */
     class ParticleContactResolver
     {
@@ -126,6 +136,76 @@ namespace cyclone {
          */
         unsigned iterationsUsed;
 
+        /**
+         * @name Working Data
+         *
+         * These are rebuilt by each call to resolveContacts. They are
+         * kept between calls so their storage is reused.
+         */
+        /*@{*/
+
+        /**
+         * Holds each end of each contact, as its particle and the
+         * contact index times two plus the end. Sorted by particle,
+         * this groups the contacts that touch each particle.
+         */
+        std::vector< std::pair<Particle*, unsigned> > ends;
+
+        /**
+         * Holds, for each contact end, the index in the ends array of
+         * the first end with the same particle.
+         */
+        std::vector<unsigned> groupStart;
+
+        /**
+         * Holds the contacts in heap order, with the contact to
+         * resolve next at the front.
+         */
+        std::vector<unsigned> heap;
+
+        /**
+         * Holds the position of each contact in the heap.
+         */
+        std::vector<unsigned> heapPosition;
+
+        /**
+         * Holds the priority of each contact: its separating
+         * velocity, or REAL_MAX if it needs no resolution.
+         */
+        std::vector<real> priority;
+
+        /*@}*/
+
+        /**
+         * Builds the particle to contact index for the given contacts.
+         */
+        void buildAdjacency(ParticleContact *contactArray,
+            unsigned numContacts);
+
+        /**
+         * Works out the priority of the given contact.
+         */
+        real calculatePriority(const ParticleContact &contact) const;
+
+        /**
+         * Returns true if the first contact should be resolved
+         * before the second.
+         */
+        bool isBefore(unsigned a, unsigned b) const;
+
+        /**
+         * Moves the contact at the given heap position towards the
+         * front or back of the heap until it is in order.
+         */
+        void siftUp(unsigned position);
+        void siftDown(unsigned position);
+
+        /**
+         * Recalculates the priority of the given contact and
+         * restores the heap order.
+         */
+        void updatePriority(ParticleContact *contactArray, unsigned index);
+
     public:
         /**
          * Creates a new contact resolver.
@@ -11,25 +11,130 @@
  */
 
 #include <pfgen.h>
+#include <algorithm>
+#include <typeindex>
 
 using namespace cyclone;
 
+/**
+ * Adds the given acceleration, scaled by each particle's mass, to one
+ * axis of the forces of a set of particles. Particles with infinite
+ * mass get no force.
+ */
+static void addMassScaled(real *__restrict force,
+                          const real *__restrict inverseMass,
+                          unsigned count, real acceleration)
+{
+    for (unsigned i = 0; i < count; i++)
+    {
+        real movable = inverseMass[i] > 0 ? (real)1 : (real)0;
+        real safe = inverseMass[i] + ((real)1 - movable);
+        force[i] += acceleration * movable / safe;
+    }
+}
+
+/**
+ * Adds a drag force to a set of particles. The drag is along the
+ * velocity, so scaling the velocity itself saves normalising it.
+ */
+static void addDrag(real *__restrict fx, real *__restrict fy,
+                    real *__restrict fz, const real *__restrict vx,
+                    const real *__restrict vy, const real *__restrict vz,
+                    unsigned count, real k1, real k2)
+{
+    for (unsigned i = 0; i < count; i++)
+    {
+        real speed = real_sqrt(vx[i]*vx[i] + vy[i]*vy[i] + vz[i]*vz[i]);
+        real scale = -(k1 + k2 * speed);
+        fx[i] += vx[i] * scale;
+        fy[i] += vy[i] * scale;
+        fz[i] += vz[i] * scale;
+    }
+}
+
+
+void ParticleForceGenerator::updateForces(Particle **particles,
+                                          unsigned count, real duration)
+{
+    for (unsigned i = 0; i < count; i++)
+    {
+        updateForce(particles[i], duration);
+    }
+}
+
+void ParticleForceGenerator::updateForces(ParticleStore &, real)
+{
+}
+
+ParticleForceRegistry::ParticleForceRegistry()
+: sorted(true)
+{
+}
+
+void ParticleForceRegistry::sort()
+{
+    // Keep generators of the same type together, in the order they
+    // were first registered.
+    std::stable_sort(groups.begin(), groups.end(),
+        [](const ParticleForceGroup &a, const ParticleForceGroup &b) {
+            return std::type_index(typeid(*a.fg)) <
+                std::type_index(typeid(*b.fg));
+        });
+
+    for (unsigned i = 0; i < groups.size(); i++)
+    {
+        groupIndex[groups[i].fg] = i;
+    }
+    sorted = true;
+}
 
 void ParticleForceRegistry::updateForces(real duration)
 {
-    Registry::iterator i = registrations.begin();
-    for (; i != registrations.end(); i++)
+    if (!sorted) sort();
+
+    Registry::iterator i = groups.begin();
+    for (; i != groups.end(); i++)
     {
-        i->fg->updateForce(i->particle, duration);
+        if (i->particles.empty()) continue;
+        i->fg->updateForces(i->particles.data(),
+            (unsigned)i->particles.size(), duration);
     }
 }
 
 void ParticleForceRegistry::add(Particle* particle, ParticleForceGenerator *fg)
 {
-    ParticleForceRegistry::ParticleForceRegistration registration;
-    registration.particle = particle;
-    registration.fg = fg;
-    registrations.push_back(registration);
+    std::unordered_map<ParticleForceGenerator*, unsigned>::iterator found =
+        groupIndex.find(fg);
+    if (found == groupIndex.end())
+    {
+        groupIndex[fg] = (unsigned)groups.size();
+        groups.push_back(ParticleForceGroup());
+        groups.back().fg = fg;
+        groups.back().particles.push_back(particle);
+        sorted = false;
+        return;
+    }
+    groups[found->second].particles.push_back(particle);
+}
+
+void ParticleForceRegistry::remove(Particle* particle,
+                                   ParticleForceGenerator *fg)
+{
+    std::unordered_map<ParticleForceGenerator*, unsigned>::iterator found =
+        groupIndex.find(fg);
+    if (found == groupIndex.end()) return;
+
+    std::vector<Particle*> &particles = groups[found->second].particles;
+    std::vector<Particle*>::iterator p =
+        std::find(particles.begin(), particles.end(), particle);
+    if (p != particles.end()) particles.erase(p);
+}
+
+void ParticleForceRegistry::clear()
+{
+    groups.clear();
+    groupIndex.clear();
+    sorted = true;
 }
 
 ParticleGravity::ParticleGravity(const Vector3& gravity)
@@ -46,6 +151,27 @@ void ParticleGravity::updateForce(Particle* particle, real duration)
     particle->addForce(gravity * particle->getMass());
 }
 
+void ParticleGravity::updateForces(Particle **particles, unsigned count,
+                                   real)
+{
+    for (unsigned i = 0; i < count; i++)
+    {
+        if (!particles[i]->hasFiniteMass()) continue;
+        particles[i]->addForce(gravity * particles[i]->getMass());
+    }
+}
+
+void ParticleGravity::updateForces(ParticleStore &store, real)
+{
+    unsigned count = store.getSize();
+    addMassScaled(store.getForceX(), store.getInverseMasses(), count,
+        gravity.x);
+    addMassScaled(store.getForceY(), store.getInverseMasses(), count,
+        gravity.y);
+    addMassScaled(store.getForceZ(), store.getInverseMasses(), count,
+        gravity.z);
+}
+
 ParticleDrag::ParticleDrag(real k1, real k2)
 : k1(k1), k2(k2)
 {
@@ -66,6 +192,24 @@ void ParticleDrag::updateForce(Particle* particle, real duration)
     particle->addForce(force);
 }
 
+void ParticleDrag::updateForces(Particle **particles, unsigned count,
+                                real)
+{
+    for (unsigned i = 0; i < count; i++)
+    {
+        Vector3 velocity = particles[i]->getVelocity();
+        real speed = velocity.magnitude();
+        particles[i]->addForce(velocity * -(k1 + k2 * speed));
+    }
+}
+
+void ParticleDrag::updateForces(ParticleStore &store, real)
+{
+    addDrag(store.getForceX(), store.getForceY(), store.getForceZ(),
+        store.getVelocityX(), store.getVelocityY(), store.getVelocityZ(),
+        store.getSize(), k1, k2);
+}
+
 ParticleSpring::ParticleSpring(Particle *other, real sc, real rl)
 : other(other), springConstant(sc), restLength(rl)
 {
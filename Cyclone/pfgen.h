@@ -20,6 +20,8 @@
 
 #include "core.h"
 #include "particle.h"
+#include "pstore.h"
+#include <unordered_map>
 #include <vector>
 
 namespace cyclone {
@@ -38,6 +40,23 @@ namespace cyclone {
          * and update the force applied to the given particle.
          */
         virtual void updateForce(Particle *particle, real duration) = 0;
+
+        /**
+         * Calculates and updates the force applied to each of the
+         * given particles. By default this calls updateForce for each
+         * one; generators that can do the whole batch faster should
+         * overload it.
+         */
+        virtual void updateForces(Particle **particles, unsigned count,
+            real duration);
+
+        /**
+         * Calculates and updates the force applied to every particle
+         * in the given store. Only generators that act on particles
+         * independently of each other can do this, so by default it
+         * does nothing.
+         */
+        virtual void updateForces(ParticleStore &store, real duration);
     };
 
     /**
@@ -56,6 +75,16 @@ namespace cyclone {
 
         /** Applies the gravitational force to the given particle. */
         virtual void updateForce(Particle *particle, real duration);
+
+        /** Applies the gravitational force to each given particle. */
+        virtual void updateForces(Particle **particles, unsigned count,
+            real duration);
+
+        /**
+         * Applies the gravitational force to every particle in the
+         * given store, in one pass over its arrays.
+         */
+        virtual void updateForces(ParticleStore &store, real duration);
     };
 
     /**
@@ -77,6 +106,16 @@ namespace cyclone {
 
         /** Applies the drag force to the given particle. */
         virtual void updateForce(Particle *particle, real duration);
+
+        /** Applies the drag force to each given particle. */
+        virtual void updateForces(Particle **particles, unsigned count,
+            real duration);
+
+        /**
+         * Applies the drag force to every particle in the given
+         * store, in one pass over its arrays.
+         */
+        virtual void updateForces(ParticleStore &store, real duration);
     };
 
     /**
@@ -244,28 +283,54 @@ namespace cyclone {
 
     /**
      * Holds all the force generators and the particles they apply to.
+     *
+     * Registrations are grouped by generator, so each generator is
+     * called once per update with all of its particles. The groups
+     * are kept sorted by the type of their generator, so that, for
+     * example, all the springs run one after another.
      */
     class ParticleForceRegistry
     {
     protected:
 
         /**
-         * Keeps track of one force generator and the particle it
+         * Keeps track of one force generator and the particles it
          * applies to.
          */
-        struct ParticleForceRegistration
+        struct ParticleForceGroup
         {
-            Particle *particle;
             ParticleForceGenerator *fg;
+            std::vector<Particle*> particles;
         };
 
         /**
-         * Holds the list of registrations.
+         * Holds the list of groups.
+         */
+        typedef std::vector<ParticleForceGroup> Registry;
+        Registry groups;
+
+        /**
+         * Holds the index in the groups list of each generator.
+         */
+        std::unordered_map<ParticleForceGenerator*, unsigned> groupIndex;
+
+        /**
+         * True if groups have been added since they were last
+         * sorted by type.
          */
-        typedef std::vector<ParticleForceRegistration> Registry;
-        Registry registrations;
+        bool sorted;
+
+        /**
+         * Sorts the groups by the type of their generator.
+         */
+        void sort();
 
     public:
+        /**
+         * Creates an empty registry.
+         */
+        ParticleForceRegistry();
+
         /**
          * Registers the given force generator to apply to the
          * given particle.
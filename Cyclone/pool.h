@@ -0,0 +1,204 @@
+/*
+ * Interface file for the object pool.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+/**
+ * @file
+ *
+ * This file contains a pool that hands out objects of one type from
+ * large slabs of memory, rather than allocating each one on the heap.
+ * Objects created one after another sit next to each other, and the
+ * whole pool can be emptied in one step.
+ */
+#ifndef CYCLONE_POOL_H
+#define CYCLONE_POOL_H
+
+#include <assert.h>
+#include <stddef.h>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace cyclone {
+
+    /**
+     * Holds objects of one type in cache line aligned slabs.
+     *
+     * Objects are created in order through each slab, so a run of
+     * objects created together is contiguous in memory. Destroyed
+     * objects go on a free list and their slots are used again before
+     * any new ones. Slabs are only released when the pool is
+     * destroyed; rewinding the pool keeps them for the next objects.
+     *
+     * The pool hands out raw pointers, and the caller decides when
+     * each object is destroyed. Objects still alive when the pool is
+     * destroyed or rewound have their memory reclaimed without their
+     * destructors being run, so this is only safe for types whose
+     * destructors do nothing, such as RigidBody.
+     */
+    template <class T>
+    class ObjectPool
+    {
+    public:
+        /**
+         * Creates an empty pool, which will allocate slabs of the
+         * given number of objects as they are needed.
+         */
+        explicit ObjectPool(unsigned objectsPerSlab = 256)
+            : objectsPerSlab(objectsPerSlab), slab(0), used(0),
+            freeList(0), live(0)
+        {
+            assert(objectsPerSlab > 0);
+        }
+
+        /**
+         * Releases every slab.
+         */
+        ~ObjectPool()
+        {
+            for (unsigned i = 0; i < slabs.size(); i++)
+            {
+                ::operator delete(slabs[i], std::align_val_t(SLAB_ALIGNMENT));
+            }
+        }
+
+        /**
+         * Creates an object in the pool, passing the given arguments
+         * to its constructor.
+         */
+        template <class... Args>
+        T *create(Args&&... args)
+        {
+            Slot *slot = takeSlot();
+            live++;
+            return new (slot->storage) T(std::forward<Args>(args)...);
+        }
+
+        /**
+         * Destroys an object created by this pool, and keeps its slot
+         * for the next object created.
+         */
+        void destroy(T *object)
+        {
+            if (!object) return;
+            assert(live > 0);
+
+            object->~T();
+            Slot *slot = reinterpret_cast<Slot*>(object);
+            slot->next = freeList;
+            freeList = slot;
+            live--;
+        }
+
+        /**
+         * Empties the pool in constant time, keeping its slabs. The
+         * next objects created fill the slabs again from the start.
+         *
+         * Any objects still alive are forgotten without being
+         * destroyed, so for types with non-trivial destructors they
+         * must all have been destroyed first.
+         */
+        void rewind()
+        {
+            assert(live == 0 || std::is_trivially_destructible<T>::value);
+            slab = 0;
+            used = 0;
+            freeList = 0;
+            live = 0;
+        }
+
+        /**
+         * Returns the number of objects alive in the pool.
+         */
+        unsigned getLiveCount() const
+        {
+            return live;
+        }
+
+        /**
+         * Returns the number of objects the allocated slabs can hold.
+         */
+        unsigned getCapacity() const
+        {
+            return (unsigned)slabs.size() * objectsPerSlab;
+        }
+
+    private:
+        /**
+         * The alignment of each slab: a cache line, or more if the
+         * type needs it.
+         */
+        static const size_t SLAB_ALIGNMENT =
+            alignof(T) > 64 ? alignof(T) : 64;
+
+        /**
+         * Holds one object, or the link to the next free slot once
+         * the object has been destroyed.
+         */
+        union Slot
+        {
+            Slot *next;
+            alignas(T) unsigned char storage[sizeof(T)];
+        };
+
+        /** Holds the number of objects in each slab. */
+        unsigned objectsPerSlab;
+
+        /** Holds every slab allocated, in order. */
+        std::vector<Slot*> slabs;
+
+        /** Holds the index of the slab being filled. */
+        unsigned slab;
+
+        /** Holds the number of slots used in the slab being filled. */
+        unsigned used;
+
+        /** Holds the most recently freed slot, or NULL. */
+        Slot *freeList;
+
+        /** Holds the number of objects alive. */
+        unsigned live;
+
+        /**
+         * Returns a slot for a new object: a freed one if there is
+         * one, otherwise the next in the slabs.
+         */
+        Slot *takeSlot()
+        {
+            if (freeList)
+            {
+                Slot *slot = freeList;
+                freeList = slot->next;
+                return slot;
+            }
+
+            if (used == objectsPerSlab)
+            {
+                slab++;
+                used = 0;
+            }
+            if (slab == slabs.size())
+            {
+                slabs.push_back(static_cast<Slot*>(::operator new(
+                    sizeof(Slot) * objectsPerSlab,
+                    std::align_val_t(SLAB_ALIGNMENT))));
+            }
+            return &slabs[slab][used++];
+        }
+
+        ObjectPool(const ObjectPool &);
+        ObjectPool &operator=(const ObjectPool &);
+    };
+
+} // namespace cyclone
+
+#endif // CYCLONE_POOL_H
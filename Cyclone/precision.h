@@ -19,16 +19,69 @@
  * in the source code or headers. This file provides defines for
  * the real number type and mathematical formulae that work on it.
  *
- * @note All the contents of this file need to be changed to compile
- * Cyclone at a different precision.
+ * The core mathematical types and rigid bodies are templates on a
+ * precision policy, SinglePrecision or DoublePrecision, so both can be
+ * used in the same program. The real type and the defines below pick
+ * the default policy, which the rest of Cyclone is built on.
+ *
+ * @note All the contents of the conditional block need to be changed
+ * to compile Cyclone at a different default precision.
  */
 #ifndef CYCLONE_PRECISION_H
 #define CYCLONE_PRECISION_H
 
 #include <float.h>
+#include <math.h>
 
 namespace cyclone {
 
+    /**
+     * A precision policy for single precision: the real number type
+     * and the mathematical functions that work on it. A policy is
+     * passed to the templated types, such as BasicVector3, in place of
+     * the real typedef and the real_ defines.
+     */
+    struct SinglePrecision
+    {
+        typedef float real;
+
+        static real sqrt(real a) { return sqrtf(a); }
+        static real abs(real a) { return fabsf(a); }
+        static real sin(real a) { return sinf(a); }
+        static real cos(real a) { return cosf(a); }
+        static real exp(real a) { return expf(a); }
+        static real pow(real a, real b) { return powf(a, b); }
+        static real fmod(real a, real b) { return fmodf(a, b); }
+
+        /** Returns the highest value for the real number. */
+        static real maximum() { return FLT_MAX; }
+
+        /** Returns the number e on which 1+e == 1. */
+        static real epsilon() { return FLT_EPSILON; }
+
+        static real pi() { return 3.14159265f; }
+    };
+
+    /**
+     * A precision policy for double precision. See SinglePrecision.
+     */
+    struct DoublePrecision
+    {
+        typedef double real;
+
+        static real sqrt(real a) { return ::sqrt(a); }
+        static real abs(real a) { return fabs(a); }
+        static real sin(real a) { return ::sin(a); }
+        static real cos(real a) { return ::cos(a); }
+        static real exp(real a) { return ::exp(a); }
+        static real pow(real a, real b) { return ::pow(a, b); }
+        static real fmod(real a, real b) { return ::fmod(a, b); }
+
+        static real maximum() { return DBL_MAX; }
+        static real epsilon() { return DBL_EPSILON; }
+        static real pi() { return 3.14159265358979; }
+    };
+
 #if 0
     /**
      * Defines we're in single precision mode, for any code
@@ -68,6 +121,9 @@ namespace cyclone {
     #define real_epsilon FLT_EPSILON
 
     #define R_PI 3.14159f
+
+    /** Defines the precision policy matching the real type. */
+    typedef SinglePrecision DefaultPrecision;
 #else
     #define DOUBLE_PRECISION
     typedef double real;
@@ -81,6 +137,7 @@ namespace cyclone {
     #define real_fmod fmod
     #define real_epsilon DBL_EPSILON
     #define R_PI 3.14159265358979
+    typedef DoublePrecision DefaultPrecision;
 #endif
 }
 
@@ -0,0 +1,321 @@
+/*
+ * Implementation file for the particle store.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+#include <assert.h>
+#include <pstore.h>
+
+using namespace cyclone;
+
+/**
+ * Integrates one axis of a set of particles. Each axis is done in its
+ * own pass, so every loop reads and writes a handful of contiguous
+ * arrays with no aliasing and no branches, and the compiler can
+ * vectorise it.
+ */
+static void integrateAxis(real *__restrict position,
+                          real *__restrict velocity,
+                          const real *__restrict acceleration,
+                          const real *__restrict force,
+                          const real *__restrict inverseMass,
+                          unsigned count, real duration, real drag)
+{
+    for (unsigned i = 0; i < count; i++)
+    {
+        real v = (velocity[i] +
+            (acceleration[i] + force[i] * inverseMass[i]) * duration) * drag;
+
+        // Particles with infinite mass keep their state.
+        real moves = inverseMass[i] > 0 ? (real)1 : (real)0;
+        velocity[i] += (v - velocity[i]) * moves;
+        position[i] += v * duration * moves;
+    }
+}
+
+/**
+ * Copies the last entry of the array into the given slot, and drops
+ * the last entry.
+ */
+static inline void swapRemove(std::vector<real> &values, unsigned index)
+{
+    values[index] = values.back();
+    values.pop_back();
+}
+
+ParticleStore::ParticleStore(unsigned capacity)
+    : damping(0.99f)
+{
+    reserve(capacity);
+}
+
+void ParticleStore::reserve(unsigned capacity)
+{
+    positionX.reserve(capacity);
+    positionY.reserve(capacity);
+    positionZ.reserve(capacity);
+    velocityX.reserve(capacity);
+    velocityY.reserve(capacity);
+    velocityZ.reserve(capacity);
+    accelerationX.reserve(capacity);
+    accelerationY.reserve(capacity);
+    accelerationZ.reserve(capacity);
+    forceX.reserve(capacity);
+    forceY.reserve(capacity);
+    forceZ.reserve(capacity);
+    inverseMass.reserve(capacity);
+    age.reserve(capacity);
+    lifetime.reserve(capacity);
+}
+
+void ParticleStore::resize(unsigned size)
+{
+    positionX.resize(size);
+    positionY.resize(size);
+    positionZ.resize(size);
+    velocityX.resize(size);
+    velocityY.resize(size);
+    velocityZ.resize(size);
+    accelerationX.resize(size);
+    accelerationY.resize(size);
+    accelerationZ.resize(size);
+    forceX.resize(size);
+    forceY.resize(size);
+    forceZ.resize(size);
+    inverseMass.resize(size);
+    age.resize(size);
+    lifetime.resize(size);
+}
+
+unsigned ParticleStore::spawn(unsigned count,
+                              const Vector3 *positions,
+                              const Vector3 *velocities,
+                              const Vector3 &acceleration,
+                              real inverseMass,
+                              real lifetime)
+{
+    assert(positions);
+
+    unsigned first = getSize();
+    resize(first + count);
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        unsigned p = first + i;
+        positionX[p] = positions[i].x;
+        positionY[p] = positions[i].y;
+        positionZ[p] = positions[i].z;
+        if (velocities)
+        {
+            velocityX[p] = velocities[i].x;
+            velocityY[p] = velocities[i].y;
+            velocityZ[p] = velocities[i].z;
+        }
+        else
+        {
+            velocityX[p] = velocityY[p] = velocityZ[p] = 0;
+        }
+        accelerationX[p] = acceleration.x;
+        accelerationY[p] = acceleration.y;
+        accelerationZ[p] = acceleration.z;
+        forceX[p] = forceY[p] = forceZ[p] = 0;
+        ParticleStore::inverseMass[p] = inverseMass;
+        age[p] = 0;
+        ParticleStore::lifetime[p] = lifetime;
+    }
+    return first;
+}
+
+void ParticleStore::kill(unsigned index)
+{
+    assert(index < getSize());
+
+    swapRemove(positionX, index);
+    swapRemove(positionY, index);
+    swapRemove(positionZ, index);
+    swapRemove(velocityX, index);
+    swapRemove(velocityY, index);
+    swapRemove(velocityZ, index);
+    swapRemove(accelerationX, index);
+    swapRemove(accelerationY, index);
+    swapRemove(accelerationZ, index);
+    swapRemove(forceX, index);
+    swapRemove(forceY, index);
+    swapRemove(forceZ, index);
+    swapRemove(inverseMass, index);
+    swapRemove(age, index);
+    swapRemove(lifetime, index);
+}
+
+unsigned ParticleStore::killExpired()
+{
+    unsigned killed = 0;
+
+    // Walk backwards so the particle swapped into a slot has already
+    // been checked.
+    for (unsigned i = getSize(); i > 0; i--)
+    {
+        if (age[i - 1] >= lifetime[i - 1])
+        {
+            kill(i - 1);
+            killed++;
+        }
+    }
+    return killed;
+}
+
+void ParticleStore::clear()
+{
+    resize(0);
+}
+
+void ParticleStore::clearAccumulators()
+{
+    unsigned count = getSize();
+    real *fx = forceX.data();
+    real *fy = forceY.data();
+    real *fz = forceZ.data();
+    for (unsigned i = 0; i < count; i++)
+    {
+        fx[i] = fy[i] = fz[i] = 0;
+    }
+}
+
+void ParticleStore::integrate(real duration)
+{
+    assert(duration > 0.0);
+
+    unsigned count = getSize();
+    if (count == 0) return;
+
+    // Damping is the same for every particle, so it is only raised
+    // to the power once.
+    real drag = real_pow(damping, duration);
+
+    integrateAxis(positionX.data(), velocityX.data(), accelerationX.data(),
+        forceX.data(), inverseMass.data(), count, duration, drag);
+    integrateAxis(positionY.data(), velocityY.data(), accelerationY.data(),
+        forceY.data(), inverseMass.data(), count, duration, drag);
+    integrateAxis(positionZ.data(), velocityZ.data(), accelerationZ.data(),
+        forceZ.data(), inverseMass.data(), count, duration, drag);
+
+    real *__restrict ages = age.data();
+    for (unsigned i = 0; i < count; i++) ages[i] += duration;
+
+    clearAccumulators();
+}
+
+unsigned ParticleStore::collideWithGround(real height, real restitution,
+                                          real duration)
+{
+    unsigned count = getSize();
+    real *__restrict py = positionY.data();
+    real *__restrict vy = velocityY.data();
+    const real *__restrict ay = accelerationY.data();
+    const real *__restrict im = inverseMass.data();
+
+    real touching = 0;
+    for (unsigned i = 0; i < count; i++)
+    {
+        real movable = im[i] > 0 ? (real)1 : (real)0;
+        real below = py[i] < height ? movable : (real)0;
+        touching += below;
+
+        // Push the particle back up to the surface.
+        py[i] += (height - py[i]) * below;
+
+        // Bounce it if it is closing, ignoring any velocity that
+        // built up from acceleration alone this frame, as the
+        // contact resolver does.
+        real separating = vy[i];
+        real accCaused = ay[i] * duration;
+        accCaused = accCaused < 0 ? accCaused : (real)0;
+        real bounce = (-separating + accCaused) * restitution;
+        bounce = bounce > 0 ? bounce : (real)0;
+        real closing = separating < 0 ? below : (real)0;
+        vy[i] += (bounce - separating) * closing;
+    }
+    return (unsigned)touching;
+}
+
+void ParticleStore::setDamping(real damping)
+{
+    ParticleStore::damping = damping;
+}
+
+real ParticleStore::getDamping() const
+{
+    return damping;
+}
+
+Vector3 ParticleStore::getPosition(unsigned index) const
+{
+    return Vector3(positionX[index], positionY[index], positionZ[index]);
+}
+
+void ParticleStore::setPosition(unsigned index, const Vector3 &position)
+{
+    positionX[index] = position.x;
+    positionY[index] = position.y;
+    positionZ[index] = position.z;
+}
+
+Vector3 ParticleStore::getVelocity(unsigned index) const
+{
+    return Vector3(velocityX[index], velocityY[index], velocityZ[index]);
+}
+
+void ParticleStore::setVelocity(unsigned index, const Vector3 &velocity)
+{
+    velocityX[index] = velocity.x;
+    velocityY[index] = velocity.y;
+    velocityZ[index] = velocity.z;
+}
+
+Vector3 ParticleStore::getAcceleration(unsigned index) const
+{
+    return Vector3(accelerationX[index], accelerationY[index],
+        accelerationZ[index]);
+}
+
+void ParticleStore::setAcceleration(unsigned index,
+                                    const Vector3 &acceleration)
+{
+    accelerationX[index] = acceleration.x;
+    accelerationY[index] = acceleration.y;
+    accelerationZ[index] = acceleration.z;
+}
+
+real ParticleStore::getInverseMass(unsigned index) const
+{
+    return inverseMass[index];
+}
+
+void ParticleStore::setInverseMass(unsigned index, real inverseMass)
+{
+    ParticleStore::inverseMass[index] = inverseMass;
+}
+
+real ParticleStore::getAge(unsigned index) const
+{
+    return age[index];
+}
+
+real ParticleStore::getLifetime(unsigned index) const
+{
+    return lifetime[index];
+}
+
+void ParticleStore::addForce(unsigned index, const Vector3 &force)
+{
+    forceX[index] += force.x;
+    forceY[index] += force.y;
+    forceZ[index] += force.z;
+}
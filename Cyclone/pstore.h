@@ -0,0 +1,243 @@
+/*
+ * Interface file for the particle store.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+/**
+ * @file
+ *
+ * This file contains a store for large numbers of simple particles,
+ * such as debris, dust and sparks. Rather than one object per
+ * particle, each property is held in its own contiguous array, so the
+ * integrator walks memory in order and the compiler can vectorise it.
+ */
+#ifndef CYCLONE_PSTORE_H
+#define CYCLONE_PSTORE_H
+
+#include <vector>
+#include "core.h"
+
+namespace cyclone {
+
+    /**
+     * Holds a set of particles as a structure of arrays.
+     *
+     * Particles are addressed by index. Indices are dense: killing a
+     * particle moves the last particle into its slot, so an index is
+     * only valid until the next kill. Particles in a store all share
+     * one damping value, and have no per-particle callbacks; anything
+     * that needs its own identity or links to other objects should
+     * use the Particle class instead.
+     */
+    class ParticleStore
+    {
+    public:
+        /**
+         * Creates an empty store with room for the given number of
+         * particles before it needs to grow.
+         */
+        explicit ParticleStore(unsigned capacity = 0);
+
+        /**
+         * Makes sure the store can hold the given number of
+         * particles without reallocating.
+         */
+        void reserve(unsigned capacity);
+
+        /**
+         * Returns the number of live particles.
+         */
+        unsigned getSize() const
+        {
+            return (unsigned)inverseMass.size();
+        }
+
+        /**
+         * Adds the given number of particles at the end of the store,
+         * and returns the index of the first. Positions are read from
+         * the given array. Velocities are read from the second array,
+         * or set to zero if it is NULL. The remaining properties are
+         * shared by the whole batch.
+         */
+        unsigned spawn(unsigned count,
+                       const Vector3 *positions,
+                       const Vector3 *velocities,
+                       const Vector3 &acceleration,
+                       real inverseMass,
+                       real lifetime = REAL_MAX);
+
+        /**
+         * Removes the particle at the given index. The last particle
+         * is moved into its place.
+         */
+        void kill(unsigned index);
+
+        /**
+         * Removes every particle that has outlived its lifetime, and
+         * returns how many were removed.
+         */
+        unsigned killExpired();
+
+        /**
+         * Removes every particle.
+         */
+        void clear();
+
+        /**
+         * Clears the force accumulators of every particle.
+         */
+        void clearAccumulators();
+
+        /**
+         * Integrates every particle forward in time by the given
+         * amount, in the same way as Particle::integrate, and ages
+         * them. Particles with zero inverse mass don't move.
+         */
+        void integrate(real duration);
+
+        /**
+         * Stops any particle that has fallen below the given height,
+         * placing it on the ground and bouncing it with the given
+         * restitution. This gives the same result as contacts from
+         * GroundContacts run through the particle contact resolver,
+         * but in a single pass, since the contacts are independent.
+         * Returns the number of particles that were touching.
+         */
+        unsigned collideWithGround(real height, real restitution,
+                                   real duration);
+
+        /**
+         * Sets the damping applied to every particle in the store.
+         */
+        void setDamping(real damping);
+
+        /**
+         * Returns the damping applied to every particle in the store.
+         */
+        real getDamping() const;
+
+        /**
+         * @name Per-particle Access
+         *
+         * These functions gather or scatter the properties of a
+         * single particle. For bulk work use the array accessors
+         * below instead.
+         */
+        /*@{*/
+
+        Vector3 getPosition(unsigned index) const;
+
+        void setPosition(unsigned index, const Vector3 &position);
+
+        Vector3 getVelocity(unsigned index) const;
+
+        void setVelocity(unsigned index, const Vector3 &velocity);
+
+        Vector3 getAcceleration(unsigned index) const;
+
+        void setAcceleration(unsigned index, const Vector3 &acceleration);
+
+        real getInverseMass(unsigned index) const;
+
+        void setInverseMass(unsigned index, real inverseMass);
+
+        real getAge(unsigned index) const;
+
+        real getLifetime(unsigned index) const;
+
+        /**
+         * Adds the given force to the particle, to be applied at the
+         * next integration only.
+         */
+        void addForce(unsigned index, const Vector3 &force);
+
+        /*@}*/
+
+        /**
+         * @name Array Access
+         *
+         * These return the start of each property array. Each has
+         * getSize() entries, and is invalidated by spawning.
+         */
+        /*@{*/
+
+        real *getPositionX() { return positionX.data(); }
+        real *getPositionY() { return positionY.data(); }
+        real *getPositionZ() { return positionZ.data(); }
+        const real *getPositionX() const { return positionX.data(); }
+        const real *getPositionY() const { return positionY.data(); }
+        const real *getPositionZ() const { return positionZ.data(); }
+
+        real *getVelocityX() { return velocityX.data(); }
+        real *getVelocityY() { return velocityY.data(); }
+        real *getVelocityZ() { return velocityZ.data(); }
+        const real *getVelocityX() const { return velocityX.data(); }
+        const real *getVelocityY() const { return velocityY.data(); }
+        const real *getVelocityZ() const { return velocityZ.data(); }
+
+        real *getForceX() { return forceX.data(); }
+        real *getForceY() { return forceY.data(); }
+        real *getForceZ() { return forceZ.data(); }
+
+        const real *getInverseMasses() const { return inverseMass.data(); }
+        const real *getAges() const { return age.data(); }
+        const real *getLifetimes() const { return lifetime.data(); }
+
+        /*@}*/
+
+    protected:
+        /**
+         * Holds the position of each particle, one array per axis.
+         */
+        std::vector<real> positionX, positionY, positionZ;
+
+        /**
+         * Holds the velocity of each particle, one array per axis.
+         */
+        std::vector<real> velocityX, velocityY, velocityZ;
+
+        /**
+         * Holds the constant acceleration of each particle, one
+         * array per axis.
+         */
+        std::vector<real> accelerationX, accelerationY, accelerationZ;
+
+        /**
+         * Holds the force accumulated for the next integration, one
+         * array per axis.
+         */
+        std::vector<real> forceX, forceY, forceZ;
+
+        /**
+         * Holds the inverse mass of each particle.
+         */
+        std::vector<real> inverseMass;
+
+        /**
+         * Holds how long each particle has been alive, and how long
+         * it may live for.
+         */
+        std::vector<real> age, lifetime;
+
+        /**
+         * Holds the amount of damping applied to linear motion of
+         * every particle in the store.
+         */
+        real damping;
+
+        /**
+         * Resizes every property array to the given size.
+         */
+        void resize(unsigned size);
+    };
+
+} // namespace cyclone
+
+#endif // CYCLONE_PSTORE_H
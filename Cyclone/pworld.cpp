@@ -18,7 +18,11 @@ using namespace cyclone;
 ParticleWorld::ParticleWorld(unsigned maxContacts, unsigned iterations)
 :
 resolver(iterations),
-maxContacts(maxContacts)
+maxContacts(maxContacts),
+storeHasGround(false),
+storeGroundHeight(0),
+storeGroundRestitution(0),
+linkSolver(NULL)
 {
     contacts = new ParticleContact[maxContacts];
     calculateIterations = (iterations == 0);
@@ -39,6 +43,7 @@ void ParticleWorld::startFrame()
         // Remove all forces from the accumulator
         (*p)->clearAccumulator();
     }
+    store.clearAccumulators();
 }
 
 unsigned ParticleWorld::generateContacts()
@@ -72,16 +77,28 @@ void ParticleWorld::integrate(real duration)
         // Remove all forces from the accumulator
         (*p)->integrate(duration);
     }
+    store.integrate(duration);
 }
 
 void ParticleWorld::runPhysics(real duration)
 {
     // First apply the force generators
     registry.updateForces(duration);
+    for (StoreForceGenerators::iterator g = storeForceGenerators.begin();
+        g != storeForceGenerators.end();
+        g++)
+    {
+        (*g)->updateForces(store, duration);
+    }
 
-    // Then integrate the objects
+    // Then integrate the objects, noting where the linked particles
+    // start so the link solver can work out their velocities
+    if (linkSolver) linkSolver->beginStep();
     integrate(duration);
 
+    // Pull the linked particles back onto their links
+    if (linkSolver) linkSolver->solve(duration);
+
     // Generate contacts
     unsigned usedContacts = generateContacts();
 
@@ -91,6 +108,14 @@ void ParticleWorld::runPhysics(real duration)
         if (calculateIterations) resolver.setIterations(usedContacts * 2);
         resolver.resolveContacts(contacts, usedContacts, duration);
     }
+
+    // Bulk particles only meet the ground, and each can be stopped
+    // on its own.
+    if (storeHasGround)
+    {
+        store.collideWithGround(storeGroundHeight, storeGroundRestitution,
+            duration);
+    }
 }
 
 ParticleWorld::Particles& ParticleWorld::getParticles()
@@ -108,6 +133,38 @@ ParticleForceRegistry& ParticleWorld::getForceRegistry()
     return registry;
 }
 
+ParticleStore& ParticleWorld::getStore()
+{
+    return store;
+}
+
+const ParticleStore& ParticleWorld::getStore() const
+{
+    return store;
+}
+
+ParticleWorld::StoreForceGenerators& ParticleWorld::getStoreForceGenerators()
+{
+    return storeForceGenerators;
+}
+
+void ParticleWorld::setStoreGround(real height, real restitution)
+{
+    storeHasGround = true;
+    storeGroundHeight = height;
+    storeGroundRestitution = restitution;
+}
+
+void ParticleWorld::clearStoreGround()
+{
+    storeHasGround = false;
+}
+
+void ParticleWorld::setLinkSolver(ParticleLinkSolver *solver)
+{
+    linkSolver = solver;
+}
+
 void GroundContacts::init(cyclone::ParticleWorld::Particles *particles)
 {
     GroundContacts::particles = particles;
@@ -21,6 +21,8 @@
 
 #include "pfgen.h"
 #include "plinks.h"
+#include "pstore.h"
+#include "pxpbd.h"
 
 namespace cyclone {
 
@@ -33,6 +35,7 @@ namespace cyclone {
     public:
         typedef std::vector<Particle*> Particles;
         typedef std::vector<ParticleContactGenerator*> ContactGenerators;
+        typedef std::vector<ParticleForceGenerator*> StoreForceGenerators;
 
     protected:
         /**
@@ -72,6 +75,32 @@ namespace cyclone {
          */
         unsigned maxContacts;
 
+        /**
+         * Holds the bulk particles, which are integrated alongside
+         * the individual ones but don't take part in contacts.
+         */
+        ParticleStore store;
+
+        /**
+         * Holds the force generators applied to every bulk particle,
+         * each in one pass over the store.
+         */
+        StoreForceGenerators storeForceGenerators;
+
+        /**
+         * True if the bulk particles should be stopped by a ground
+         * plane, with the height and restitution given below.
+         */
+        bool storeHasGround;
+        real storeGroundHeight;
+        real storeGroundRestitution;
+
+        /**
+         * Holds the solver for links handled by position projection,
+         * or NULL if all links are contact generators.
+         */
+        ParticleLinkSolver *linkSolver;
+
     public:
 
         /**
@@ -127,6 +156,35 @@ namespace cyclone {
          * Returns the force registry.
          */
         ParticleForceRegistry& getForceRegistry();
+
+        /**
+         * Returns the store of bulk particles.
+         */
+        ParticleStore& getStore();
+        const ParticleStore& getStore() const;
+
+        /**
+         * Returns the list of force generators for the bulk particles.
+         */
+        StoreForceGenerators& getStoreForceGenerators();
+
+        /**
+         * Makes the bulk particles collide with a horizontal ground
+         * plane at the given height.
+         */
+        void setStoreGround(real height, real restitution);
+
+        /**
+         * Lets the bulk particles fall without a ground plane.
+         */
+        void clearStoreGround();
+
+        /**
+         * Sets the solver used for links that are enforced by moving
+         * their particles directly. The world doesn't take ownership
+         * of the solver. Pass NULL to stop using one.
+         */
+        void setLinkSolver(ParticleLinkSolver *solver);
     };
 
     /**
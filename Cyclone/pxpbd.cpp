@@ -0,0 +1,255 @@
+/*
+ * Implementation file for the position based particle link solver.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+#include <assert.h>
+#include <pxpbd.h>
+#include <algorithm>
+
+using namespace cyclone;
+
+/**
+ * The most colours tracked per particle. Links that can't be given
+ * one of these go into one extra colour, which is solved serially.
+ */
+static const unsigned MAX_COLOURS = 64;
+
+/**
+ * The number of links each task solves, when a colour is spread
+ * across a thread pool.
+ */
+static const unsigned LINKS_PER_TASK = 256;
+
+ParticleLinkSolver::ParticleLinkSolver(unsigned iterations, ThreadPool *pool)
+    : dirty(false), iterations(iterations), pool(pool)
+{
+}
+
+void ParticleLinkSolver::addLink(Particle *first, Particle *second,
+                                 const Vector3 *anchor, const real *length,
+                                 bool isCable, real compliance)
+{
+    assert(first);
+
+    Link link;
+    link.particle[0] = first;
+    link.particle[1] = second;
+    link.anchor = anchor;
+    link.length = length;
+    link.isCable = isCable;
+    link.compliance = compliance;
+    link.lambda = 0;
+    links.push_back(link);
+    dirty = true;
+}
+
+void ParticleLinkSolver::addCable(ParticleCable *cable, real compliance)
+{
+    addLink(cable->particle[0], cable->particle[1], 0,
+        &cable->maxLength, true, compliance);
+}
+
+void ParticleLinkSolver::addRod(ParticleRod *rod, real compliance)
+{
+    addLink(rod->particle[0], rod->particle[1], 0,
+        &rod->length, false, compliance);
+}
+
+void ParticleLinkSolver::addCableConstraint(ParticleCableConstraint *cable,
+                                            real compliance)
+{
+    addLink(cable->particle, 0, &cable->anchor,
+        &cable->maxLength, true, compliance);
+}
+
+void ParticleLinkSolver::addRodConstraint(ParticleRodConstraint *rod,
+                                          real compliance)
+{
+    addLink(rod->particle, 0, &rod->anchor,
+        &rod->length, false, compliance);
+}
+
+void ParticleLinkSolver::clear()
+{
+    links.clear();
+    order.clear();
+    colourStart.clear();
+    particles.clear();
+    previousPositions.clear();
+    dirty = false;
+}
+
+void ParticleLinkSolver::setIterations(unsigned iterations)
+{
+    ParticleLinkSolver::iterations = iterations;
+}
+
+unsigned ParticleLinkSolver::getColourCount()
+{
+    if (dirty) buildColours();
+    return colourStart.empty() ? 0 : (unsigned)colourStart.size() - 1;
+}
+
+void ParticleLinkSolver::buildColours()
+{
+    dirty = false;
+
+    // Gather each distinct particle once.
+    particles.clear();
+    for (unsigned i = 0; i < links.size(); i++)
+    {
+        particles.push_back(links[i].particle[0]);
+        if (links[i].particle[1]) particles.push_back(links[i].particle[1]);
+    }
+    std::sort(particles.begin(), particles.end());
+    particles.erase(std::unique(particles.begin(), particles.end()),
+        particles.end());
+    previousPositions.resize(particles.size());
+
+    // Greedily give each link the lowest colour not already used by
+    // a link at either of its particles.
+    std::vector<unsigned long long> used(particles.size(), 0);
+    std::vector<unsigned> colour(links.size());
+    unsigned colours = 0;
+    for (unsigned i = 0; i < links.size(); i++)
+    {
+        unsigned ends[2];
+        unsigned endCount = 0;
+        unsigned long long taken = 0;
+        for (unsigned j = 0; j < 2; j++)
+        {
+            if (!links[i].particle[j]) continue;
+            ends[endCount] = (unsigned)(std::lower_bound(
+                particles.begin(), particles.end(), links[i].particle[j]) -
+                particles.begin());
+            taken |= used[ends[endCount]];
+            endCount++;
+        }
+
+        unsigned c = 0;
+        while (c < MAX_COLOURS && (taken & (1ULL << c))) c++;
+        if (c < MAX_COLOURS)
+        {
+            for (unsigned j = 0; j < endCount; j++) used[ends[j]] |= 1ULL << c;
+        }
+        colour[i] = c;
+        if (c + 1 > colours) colours = c + 1;
+    }
+
+    // Sort the links by colour, keeping them in the order they were
+    // added within each colour.
+    colourStart.assign(colours + 1, 0);
+    for (unsigned i = 0; i < links.size(); i++) colourStart[colour[i] + 1]++;
+    for (unsigned c = 0; c < colours; c++) colourStart[c + 1] += colourStart[c];
+
+    order.resize(links.size());
+    std::vector<unsigned> next(colourStart.begin(), colourStart.end() - 1);
+    for (unsigned i = 0; i < links.size(); i++) order[next[colour[i]]++] = i;
+}
+
+void ParticleLinkSolver::beginStep()
+{
+    if (dirty) buildColours();
+
+    for (unsigned i = 0; i < particles.size(); i++)
+    {
+        previousPositions[i] = particles[i]->getPosition();
+    }
+}
+
+void ParticleLinkSolver::solveLink(Link &link, real alphaTilde)
+{
+    Vector3 other = link.particle[1] ?
+        link.particle[1]->getPosition() : *link.anchor;
+    Vector3 delta = link.particle[0]->getPosition() - other;
+    real distance = delta.magnitude();
+    if (distance <= 0) return;
+
+    real error = distance - *link.length;
+
+    // Cables are slack when they are shorter than their length.
+    if (link.isCable && error <= 0) return;
+
+    real inverseMass0 = link.particle[0]->getInverseMass();
+    real inverseMass1 = link.particle[1] ?
+        link.particle[1]->getInverseMass() : 0;
+    real denominator = inverseMass0 + inverseMass1 + alphaTilde;
+    if (denominator <= 0) return;
+
+    // The compliance term holds back part of the correction in
+    // proportion to the multiplier already applied, which is what
+    // keeps the stiffness independent of the iteration count.
+    real deltaLambda = (-error - alphaTilde * link.lambda) / denominator;
+    link.lambda += deltaLambda;
+
+    Vector3 correction = delta * (deltaLambda / distance);
+    link.particle[0]->setPosition(link.particle[0]->getPosition() +
+        correction * inverseMass0);
+    if (link.particle[1])
+    {
+        link.particle[1]->setPosition(link.particle[1]->getPosition() -
+            correction * inverseMass1);
+    }
+}
+
+void ParticleLinkSolver::solve(real duration)
+{
+    assert(duration > 0.0);
+    if (dirty) buildColours();
+    if (links.empty()) return;
+
+    for (unsigned i = 0; i < links.size(); i++) links[i].lambda = 0;
+    real inverseDurationSquared = ((real)1.0) / (duration * duration);
+
+    for (unsigned iteration = 0; iteration < iterations; iteration++)
+    {
+        unsigned colours = (unsigned)colourStart.size() - 1;
+        for (unsigned c = 0; c < colours; c++)
+        {
+            unsigned first = colourStart[c];
+            unsigned count = colourStart[c + 1] - first;
+
+            // The overflow colour may have links that share particles.
+            bool parallel = pool && c < MAX_COLOURS && count > LINKS_PER_TASK;
+            if (!parallel)
+            {
+                for (unsigned i = first; i < first + count; i++)
+                {
+                    Link &link = links[order[i]];
+                    solveLink(link, link.compliance * inverseDurationSquared);
+                }
+                continue;
+            }
+
+            unsigned tasks = (count + LINKS_PER_TASK - 1) / LINKS_PER_TASK;
+            pool->run(tasks, [&](unsigned task, unsigned) {
+                unsigned begin = first + task * LINKS_PER_TASK;
+                unsigned end = std::min(begin + LINKS_PER_TASK, first + count);
+                for (unsigned i = begin; i < end; i++)
+                {
+                    Link &link = links[order[i]];
+                    solveLink(link, link.compliance * inverseDurationSquared);
+                }
+            });
+        }
+    }
+
+    // The velocity is whatever carries each particle from where it
+    // started to where it has ended up.
+    real inverseDuration = ((real)1.0) / duration;
+    for (unsigned i = 0; i < particles.size(); i++)
+    {
+        if (particles[i]->getInverseMass() <= 0) continue;
+        particles[i]->setVelocity(
+            (particles[i]->getPosition() - previousPositions[i]) *
+            inverseDuration);
+    }
+}
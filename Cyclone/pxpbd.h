@@ -0,0 +1,190 @@
+/*
+ * Interface file for the position based particle link solver.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+/**
+ * @file
+ *
+ * This file contains a solver that enforces particle links by moving
+ * the particles directly, rather than by generating contacts. It uses
+ * extended position based dynamics (XPBD): each link has a compliance,
+ * the inverse of its stiffness, and the solver accumulates a Lagrange
+ * multiplier per link so that the stiffness comes out the same however
+ * many iterations are run.
+ */
+#ifndef CYCLONE_PXPBD_H
+#define CYCLONE_PXPBD_H
+
+#include <vector>
+#include "plinks.h"
+#include "threadpool.h"
+
+namespace cyclone {
+
+    /**
+     * Enforces a set of cables and rods by position projection.
+     *
+     * Links are handed to the solver instead of being registered as
+     * contact generators with the world. The links themselves still
+     * own their particles and lengths, and these can be changed at any
+     * time. Cables behave as if their restitution were zero: position
+     * based dynamics has no bounce.
+     *
+     * Links are split into colours, so that no two links of the same
+     * colour share a particle. The links in one colour can then be
+     * solved at the same time, and if the solver is given a thread
+     * pool, they are.
+     *
+     * Each step the caller records the particle positions with
+     * beginStep, integrates the particles, then calls solve. The solve
+     * moves the particles back onto their links and sets their
+     * velocities from how far they moved over the whole step.
+     */
+    class ParticleLinkSolver
+    {
+    public:
+        /**
+         * Creates a solver that runs the given number of iterations
+         * each step. If a thread pool is given, each colour of links
+         * is spread across its workers.
+         */
+        ParticleLinkSolver(unsigned iterations = 8, ThreadPool *pool = 0);
+
+        /**
+         * Adds a link to the solver. A compliance of zero gives a link
+         * that doesn't stretch at all. Larger values, in metres per
+         * newton, give softer links.
+         */
+        void addCable(ParticleCable *cable, real compliance = 0);
+        void addRod(ParticleRod *rod, real compliance = 0);
+        void addCableConstraint(ParticleCableConstraint *cable,
+            real compliance = 0);
+        void addRodConstraint(ParticleRodConstraint *rod,
+            real compliance = 0);
+
+        /**
+         * Removes every link from the solver.
+         */
+        void clear();
+
+        /**
+         * Sets the number of iterations run each step.
+         */
+        void setIterations(unsigned iterations);
+
+        /**
+         * Returns the number of colours the links were split into.
+         */
+        unsigned getColourCount();
+
+        /**
+         * Records the positions of every linked particle. This should
+         * be called before the particles are integrated.
+         */
+        void beginStep();
+
+        /**
+         * Projects the integrated particles back onto their links,
+         * then sets each linked particle's velocity from its
+         * movement since beginStep.
+         */
+        void solve(real duration);
+
+    protected:
+        /**
+         * Holds one link in the form the solver works on. The
+         * particles, anchor and length point into the link the
+         * solver was given.
+         */
+        struct Link
+        {
+            /**
+             * The particles at each end. The second is NULL for a
+             * link to a fixed anchor.
+             */
+            Particle *particle[2];
+
+            /** The fixed anchor, for a link with one particle. */
+            const Vector3 *anchor;
+
+            /** The rest length, or the maximum length for a cable. */
+            const real *length;
+
+            /** True if the link only resists stretching. */
+            bool isCable;
+
+            /** How far the link gives under load, per unit force. */
+            real compliance;
+
+            /** The total multiplier applied so far this step. */
+            real lambda;
+        };
+
+        /**
+         * Holds the links, in the order they were added.
+         */
+        std::vector<Link> links;
+
+        /**
+         * Holds the index of every link, grouped by colour.
+         */
+        std::vector<unsigned> order;
+
+        /**
+         * Holds the start of each colour in the order array, with a
+         * final entry for the end of the last colour.
+         */
+        std::vector<unsigned> colourStart;
+
+        /**
+         * Holds each distinct linked particle, and where it was at
+         * the start of the step.
+         */
+        std::vector<Particle*> particles;
+        std::vector<Vector3> previousPositions;
+
+        /**
+         * True if links have been added since the colours were
+         * worked out.
+         */
+        bool dirty;
+
+        /**
+         * Holds the number of iterations to run each step.
+         */
+        unsigned iterations;
+
+        /**
+         * Holds the pool used to solve colours in parallel, or NULL.
+         */
+        ThreadPool *pool;
+
+        /**
+         * Adds a link with the given details.
+         */
+        void addLink(Particle *first, Particle *second,
+            const Vector3 *anchor, const real *length, bool isCable,
+            real compliance);
+
+        /**
+         * Splits the links into colours and gathers the particles.
+         */
+        void buildColours();
+
+        /**
+         * Moves the particles of one link towards satisfying it.
+         */
+        static void solveLink(Link &link, real alphaTilde);
+    };
+
+} // namespace cyclone
+
+#endif // CYCLONE_PXPBD_H
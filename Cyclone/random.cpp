@@ -182,3 +182,265 @@ Vector3 Random::randomVector(const Vector3 &min, const Vector3 &max)
         randomReal(min.z, max.z)
         );
 }
+
+/*
+ * The multipliers and key increments of the Philox4x32 algorithm.
+ */
+static const unsigned PHILOX_M0 = 0xD2511F53;
+static const unsigned PHILOX_M1 = 0xCD9E8D57;
+static const unsigned PHILOX_W0 = 0x9E3779B9;
+static const unsigned PHILOX_W1 = 0xBB67AE85;
+
+/**
+ * The number of words generated at a time when filling arrays of
+ * reals or vectors.
+ */
+static const unsigned FILL_CHUNK = 192;
+
+/**
+ * The number of blocks generated side by side by philoxBlocks.
+ */
+static const unsigned PHILOX_LANES = 8;
+
+/**
+ * Runs the ten Philox rounds on one counter, in place.
+ */
+static inline void philoxBlock(unsigned c[4], unsigned k0, unsigned k1)
+{
+    for (unsigned round = 0; round < 10; round++)
+    {
+        unsigned long long p0 = (unsigned long long)PHILOX_M0 * c[0];
+        unsigned long long p1 = (unsigned long long)PHILOX_M1 * c[2];
+        unsigned c1 = c[1];
+        c[0] = (unsigned)(p1 >> 32) ^ c1 ^ k0;
+        c[1] = (unsigned)p1;
+        c[2] = (unsigned)(p0 >> 32) ^ c[3] ^ k1;
+        c[3] = (unsigned)p0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+}
+
+/**
+ * Generates count consecutive blocks of four words, starting at the
+ * given block index, writing each block's words in order.
+ *
+ * Whole groups of blocks are run side by side, with each word of the
+ * counter in its own array. The counters are independent and the
+ * rounds have no branches, so the compiler turns each statement into
+ * vector instructions across the group.
+ */
+static void philoxBlocks(const unsigned key[2], unsigned stream,
+                         unsigned long long first, unsigned count,
+                         unsigned *__restrict output)
+{
+    while (count >= PHILOX_LANES)
+    {
+        unsigned c0[PHILOX_LANES], c1[PHILOX_LANES];
+        unsigned c2[PHILOX_LANES], c3[PHILOX_LANES];
+        for (unsigned l = 0; l < PHILOX_LANES; l++)
+        {
+            unsigned long long index = first + l;
+            c0[l] = (unsigned)index;
+            c1[l] = (unsigned)(index >> 32);
+            c2[l] = stream;
+            c3[l] = 0;
+        }
+
+        unsigned k0 = key[0];
+        unsigned k1 = key[1];
+        for (unsigned round = 0; round < 10; round++)
+        {
+            for (unsigned l = 0; l < PHILOX_LANES; l++)
+            {
+                unsigned long long p0 = (unsigned long long)PHILOX_M0 * c0[l];
+                unsigned long long p1 = (unsigned long long)PHILOX_M1 * c2[l];
+                c0[l] = (unsigned)(p1 >> 32) ^ c1[l] ^ k0;
+                c2[l] = (unsigned)(p0 >> 32) ^ c3[l] ^ k1;
+                c1[l] = (unsigned)p1;
+                c3[l] = (unsigned)p0;
+            }
+            k0 += PHILOX_W0;
+            k1 += PHILOX_W1;
+        }
+
+        for (unsigned l = 0; l < PHILOX_LANES; l++)
+        {
+            output[l*4] = c0[l];
+            output[l*4+1] = c1[l];
+            output[l*4+2] = c2[l];
+            output[l*4+3] = c3[l];
+        }
+        output += PHILOX_LANES * 4;
+        first += PHILOX_LANES;
+        count -= PHILOX_LANES;
+    }
+
+    // The last few blocks are done one at a time.
+    for (unsigned b = 0; b < count; b++)
+    {
+        unsigned long long index = first + b;
+        unsigned *c = output + b * 4;
+        c[0] = (unsigned)index;
+        c[1] = (unsigned)(index >> 32);
+        c[2] = stream;
+        c[3] = 0;
+        philoxBlock(c, key[0], key[1]);
+    }
+}
+
+/**
+ * Turns a random bitstring into a real between 0 and 1, never
+ * reaching 1.
+ */
+#ifdef SINGLE_PRECISION
+static inline real bitsToReal(unsigned bits)
+{
+    return (real)(bits >> 8) * (1.0f / 16777216.0f);
+}
+#else
+static inline real bitsToReal(unsigned bits)
+{
+    return (real)bits * (1.0 / 4294967296.0);
+}
+#endif
+
+CounterRandom::CounterRandom(unsigned long long seed, unsigned stream)
+{
+    CounterRandom::seed(seed, stream);
+}
+
+void CounterRandom::seed(unsigned long long seed, unsigned stream)
+{
+    key[0] = (unsigned)seed;
+    key[1] = (unsigned)(seed >> 32);
+    CounterRandom::stream = stream;
+    position = 0;
+    cachedBlock = ~0ULL;
+}
+
+CounterRandom CounterRandom::forStream(unsigned stream) const
+{
+    CounterRandom result = *this;
+    result.stream = stream;
+    result.position = 0;
+    result.cachedBlock = ~0ULL;
+    return result;
+}
+
+unsigned long long CounterRandom::getPosition() const
+{
+    return position;
+}
+
+void CounterRandom::setPosition(unsigned long long position)
+{
+    CounterRandom::position = position;
+}
+
+void CounterRandom::skip(unsigned long long count)
+{
+    position += count;
+}
+
+unsigned CounterRandom::bitsAt(unsigned long long index) const
+{
+    unsigned block[4];
+    philoxBlocks(key, stream, index >> 2, 1, block);
+    return block[index & 3];
+}
+
+unsigned CounterRandom::randomBits()
+{
+    unsigned long long block = position >> 2;
+    if (block != cachedBlock)
+    {
+        philoxBlocks(key, stream, block, 1, cache);
+        cachedBlock = block;
+    }
+    return cache[position++ & 3];
+}
+
+real CounterRandom::randomReal()
+{
+    return bitsToReal(randomBits());
+}
+
+real CounterRandom::randomReal(real min, real max)
+{
+    return randomReal() * (max-min) + min;
+}
+
+unsigned CounterRandom::randomInt(unsigned max)
+{
+    return randomBits() % max;
+}
+
+Vector3 CounterRandom::randomVector(const Vector3 &min, const Vector3 &max)
+{
+    real x = randomReal(min.x, max.x);
+    real y = randomReal(min.y, max.y);
+    real z = randomReal(min.z, max.z);
+    return Vector3(x, y, z);
+}
+
+void CounterRandom::fillBits(unsigned *output, unsigned count)
+{
+    // Numbers up to the next block boundary come one at a time.
+    while (count > 0 && (position & 3) != 0)
+    {
+        *output++ = randomBits();
+        count--;
+    }
+
+    unsigned blocks = count / 4;
+    philoxBlocks(key, stream, position >> 2, blocks, output);
+    position += blocks * 4;
+    output += blocks * 4;
+    count -= blocks * 4;
+
+    while (count > 0)
+    {
+        *output++ = randomBits();
+        count--;
+    }
+}
+
+void CounterRandom::fillReal(real *output, unsigned count,
+                             real min, real max)
+{
+    unsigned bits[FILL_CHUNK];
+    real scale = max - min;
+    while (count > 0)
+    {
+        unsigned n = count < FILL_CHUNK ? count : FILL_CHUNK;
+        fillBits(bits, n);
+        for (unsigned i = 0; i < n; i++)
+        {
+            output[i] = bitsToReal(bits[i]) * scale + min;
+        }
+        output += n;
+        count -= n;
+    }
+}
+
+void CounterRandom::fillVector(Vector3 *output, unsigned count,
+                               const Vector3 &min, const Vector3 &max)
+{
+    unsigned bits[FILL_CHUNK];
+    Vector3 scale = max - min;
+    while (count > 0)
+    {
+        unsigned n = count < FILL_CHUNK / 3 ? count : FILL_CHUNK / 3;
+        fillBits(bits, n * 3);
+        for (unsigned i = 0; i < n; i++)
+        {
+            output[i] = Vector3(
+                bitsToReal(bits[i*3]) * scale.x + min.x,
+                bitsToReal(bits[i*3+1]) * scale.y + min.y,
+                bitsToReal(bits[i*3+2]) * scale.z + min.z);
+        }
+        output += n;
+        count -= n;
+    }
+}
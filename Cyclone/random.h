@@ -13,7 +13,9 @@
 /**
  * @file
  *
- * This file contains the definitions for a random number generator.
+ * This file contains the definitions for two random number
+ * generators: a lagged Fibonacci stream with internal state, and a
+ * counter based stream that can be generated in parallel.
  */
 #ifndef CYCLONE_RANDOM_H
 #define CYCLONE_RANDOM_H
@@ -129,6 +131,130 @@ namespace cyclone {
         unsigned buffer[17];
     };
 
+    /**
+     * A counter based random stream, using the Philox4x32-10
+     * algorithm. Each block of four random words is a pure function of
+     * the seed, the stream number and the block's index, so there is
+     * no hidden state to share between threads.
+     *
+     * Any number can be read directly by its index, and the stream
+     * can be moved forward or back to any position in constant time.
+     * To generate in parallel, give each thread its own stream number,
+     * or give each task its own range of indices. Either way the
+     * numbers are the same however the work is scheduled.
+     *
+     * A seed of zero is a valid seed, rather than a request for a
+     * timing based one, so a stream is always reproducible.
+     */
+    class CounterRandom
+    {
+    public:
+        /**
+         * Creates a stream with the given seed and stream number,
+         * positioned at its first number.
+         */
+        CounterRandom(unsigned long long seed = 0, unsigned stream = 0);
+
+        /**
+         * Sets the seed and stream number, and moves back to the
+         * first number.
+         */
+        void seed(unsigned long long seed, unsigned stream = 0);
+
+        /**
+         * Returns a copy of this generator with the same seed, on a
+         * different stream. Streams with the same seed never overlap.
+         */
+        CounterRandom forStream(unsigned stream) const;
+
+        /**
+         * Gets the index of the next number the stream will return.
+         * Every number takes one index, whatever its type, and a
+         * vector takes three.
+         */
+        unsigned long long getPosition() const;
+
+        /**
+         * Moves the stream to the given index.
+         */
+        void setPosition(unsigned long long position);
+
+        /**
+         * Moves the stream forward over the given number of indices.
+         */
+        void skip(unsigned long long count);
+
+        /**
+         * Returns the random bitstring at the given index, without
+         * moving the stream.
+         */
+        unsigned bitsAt(unsigned long long index) const;
+
+        /**
+         * Returns the next random bitstring from the stream.
+         */
+        unsigned randomBits();
+
+        /**
+         * Returns a random floating point number between 0 and 1.
+         */
+        real randomReal();
+
+        /**
+         * Returns a random floating point number between min and max.
+         */
+        real randomReal(real min, real max);
+
+        /**
+         * Returns a random integer less than the given value.
+         */
+        unsigned randomInt(unsigned max);
+
+        /**
+         * Returns a random vector in the cube defined by the given
+         * minimum and maximum vectors.
+         */
+        Vector3 randomVector(const Vector3 &min, const Vector3 &max);
+
+        /**
+         * Fills the array with the next count random bitstrings. Whole
+         * blocks are generated several at a time, so this is much
+         * faster than calling randomBits in a loop.
+         */
+        void fillBits(unsigned *output, unsigned count);
+
+        /**
+         * Fills the array with the next count random numbers between
+         * min and max.
+         */
+        void fillReal(real *output, unsigned count, real min, real max);
+
+        /**
+         * Fills the array with the next count random vectors in the
+         * cube defined by the given minimum and maximum vectors. The
+         * vectors are the same as count calls to randomVector.
+         */
+        void fillVector(Vector3 *output, unsigned count,
+            const Vector3 &min, const Vector3 &max);
+
+    private:
+        /** Holds the two words of the Philox key. */
+        unsigned key[2];
+
+        /** Holds the stream number, the third word of the counter. */
+        unsigned stream;
+
+        /** Holds the index of the next number. */
+        unsigned long long position;
+
+        /**
+         * Holds the block containing the last number read one at a
+         * time, and that block's index.
+         */
+        unsigned cache[4];
+        unsigned long long cachedBlock;
+    };
+
 } // namespace cyclone
 
 #endif // CYCLONE_BODY_H
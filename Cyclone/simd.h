@@ -0,0 +1,713 @@
+/*
+ * Interface file for the vector instructions used by the core types.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+/**
+ * @file
+ *
+ * This file wraps the vector instructions of the target in a four lane
+ * type for each precision, so that the core mathematical types can be
+ * written once for every instruction set.
+ *
+ * Nothing here is used unless CYCLONE_SIMD is defined when Cyclone is
+ * compiled. The instruction set is then picked from the compiler's
+ * target:
+ *
+ * @li AVX, for an x86 target with AVX. Doubles use AVX, and floats
+ * use SSE.
+ *
+ * @li SSE2, for any other x86 target. Each set of four doubles is held
+ * in two registers.
+ *
+ * @li NEON, for a 64-bit ARM target. As with SSE2, four doubles take
+ * two registers.
+ *
+ * If none of these fit, CYCLONE_SIMD_BACKEND is left undefined and the
+ * core types use their plain scalar code.
+ *
+ * Lanes are always four reals wide. The core types keep their unused
+ * fourth component at zero, so the fourth lane can be carried through
+ * additions and multiplications without affecting anything.
+ */
+#ifndef CYCLONE_SIMD_H
+#define CYCLONE_SIMD_H
+
+#include <stddef.h>
+#include "precision.h"
+
+#if defined(CYCLONE_SIMD)
+    #if defined(__AVX__)
+        #define CYCLONE_SIMD_AVX
+    #elif defined(__SSE2__) || defined(_M_X64) || \
+        (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        #define CYCLONE_SIMD_SSE2
+    #elif defined(__ARM_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+        #define CYCLONE_SIMD_NEON
+    #endif
+#endif
+
+#if defined(CYCLONE_SIMD_AVX)
+    #include <immintrin.h>
+    #define CYCLONE_SIMD_BACKEND
+#elif defined(CYCLONE_SIMD_SSE2)
+    #include <emmintrin.h>
+    #define CYCLONE_SIMD_BACKEND
+#elif defined(CYCLONE_SIMD_NEON)
+    #include <arm_neon.h>
+    #define CYCLONE_SIMD_BACKEND
+#endif
+
+namespace cyclone {
+
+    /**
+     * The simd namespace holds the four lane types and the operations
+     * on them. Every function is inline; none of them allocate or
+     * branch.
+     */
+    namespace simd {
+
+        /**
+         * Gives the alignment, in bytes, that the core types need for
+         * reals of the given type: the width of four lanes, or the
+         * real's own alignment if there are no vector instructions.
+         */
+        template <class Real>
+        struct Alignment
+        {
+            static const size_t value = alignof(Real);
+        };
+
+#ifdef CYCLONE_SIMD_BACKEND
+
+        template <>
+        struct Alignment<float>
+        {
+            static const size_t value = 16;
+        };
+
+        template <>
+        struct Alignment<double>
+        {
+#if defined(CYCLONE_SIMD_AVX)
+            static const size_t value = 32;
+#else
+            static const size_t value = 16;
+#endif
+        };
+
+        /**
+         * Holds four reals of the given type in vector registers, and
+         * provides the operations on them as static functions.
+         */
+        template <class Real>
+        struct Lanes;
+
+#if defined(CYCLONE_SIMD_AVX)
+
+        template <>
+        struct Lanes<double>
+        {
+            __m256d v;
+
+            /**
+             * Loads four reals from an address aligned to
+             * Alignment<double> bytes.
+             */
+            static Lanes load(const double *p)
+            {
+                Lanes r = { _mm256_load_pd(p) };
+                return r;
+            }
+
+            /**
+             * Loads three reals from any address, without reading
+             * past them, and sets the fourth lane to zero.
+             */
+            static Lanes load3(const double *p)
+            {
+                __m128d lo = _mm_loadu_pd(p);
+                __m128d hi = _mm_load_sd(p + 2);
+                Lanes r = { _mm256_insertf128_pd(
+                    _mm256_castpd128_pd256(lo), hi, 1) };
+                return r;
+            }
+
+            /**
+             * Stores four reals to an address aligned to
+             * Alignment<double> bytes.
+             */
+            static void store(double *p, const Lanes &a)
+            {
+                _mm256_store_pd(p, a.v);
+            }
+
+            /**
+             * Stores four reals to any address.
+             */
+            static void storeUnaligned(double *p, const Lanes &a)
+            {
+                _mm256_storeu_pd(p, a.v);
+            }
+
+            /**
+             * Stores the first three lanes to any address, without
+             * writing past them.
+             */
+            static void store3(double *p, const Lanes &a)
+            {
+                _mm_storeu_pd(p, _mm256_castpd256_pd128(a.v));
+                _mm_store_sd(p + 2, _mm256_extractf128_pd(a.v, 1));
+            }
+
+            /**
+             * Builds a set of lanes from four reals, first lane first.
+             */
+            static Lanes set(double a, double b, double c, double d)
+            {
+                Lanes r = { _mm256_set_pd(d, c, b, a) };
+                return r;
+            }
+
+            /**
+             * Copies one real into every lane.
+             */
+            static Lanes splat(double a)
+            {
+                Lanes r = { _mm256_set1_pd(a) };
+                return r;
+            }
+
+            static Lanes add(const Lanes &a, const Lanes &b)
+            {
+                Lanes r = { _mm256_add_pd(a.v, b.v) };
+                return r;
+            }
+
+            static Lanes sub(const Lanes &a, const Lanes &b)
+            {
+                Lanes r = { _mm256_sub_pd(a.v, b.v) };
+                return r;
+            }
+
+            static Lanes mul(const Lanes &a, const Lanes &b)
+            {
+                Lanes r = { _mm256_mul_pd(a.v, b.v) };
+                return r;
+            }
+
+            /**
+             * Flips the sign of each lane of the first set where the
+             * second set holds negative zero. Set the other lanes of
+             * the second set to zero.
+             */
+            static Lanes flipSigns(const Lanes &a, const Lanes &signs)
+            {
+                Lanes r = { _mm256_xor_pd(a.v, signs.v) };
+                return r;
+            }
+
+            /**
+             * Swaps neighbouring lanes: (a, b, c, d) becomes
+             * (b, a, d, c).
+             */
+            static Lanes swapPairs(const Lanes &a)
+            {
+                Lanes r = { _mm256_permute_pd(a.v, 0x5) };
+                return r;
+            }
+
+            /**
+             * Swaps the two halves: (a, b, c, d) becomes (c, d, a, b).
+             */
+            static Lanes swapHalves(const Lanes &a)
+            {
+                Lanes r = { _mm256_permute2f128_pd(a.v, a.v, 0x1) };
+                return r;
+            }
+
+            /**
+             * Sets the fourth lane to zero, leaving the others.
+             */
+            static Lanes clearLast(const Lanes &a)
+            {
+                Lanes r = { _mm256_blend_pd(a.v, _mm256_setzero_pd(), 0x8) };
+                return r;
+            }
+
+            /**
+             * Returns the first lane.
+             */
+            static double first(const Lanes &a)
+            {
+                return _mm256_cvtsd_f64(a.v);
+            }
+
+            /**
+             * Returns the total of all four lanes.
+             */
+            static double sum(const Lanes &a)
+            {
+                __m128d pairs = _mm_add_pd(_mm256_castpd256_pd128(a.v),
+                    _mm256_extractf128_pd(a.v, 1));
+                return _mm_cvtsd_f64(_mm_add_sd(pairs,
+                    _mm_unpackhi_pd(pairs, pairs)));
+            }
+
+            /**
+             * Adds up the lanes of each of three sets, and returns the
+             * three totals in the first three lanes, with zero in the
+             * fourth.
+             */
+            static Lanes sum3(const Lanes &a, const Lanes &b, const Lanes &c)
+            {
+                __m256d ab = _mm256_hadd_pd(a.v, b.v);
+                __m256d cz = _mm256_hadd_pd(c.v, _mm256_setzero_pd());
+                Lanes r = { _mm256_add_pd(
+                    _mm256_permute2f128_pd(ab, cz, 0x20),
+                    _mm256_permute2f128_pd(ab, cz, 0x31)) };
+                return r;
+            }
+
+            /**
+             * Multiplies the first set of lanes by a real and adds the
+             * second: a * s + b. The multiply and add are rounded
+             * separately, as the scalar code is.
+             */
+            static Lanes scaleAdd(const Lanes &a, double s, const Lanes &b)
+            {
+                return add(mul(a, splat(s)), b);
+            }
+        };
+
+#else // CYCLONE_SIMD_SSE2 or CYCLONE_SIMD_NEON
+
+        /*
+         * These targets only hold two doubles per register, so each
+         * set of lanes is a pair of registers. The pair operations
+         * below are the only part that differs between them.
+         */
+    #if defined(CYCLONE_SIMD_SSE2)
+        typedef __m128d Pair;
+
+        inline Pair pairLoad(const double *p) { return _mm_load_pd(p); }
+        inline Pair pairLoadU(const double *p) { return _mm_loadu_pd(p); }
+        inline Pair pairLoadLow(const double *p) { return _mm_load_sd(p); }
+        inline void pairStore(double *p, Pair a) { _mm_store_pd(p, a); }
+        inline void pairStoreU(double *p, Pair a) { _mm_storeu_pd(p, a); }
+        inline void pairStoreLow(double *p, Pair a) { _mm_store_sd(p, a); }
+        inline Pair pairSet(double a, double b) { return _mm_set_pd(b, a); }
+        inline Pair pairSplat(double a) { return _mm_set1_pd(a); }
+        inline Pair pairZero() { return _mm_setzero_pd(); }
+        inline Pair pairAdd(Pair a, Pair b) { return _mm_add_pd(a, b); }
+        inline Pair pairSub(Pair a, Pair b) { return _mm_sub_pd(a, b); }
+        inline Pair pairMul(Pair a, Pair b) { return _mm_mul_pd(a, b); }
+        inline Pair pairXor(Pair a, Pair b) { return _mm_xor_pd(a, b); }
+        inline Pair pairSwap(Pair a) { return _mm_shuffle_pd(a, a, 0x1); }
+        inline Pair pairClearHigh(Pair a) { return _mm_move_sd(_mm_setzero_pd(), a); }
+        inline double pairFirst(Pair a) { return _mm_cvtsd_f64(a); }
+
+        /** Returns the total of each pair: (a0 + a1, b0 + b1). */
+        inline Pair pairSum(Pair a, Pair b)
+        {
+            return _mm_add_pd(_mm_unpacklo_pd(a, b), _mm_unpackhi_pd(a, b));
+        }
+    #else
+        typedef float64x2_t Pair;
+
+        inline Pair pairLoad(const double *p) { return vld1q_f64(p); }
+        inline Pair pairLoadU(const double *p) { return vld1q_f64(p); }
+        inline Pair pairLoadLow(const double *p)
+        {
+            return vcombine_f64(vld1_f64(p), vdup_n_f64(0));
+        }
+        inline void pairStore(double *p, Pair a) { vst1q_f64(p, a); }
+        inline void pairStoreU(double *p, Pair a) { vst1q_f64(p, a); }
+        inline void pairStoreLow(double *p, Pair a) { vst1_f64(p, vget_low_f64(a)); }
+        inline Pair pairSet(double a, double b)
+        {
+            return vcombine_f64(vdup_n_f64(a), vdup_n_f64(b));
+        }
+        inline Pair pairSplat(double a) { return vdupq_n_f64(a); }
+        inline Pair pairZero() { return vdupq_n_f64(0); }
+        inline Pair pairAdd(Pair a, Pair b) { return vaddq_f64(a, b); }
+        inline Pair pairSub(Pair a, Pair b) { return vsubq_f64(a, b); }
+        inline Pair pairMul(Pair a, Pair b) { return vmulq_f64(a, b); }
+        inline Pair pairXor(Pair a, Pair b)
+        {
+            return vreinterpretq_f64_u64(veorq_u64(
+                vreinterpretq_u64_f64(a), vreinterpretq_u64_f64(b)));
+        }
+        inline Pair pairSwap(Pair a) { return vextq_f64(a, a, 1); }
+        inline Pair pairClearHigh(Pair a) { return vsetq_lane_f64(0, a, 1); }
+        inline double pairFirst(Pair a) { return vgetq_lane_f64(a, 0); }
+        inline Pair pairSum(Pair a, Pair b) { return vpaddq_f64(a, b); }
+    #endif
+
+        template <>
+        struct Lanes<double>
+        {
+            Pair lo, hi;
+
+            static Lanes load(const double *p)
+            {
+                Lanes r = { pairLoad(p), pairLoad(p + 2) };
+                return r;
+            }
+
+            static Lanes load3(const double *p)
+            {
+                Lanes r = { pairLoadU(p), pairLoadLow(p + 2) };
+                return r;
+            }
+
+            static void store(double *p, const Lanes &a)
+            {
+                pairStore(p, a.lo);
+                pairStore(p + 2, a.hi);
+            }
+
+            static void storeUnaligned(double *p, const Lanes &a)
+            {
+                pairStoreU(p, a.lo);
+                pairStoreU(p + 2, a.hi);
+            }
+
+            static void store3(double *p, const Lanes &a)
+            {
+                pairStoreU(p, a.lo);
+                pairStoreLow(p + 2, a.hi);
+            }
+
+            static Lanes set(double a, double b, double c, double d)
+            {
+                Lanes r = { pairSet(a, b), pairSet(c, d) };
+                return r;
+            }
+
+            static Lanes splat(double a)
+            {
+                Pair p = pairSplat(a);
+                Lanes r = { p, p };
+                return r;
+            }
+
+            static Lanes add(const Lanes &a, const Lanes &b)
+            {
+                Lanes r = { pairAdd(a.lo, b.lo), pairAdd(a.hi, b.hi) };
+                return r;
+            }
+
+            static Lanes sub(const Lanes &a, const Lanes &b)
+            {
+                Lanes r = { pairSub(a.lo, b.lo), pairSub(a.hi, b.hi) };
+                return r;
+            }
+
+            static Lanes mul(const Lanes &a, const Lanes &b)
+            {
+                Lanes r = { pairMul(a.lo, b.lo), pairMul(a.hi, b.hi) };
+                return r;
+            }
+
+            static Lanes flipSigns(const Lanes &a, const Lanes &signs)
+            {
+                Lanes r = { pairXor(a.lo, signs.lo), pairXor(a.hi, signs.hi) };
+                return r;
+            }
+
+            static Lanes swapPairs(const Lanes &a)
+            {
+                Lanes r = { pairSwap(a.lo), pairSwap(a.hi) };
+                return r;
+            }
+
+            static Lanes swapHalves(const Lanes &a)
+            {
+                Lanes r = { a.hi, a.lo };
+                return r;
+            }
+
+            static Lanes clearLast(const Lanes &a)
+            {
+                Lanes r = { a.lo, pairClearHigh(a.hi) };
+                return r;
+            }
+
+            static double first(const Lanes &a)
+            {
+                return pairFirst(a.lo);
+            }
+
+            static double sum(const Lanes &a)
+            {
+                Pair pairs = pairAdd(a.lo, a.hi);
+                return pairFirst(pairSum(pairs, pairs));
+            }
+
+            static Lanes sum3(const Lanes &a, const Lanes &b, const Lanes &c)
+            {
+                Lanes r = {
+                    pairSum(pairAdd(a.lo, a.hi), pairAdd(b.lo, b.hi)),
+                    pairSum(pairAdd(c.lo, c.hi), pairZero())
+                };
+                return r;
+            }
+
+            static Lanes scaleAdd(const Lanes &a, double s, const Lanes &b)
+            {
+                return add(mul(a, splat(s)), b);
+            }
+        };
+
+#endif
+
+#if defined(CYCLONE_SIMD_NEON)
+
+        template <>
+        struct Lanes<float>
+        {
+            float32x4_t v;
+
+            static Lanes load(const float *p)
+            {
+                Lanes r = { vld1q_f32(p) };
+                return r;
+            }
+
+            static Lanes load3(const float *p)
+            {
+                Lanes r = { vcombine_f32(vld1_f32(p),
+                    vld1_lane_f32(p + 2, vdup_n_f32(0), 0)) };
+                return r;
+            }
+
+            static void store(float *p, const Lanes &a)
+            {
+                vst1q_f32(p, a.v);
+            }
+
+            static void storeUnaligned(float *p, const Lanes &a)
+            {
+                vst1q_f32(p, a.v);
+            }
+
+            static void store3(float *p, const Lanes &a)
+            {
+                vst1_f32(p, vget_low_f32(a.v));
+                vst1q_lane_f32(p + 2, a.v, 2);
+            }
+
+            static Lanes set(float a, float b, float c, float d)
+            {
+                float values[4] = { a, b, c, d };
+                Lanes r = { vld1q_f32(values) };
+                return r;
+            }
+
+            static Lanes splat(float a)
+            {
+                Lanes r = { vdupq_n_f32(a) };
+                return r;
+            }
+
+            static Lanes add(const Lanes &a, const Lanes &b)
+            {
+                Lanes r = { vaddq_f32(a.v, b.v) };
+                return r;
+            }
+
+            static Lanes sub(const Lanes &a, const Lanes &b)
+            {
+                Lanes r = { vsubq_f32(a.v, b.v) };
+                return r;
+            }
+
+            static Lanes mul(const Lanes &a, const Lanes &b)
+            {
+                Lanes r = { vmulq_f32(a.v, b.v) };
+                return r;
+            }
+
+            static Lanes flipSigns(const Lanes &a, const Lanes &signs)
+            {
+                Lanes r = { vreinterpretq_f32_u32(veorq_u32(
+                    vreinterpretq_u32_f32(a.v),
+                    vreinterpretq_u32_f32(signs.v))) };
+                return r;
+            }
+
+            static Lanes swapPairs(const Lanes &a)
+            {
+                Lanes r = { vrev64q_f32(a.v) };
+                return r;
+            }
+
+            static Lanes swapHalves(const Lanes &a)
+            {
+                Lanes r = { vextq_f32(a.v, a.v, 2) };
+                return r;
+            }
+
+            static Lanes clearLast(const Lanes &a)
+            {
+                Lanes r = { vsetq_lane_f32(0, a.v, 3) };
+                return r;
+            }
+
+            static float first(const Lanes &a)
+            {
+                return vgetq_lane_f32(a.v, 0);
+            }
+
+            static float sum(const Lanes &a)
+            {
+                return vaddvq_f32(a.v);
+            }
+
+            static Lanes sum3(const Lanes &a, const Lanes &b, const Lanes &c)
+            {
+                float32x4_t ab = vpaddq_f32(a.v, b.v);
+                float32x4_t cz = vpaddq_f32(c.v, vdupq_n_f32(0));
+                Lanes r = { vpaddq_f32(ab, cz) };
+                return r;
+            }
+
+            static Lanes scaleAdd(const Lanes &a, float s, const Lanes &b)
+            {
+                return add(mul(a, splat(s)), b);
+            }
+        };
+
+#else // CYCLONE_SIMD_AVX or CYCLONE_SIMD_SSE2
+
+        template <>
+        struct Lanes<float>
+        {
+            __m128 v;
+
+            static Lanes load(const float *p)
+            {
+                Lanes r = { _mm_load_ps(p) };
+                return r;
+            }
+
+            static Lanes load3(const float *p)
+            {
+                Lanes r = { _mm_set_ps(0, p[2], p[1], p[0]) };
+                return r;
+            }
+
+            static void store(float *p, const Lanes &a)
+            {
+                _mm_store_ps(p, a.v);
+            }
+
+            static void storeUnaligned(float *p, const Lanes &a)
+            {
+                _mm_storeu_ps(p, a.v);
+            }
+
+            static void store3(float *p, const Lanes &a)
+            {
+                _mm_storel_pi((__m64*)p, a.v);
+                _mm_store_ss(p + 2, _mm_movehl_ps(a.v, a.v));
+            }
+
+            static Lanes set(float a, float b, float c, float d)
+            {
+                Lanes r = { _mm_set_ps(d, c, b, a) };
+                return r;
+            }
+
+            static Lanes splat(float a)
+            {
+                Lanes r = { _mm_set1_ps(a) };
+                return r;
+            }
+
+            static Lanes add(const Lanes &a, const Lanes &b)
+            {
+                Lanes r = { _mm_add_ps(a.v, b.v) };
+                return r;
+            }
+
+            static Lanes sub(const Lanes &a, const Lanes &b)
+            {
+                Lanes r = { _mm_sub_ps(a.v, b.v) };
+                return r;
+            }
+
+            static Lanes mul(const Lanes &a, const Lanes &b)
+            {
+                Lanes r = { _mm_mul_ps(a.v, b.v) };
+                return r;
+            }
+
+            static Lanes flipSigns(const Lanes &a, const Lanes &signs)
+            {
+                Lanes r = { _mm_xor_ps(a.v, signs.v) };
+                return r;
+            }
+
+            static Lanes swapPairs(const Lanes &a)
+            {
+                Lanes r = { _mm_shuffle_ps(a.v, a.v, _MM_SHUFFLE(2, 3, 0, 1)) };
+                return r;
+            }
+
+            static Lanes swapHalves(const Lanes &a)
+            {
+                Lanes r = { _mm_shuffle_ps(a.v, a.v, _MM_SHUFFLE(1, 0, 3, 2)) };
+                return r;
+            }
+
+            static Lanes clearLast(const Lanes &a)
+            {
+                __m128 high = _mm_unpackhi_ps(a.v, _mm_setzero_ps());
+                Lanes r = { _mm_movelh_ps(a.v, high) };
+                return r;
+            }
+
+            static float first(const Lanes &a)
+            {
+                return _mm_cvtss_f32(a.v);
+            }
+
+            static float sum(const Lanes &a)
+            {
+                __m128 pairs = _mm_add_ps(a.v, _mm_movehl_ps(a.v, a.v));
+                return _mm_cvtss_f32(_mm_add_ss(pairs,
+                    _mm_shuffle_ps(pairs, pairs, _MM_SHUFFLE(1, 1, 1, 1))));
+            }
+
+            static Lanes sum3(const Lanes &a, const Lanes &b, const Lanes &c)
+            {
+                __m128 t0 = a.v, t1 = b.v, t2 = c.v, t3 = _mm_setzero_ps();
+                _MM_TRANSPOSE4_PS(t0, t1, t2, t3);
+                Lanes r = { _mm_add_ps(_mm_add_ps(t0, t1), _mm_add_ps(t2, t3)) };
+                return r;
+            }
+
+            static Lanes scaleAdd(const Lanes &a, float s, const Lanes &b)
+            {
+                return add(mul(a, splat(s)), b);
+            }
+        };
+
+#endif
+
+#endif // CYCLONE_SIMD_BACKEND
+
+    } // namespace simd
+
+} // namespace cyclone
+
+#endif // CYCLONE_SIMD_H
@@ -0,0 +1,98 @@
+/*
+ * Implementation file for the worker thread pool.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+#include <threadpool.h>
+
+using namespace cyclone;
+
+ThreadPool::ThreadPool(unsigned workers)
+    : job(0), taskCount(0), nextTask(0), busy(0), generation(0),
+      stopping(false)
+{
+    if (workers == 0) workers = std::thread::hardware_concurrency();
+    if (workers == 0) workers = 1;
+
+    // The calling thread is worker zero.
+    for (unsigned i = 1; i < workers; i++)
+    {
+        threads.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (unsigned i = 0; i < threads.size(); i++) threads[i].join();
+}
+
+void ThreadPool::run(unsigned taskCount, const Job &job)
+{
+    if (taskCount == 0) return;
+
+    // Not worth waking anyone for a single task.
+    if (threads.empty() || taskCount == 1)
+    {
+        for (unsigned i = 0; i < taskCount; i++) job(i, 0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ThreadPool::job = &job;
+        ThreadPool::taskCount = taskCount;
+        nextTask = 0;
+        busy = (unsigned)threads.size();
+        generation++;
+    }
+    wake.notify_all();
+
+    work(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return busy == 0; });
+    ThreadPool::job = 0;
+}
+
+void ThreadPool::workerLoop(unsigned worker)
+{
+    unsigned seen = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this, seen] {
+                return stopping || generation != seen;
+            });
+            if (stopping) return;
+            seen = generation;
+        }
+
+        work(worker);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--busy == 0) done.notify_one();
+    }
+}
+
+void ThreadPool::work(unsigned worker)
+{
+    for (;;)
+    {
+        unsigned task = nextTask++;
+        if (task >= taskCount) return;
+        (*job)(task, worker);
+    }
+}
@@ -0,0 +1,124 @@
+/*
+ * Interface file for the worker thread pool.
+ *
+ * Part of the Cyclone physics system.
+ *
+ * Copyright (c) Icosagon 2003. All Rights Reserved.
+ *
+ * This software is distributed under licence. Use of this software
+ * implies agreement with all terms and conditions of the accompanying
+ * software licence.
+ */
+
+/**
+ * @file
+ *
+ * This file contains a small pool of worker threads used to spread
+ * independent pieces of simulation work, such as narrowphase pair
+ * tests, across the available cores.
+ */
+#ifndef CYCLONE_THREADPOOL_H
+#define CYCLONE_THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cyclone {
+
+    /**
+     * A fixed set of worker threads that run batches of tasks.
+     *
+     * A batch is a number of tasks and a job to call for each of
+     * them. The job is given the task index and the index of the
+     * worker running it, so it can write into per-worker storage
+     * without locking. The calling thread joins in as worker zero,
+     * and run does not return until every task is done. Tasks are
+     * handed out in index order, but which worker gets which task
+     * varies from run to run: jobs that need a deterministic result
+     * should record their output per task, not per worker.
+     */
+    class ThreadPool
+    {
+    public:
+        /**
+         * The job run for each task: it is passed the task index and
+         * the index of the worker running it.
+         */
+        typedef std::function<void(unsigned task, unsigned worker)> Job;
+
+        /**
+         * Creates a pool with the given total number of workers,
+         * including the calling thread. Zero picks one worker for
+         * each hardware thread.
+         */
+        explicit ThreadPool(unsigned workers = 0);
+
+        /**
+         * Stops and joins the worker threads.
+         */
+        ~ThreadPool();
+
+        /**
+         * Returns the number of workers, including the calling
+         * thread. Worker indices are below this.
+         */
+        unsigned getWorkerCount() const
+        {
+            return (unsigned)threads.size() + 1;
+        }
+
+        /**
+         * Runs the job for each of the given number of tasks, and
+         * waits for them all to finish.
+         */
+        void run(unsigned taskCount, const Job &job);
+
+    protected:
+        /** The worker threads, not including the calling thread. */
+        std::vector<std::thread> threads;
+
+        /** Guards the batch data below. */
+        std::mutex mutex;
+
+        /** Signalled when a new batch starts or the pool stops. */
+        std::condition_variable wake;
+
+        /** Signalled when the last worker finishes its share. */
+        std::condition_variable done;
+
+        /** The job for the current batch. */
+        const Job *job;
+
+        /** The number of tasks in the current batch. */
+        unsigned taskCount;
+
+        /** The next task to hand out. */
+        std::atomic<unsigned> nextTask;
+
+        /** The number of worker threads still busy on this batch. */
+        unsigned busy;
+
+        /** Counts batches, so workers can tell a new one has come. */
+        unsigned generation;
+
+        /** Set when the pool is being destroyed. */
+        bool stopping;
+
+        /**
+         * The loop run by each worker thread.
+         */
+        void workerLoop(unsigned worker);
+
+        /**
+         * Runs tasks from the current batch until there are none left.
+         */
+        void work(unsigned worker);
+    };
+
+} // namespace cyclone
+
+#endif // CYCLONE_THREADPOOL_H
@@ -156,103 +156,101 @@ void drawFloor(float size, int nSquares)
 
 //*************************************************************************
 //
-// Shadows
-// * Before drawing the floor, setup the stencil buffer and enable depth testing
-// * A trick: because we only want to draw the shadows
-//            on the ground plane, when we draw the ground plane
-//            we'll set the stencil buffer to 1. then we'll only
-//            draw shadows where the stencil buffer is one, so we
-//            don't have shadows floating in space
+// * Convert from mouse coordinates to world coordinates
+//   in a sense, this mimics the old fashioned gl's mapw
+//   the only advantage is that we don't have to pick the near clipping
+//   plane, so we can be a little more well-balanced
+//   this code mimics page 147 of the OpenGL book
 //===============================================================================
-void setupFloor(void)
+int getMouseLine(double &x1, double &y1, double &z1, double &x2, double &y2, double &z2)
 //===============================================================================
 {
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_STENCIL_TEST);
-    glStencilFunc(GL_ALWAYS, 0x1, 0x1);
-    glStencilOp(GL_REPLACE, GL_REPLACE, GL_REPLACE);
-    glStencilMask(0x1); // only deal with the 1st bit
+    double mat1[16], mat2[16]; // we have to deal with the projection matrices
+    int viewport[4];
+
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glGetDoublev(GL_MODELVIEW_MATRIX, mat1);
+    glGetDoublev(GL_PROJECTION_MATRIX, mat2);
+
+    return getMouseLine(mat1, mat2, viewport, x1, y1, z1, x2, y2, z2);
 }
 
-//*************************************************************************
-//
-// These are cheap "hack" shadows - basically just squish the objects onto the floor.
-//
-// * We'll use a projection matrix to do the squishing (basically set the
-//   Y component to zero)
-// * We'll also need to turn off lighting (since we want the objects to be black)
-// * To make things look nice, we'll draw the shadows as transparent (so
-//   we can see the groundplane)
-// * To avoid Z-Fighting (since the shadows are on the ground), we'll turn
-//   off the Z-Buffer - although, this means we'll see the shadows through
-//   the floor
-// * Finally, we'll use the stencil buffer to only draw where the ground
-//   has already been drawn - this way we won't have shadows floating in
-//   space!
 //===============================================================================
-void setupShadows(void)
+int getMouseLine(const double modelview[16], const double projection[16], const int viewport[4],
+                 double &x1, double &y1, double &z1, double &x2, double &y2, double &z2)
 //===============================================================================
 {
-    glDisable(GL_LIGHTING);
-    glDisable(GL_DEPTH_TEST);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    int x = Fl::event_x();
+    int y = viewport[3] - Fl::event_y(); // originally had an extra -1?
 
-    glEnable(GL_STENCIL_TEST);
-    glStencilFunc(GL_EQUAL, 0x1, 0x1);
-    glStencilOp(GL_KEEP, GL_ZERO, GL_ZERO);
-    glStencilMask(0x1); // only deal with the 1st bit
+    // gluUnProject is plain arithmetic, it doesn't talk to GL
+    int i1 = gluUnProject((double) x, (double) y, .25, modelview, projection, viewport, &x1, &y1, &z1);
+    int i2 = gluUnProject((double) x, (double) y, .75, modelview, projection, viewport, &x2, &y2, &z2);
 
-    glPushMatrix();
-    // a matrix that squishes things onto the floor
-    float sm[16] = {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
-    glMultMatrixf(sm);
-    // draw in transparent black (to dim the floor)
-    glColor4f(0, 0, 0, .5);
+    return i1 && i2;
 }
 
-//*************************************************************************
-//
-// * Warning - this puts things back to a "normal" state, not
-//   necessarily where they were before setupShadows
 //===============================================================================
-void unsetupShadows(void)
+int getMouseRay(const double modelview[16], const double projection[16], const int viewport[4],
+                double origin[3], double direction[3])
 //===============================================================================
 {
-    glPopMatrix();
-    glEnable(GL_DEPTH_TEST);
-    glDisable(GL_STENCIL_TEST);
-    glDisable(GL_BLEND);
-}
+    int x = Fl::event_x();
+    int y = viewport[3] - Fl::event_y();
 
+    double end[3];
+    int i1 = gluUnProject((double) x, (double) y, 0.0, modelview, projection, viewport, &origin[0], &origin[1],
+                          &origin[2]);
+    int i2 = gluUnProject((double) x, (double) y, 1.0, modelview, projection, viewport, &end[0], &end[1], &end[2]);
+    for (int i = 0; i < 3; i++)
+        direction[i] = end[i] - origin[i];
+
+    return i1 && i2;
+}
 
-//*************************************************************************
-//
-// * Convert from mouse coordinates to world coordinates
-//   in a sense, this mimics the old fashioned gl's mapw
-//   the only advantage is that we don't have to pick the near clipping
-//   plane, so we can be a little more well-balanced
-//   this code mimics page 147 of the OpenGL book
 //===============================================================================
-int getMouseLine(double &x1, double &y1, double &z1, double &x2, double &y2, double &z2)
+void orthoMatrix(double m[16], double left, double right, double bottom, double top, double zNear, double zFar)
 //===============================================================================
 {
-    int x = Fl::event_x();
-    int iy = Fl::event_y();
-
-    double mat1[16], mat2[16]; // we have to deal with the projection matrices
-    int viewport[4];
-
-    glGetIntegerv(GL_VIEWPORT, viewport);
-    glGetDoublev(GL_MODELVIEW_MATRIX, mat1);
-    glGetDoublev(GL_PROJECTION_MATRIX, mat2);
-
-    int y = viewport[3] - iy; // originally had an extra -1?
-
-    int i1 = gluUnProject((double) x, (double) y, .25, mat1, mat2, viewport, &x1, &y1, &z1);
-    int i2 = gluUnProject((double) x, (double) y, .75, mat1, mat2, viewport, &x2, &y2, &z2);
+    for (int i = 0; i < 16; i++)
+        m[i] = 0;
+    m[0] = 2 / (right - left);
+    m[5] = 2 / (top - bottom);
+    m[10] = -2 / (zFar - zNear);
+    m[12] = -(right + left) / (right - left);
+    m[13] = -(top + bottom) / (top - bottom);
+    m[14] = -(zFar + zNear) / (zFar - zNear);
+    m[15] = 1;
+}
 
-    return i1 && i2;
+//===============================================================================
+void lookAtMatrix(double m[16], double eyeX, double eyeY, double eyeZ, double centerX, double centerY,
+                  double centerZ, double upX, double upY, double upZ)
+//===============================================================================
+{
+    // forward, side and true up, as gluLookAt builds them
+    double f[3] = {centerX - eyeX, centerY - eyeY, centerZ - eyeZ};
+    double fl = sqrt(f[0] * f[0] + f[1] * f[1] + f[2] * f[2]);
+    for (int i = 0; i < 3; i++)
+        f[i] /= fl;
+
+    double s[3] = {f[1] * upZ - f[2] * upY, f[2] * upX - f[0] * upZ, f[0] * upY - f[1] * upX};
+    double sl = sqrt(s[0] * s[0] + s[1] * s[1] + s[2] * s[2]);
+    for (int i = 0; i < 3; i++)
+        s[i] /= sl;
+
+    double u[3] = {s[1] * f[2] - s[2] * f[1], s[2] * f[0] - s[0] * f[2], s[0] * f[1] - s[1] * f[0]};
+
+    for (int i = 0; i < 3; i++) {
+        m[i * 4 + 0] = s[i];
+        m[i * 4 + 1] = u[i];
+        m[i * 4 + 2] = -f[i];
+        m[i * 4 + 3] = 0;
+    }
+    m[12] = -(s[0] * eyeX + s[1] * eyeY + s[2] * eyeZ);
+    m[13] = -(u[0] * eyeX + u[1] * eyeY + u[2] * eyeZ);
+    m[14] = f[0] * eyeX + f[1] * eyeY + f[2] * eyeZ;
+    m[15] = 1;
 }
 
 
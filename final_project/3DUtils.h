@@ -45,25 +45,6 @@ extern float floorColor2[3];
 //************************************************************************
 void drawFloor(float size = 10, int nSquares = 8);
 
-//************************************************************************
-// Code for doing shadows with the stencil buffer and blending
-//************************************************************************
-// Warning: these routines change the opengl state, and may not
-// return it to where you want it to be! (a better implementation
-// would save state)
-// how to use:
-//   1) call "setupFloor" :  draw your groundplane
-//   2) call "setupShadows" :  draw your objects without any colors (otherwise,
-//                             you'll get colored shadows
-//   3) call "unsetupShadows": draw your objects normally (with lighting, colors, ...)
-
-// Before drawing the floor, setup the stencil buffer and enable depth testing
-void setupFloor(void);
-// Set up the projection matrix to project the shadow onto the floor.
-void setupShadows(void);
-// Set it back to original projection matrix
-void unsetupShadows(void);
-
 //************************************************************************
 // stuff for mouse handling
 //************************************************************************
@@ -72,6 +53,21 @@ void unsetupShadows(void);
 // it is in 3D. of course, its not in one place, its a line
 // this function gets that ray for you (well, it gets 2 points on the line)
 int getMouseLine(double &p1x, double &p1y, double &p1z, double &p2x, double &p2y, double &p2z);
+// The same, using camera matrices the caller already has instead of reading
+// them back from GL
+int getMouseLine(const double modelview[16], const double projection[16], const int viewport[4],
+                 double &p1x, double &p1y, double &p1z, double &p2x, double &p2y, double &p2z);
+// The whole mouse ray, from the near clipping plane to the far one. The
+// direction runs the full depth of the view, so it isn't a unit vector.
+int getMouseRay(const double modelview[16], const double projection[16], const int viewport[4],
+                double origin[3], double direction[3]);
+
+// Column-major matrices matching glOrtho and gluLookAt, for code that
+// needs to keep the camera on the CPU side
+void orthoMatrix(double m[16], double left, double right, double bottom, double top, double zNear,
+                 double zFar);
+void lookAtMatrix(double m[16], double eyeX, double eyeY, double eyeZ, double centerX, double centerY,
+                  double centerZ, double upX, double upY, double upZ);
 
 //************************************************************************
 //
@@ -1,6 +1,8 @@
 #ifndef FLOOR_H
 #define FLOOR_H
 
+#include "RenderQueue.h"
+
 #include <GL/glut.h>
 #include <cyclone.h>
 
@@ -10,17 +12,19 @@ public:
     ~Floor();
 
     // Drawing methods
-    void draw(GLuint textureID);
+    void queueDraw(RenderQueue &queue, GLuint textureID);
 
     // Physics properties
-    cyclone::RigidBody *getBody() const { return body; }
+    cyclone::RigidBody *getBody() { return &body; }
     void setPosition(const cyclone::Vector3 &pos);
-    cyclone::Vector3 getPosition() const { return body->getPosition(); }
+    cyclone::Vector3 getPosition() const { return body.getPosition(); }
 
 private:
-    cyclone::RigidBody *body;
+    // Held in place rather than on the heap
+    cyclone::RigidBody body;
     float size; // Size of the floor
     float height; // Height of the floor (y position)
+    Mesh mesh; // Textured quad, built once
 };
 
 #endif // FLOOR_H
@@ -0,0 +1,82 @@
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <thread>
+
+constexpr std::chrono::microseconds FramePacer::spinMargin;
+
+FramePacer::FramePacer(int framesPerSecond) {
+    frameTimes.reserve(historySize);
+    setFrameRate(framesPerSecond);
+    deadline = Clock::now();
+}
+
+void FramePacer::setFrameRate(int framesPerSecond) {
+    this->framesPerSecond = std::max(framesPerSecond, 1);
+    period = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(1.0 / this->framesPerSecond));
+
+    // Start the new rate from the last frame, so a slower rate doesn't wait
+    // out a deadline set by the faster one
+    if (started) {
+        deadline = lastFrame + period;
+    }
+}
+
+double FramePacer::getSecondsToSleep() const {
+    const Clock::duration remaining = deadline - spinMargin - Clock::now();
+    if (remaining <= Clock::duration::zero()) {
+        return 0;
+    }
+    return std::chrono::duration<double>(remaining).count();
+}
+
+void FramePacer::waitForFrame() {
+    std::this_thread::sleep_until(deadline - spinMargin);
+    Clock::time_point now = Clock::now();
+    while (now < deadline) {
+        std::this_thread::yield();
+        now = Clock::now();
+    }
+
+    if (started) {
+        const double frameTime = std::chrono::duration<double, std::milli>(now - lastFrame).count();
+        if (frameTimes.size() < historySize) {
+            frameTimes.push_back(frameTime);
+        } else {
+            frameTimes[nextFrameTime] = frameTime;
+        }
+        nextFrameTime = (nextFrameTime + 1) % historySize;
+    }
+    lastFrame = now;
+    started = true;
+    advanceDeadline(now);
+}
+
+void FramePacer::skipFrame() {
+    started = false;
+    advanceDeadline(Clock::now());
+}
+
+void FramePacer::advanceDeadline(Clock::time_point now) {
+    deadline += period;
+    if (deadline < now) {
+        // Missed the frame: carry on a period from now
+        deadline = now + period;
+    }
+}
+
+FrameTimeStats FramePacer::getStats() const {
+    FrameTimeStats stats;
+    if (frameTimes.empty()) {
+        return stats;
+    }
+
+    std::vector<double> sorted(frameTimes);
+    std::sort(sorted.begin(), sorted.end());
+    const size_t last = sorted.size() - 1;
+    stats.p50 = sorted[last / 2];
+    stats.p99 = sorted[last * 99 / 100];
+    stats.max = sorted[last];
+    return stats;
+}
@@ -0,0 +1,66 @@
+#ifndef FRAMEPACER_H
+#define FRAMEPACER_H
+
+#include <chrono>
+#include <vector>
+
+// Frame times over the recent frames, in milliseconds
+struct FrameTimeStats {
+    double p50 = 0;
+    double p99 = 0;
+    double max = 0;
+};
+
+// Paces frames to a target rate against the monotonic clock.
+//
+// Each frame has a deadline one period after the last. Waiting for it
+// sleeps until just short of the deadline, then spins the rest of the
+// way: sleeping alone can wake a scheduler tick late, and spinning alone
+// burns a core. A frame that runs more than a period late moves the
+// deadlines on from now, rather than rushing frames out to catch up.
+//
+// The time between the frames is kept for the last historySize frames,
+// to report how evenly they came.
+class FramePacer {
+public:
+    // How long before the deadline sleeping stops and spinning starts
+    static constexpr std::chrono::microseconds spinMargin{1500};
+
+    explicit FramePacer(int framesPerSecond = 60);
+
+    void setFrameRate(int framesPerSecond);
+    int getFrameRate() const { return framesPerSecond; }
+
+    // How long the caller may sleep, or wait on events, before it has to
+    // call waitForFrame. Zero once the deadline is within the spin margin.
+    double getSecondsToSleep() const;
+
+    // Sleeps then spins until the next frame's deadline, and starts the frame
+    void waitForFrame();
+
+    // Lets the next frame's deadline pass with nothing drawn. The gap until
+    // the next frame drawn isn't counted as a frame time.
+    void skipFrame();
+
+    // Percentiles of the recent frame times
+    FrameTimeStats getStats() const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    static const unsigned historySize = 240;
+
+    int framesPerSecond;
+    Clock::duration period;
+    Clock::time_point deadline;
+    Clock::time_point lastFrame;
+    bool started = false;
+
+    // A ring of the last frame times, in milliseconds
+    std::vector<double> frameTimes;
+    unsigned nextFrameTime = 0;
+
+    void advanceDeadline(Clock::time_point now);
+};
+
+#endif // FRAMEPACER_H
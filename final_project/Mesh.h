@@ -44,6 +44,11 @@ public:
         textureCoords.push_back(v);
     }
 
+    // Coarser versions of the mesh, from buildLevelsOfDetail, each an index
+    // list into the same vertices. The mesh's own indices are level 0.
+    const std::vector<std::vector<unsigned int>>& getLevelsOfDetail() const { return levelsOfDetail; }
+    void setLevelsOfDetail(const std::vector<std::vector<unsigned int>>& levels) { levelsOfDetail = levels; }
+
     void SetBoundingBox(const cyclone::Vector3 &min, const cyclone::Vector3 &max) {
         bboxMin = min;
         bboxMax = max;
@@ -55,38 +60,7 @@ public:
         indices.clear();
         normals.clear();
         textureCoords.clear();
-    }
-
-    void Mesh::drawModel(const Mesh &modelMesh, const GLuint textureID) {
-        glEnable(GL_TEXTURE_2D);
-        glEnable(GL_LIGHTING);
-        glColor3f(1.0f, 1.0f, 1.0f); // Set color to white for texture mapping
-        glBindTexture(GL_TEXTURE_2D, textureID); // <-- bind your texture
-
-        glEnableClientState(GL_VERTEX_ARRAY);
-        glVertexPointer(3, GL_FLOAT, 0, modelMesh.getVertices().data());
-
-        if (!modelMesh.getNormals().empty()) {
-            glEnableClientState(GL_NORMAL_ARRAY);
-            glNormalPointer(GL_FLOAT, 0, modelMesh.getNormals().data());
-        }
-
-        if (!modelMesh.getTextureCoords().empty()) {
-            glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-            glTexCoordPointer(2, GL_FLOAT, 0, modelMesh.getTextureCoords().data()); // <-- setup UVs
-        }
-
-        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(modelMesh.getIndices().size()), GL_UNSIGNED_INT, modelMesh.getIndices().data());
-
-        glDisableClientState(GL_VERTEX_ARRAY);
-        if (!modelMesh.getNormals().empty())
-            glDisableClientState(GL_NORMAL_ARRAY);
-        if (!modelMesh.getTextureCoords().empty())
-            glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-
-
-        glDisable(GL_TEXTURE_2D);
-        glDisable(GL_LIGHTING); // Disable lighting after drawing the model
+        levelsOfDetail.clear();
     }
 
     cyclone::Vector3 bboxMin;
@@ -96,6 +70,7 @@ private:
     std::vector<float> normals; // Stores normal vectors
     std::vector<float> textureCoords; // Stores texture coordinates
     std::vector<unsigned int> indices; // Stores indices for indexed drawing
+    std::vector<std::vector<unsigned int>> levelsOfDetail; // Index lists of the coarser levels
 };
 
 #endif //MESH_H
@@ -0,0 +1,139 @@
+#include "MeshCache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+MeshCache::~MeshCache() {
+    clear();
+}
+
+const GpuMesh &MeshCache::get(const Mesh &mesh) {
+    auto found = meshes.find(&mesh);
+    if (found != meshes.end()) {
+        return found->second;
+    }
+    return meshes.emplace(&mesh, upload(mesh, nextId++)).first->second;
+}
+
+void MeshCache::release(const Mesh &mesh) {
+    auto found = meshes.find(&mesh);
+    if (found != meshes.end()) {
+        destroy(found->second);
+        meshes.erase(found);
+    }
+}
+
+void MeshCache::clear() {
+    for (auto &entry: meshes) {
+        destroy(entry.second);
+    }
+    meshes.clear();
+}
+
+GpuMesh MeshCache::upload(const Mesh &mesh, unsigned id) {
+    GpuMesh gpu;
+    gpu.id = id;
+    gpu.indexCount = static_cast<GLsizei>(mesh.getIndices().size());
+    if (gpu.indexCount == 0) {
+        return gpu;
+    }
+
+    // The full mesh, then each coarser level, in one index buffer
+    std::vector<unsigned int> indices(mesh.getIndices());
+    gpu.levelCount[0] = gpu.indexCount;
+    for (const auto &level: mesh.getLevelsOfDetail()) {
+        if (gpu.levels == GpuMesh::maxLevels) {
+            break;
+        }
+        gpu.levelFirst[gpu.levels] = static_cast<GLsizei>(indices.size());
+        gpu.levelCount[gpu.levels] = static_cast<GLsizei>(level.size());
+        indices.insert(indices.end(), level.begin(), level.end());
+        gpu.levels++;
+    }
+
+    const std::vector<float> &vertices = mesh.getVertices();
+    const std::vector<float> &normals = mesh.getNormals();
+    const std::vector<float> &textureCoords = mesh.getTextureCoords();
+    const size_t vertexCount = vertices.size() / 3;
+    const bool hasNormals = !normals.empty() && normals.size() >= vertexCount * 3;
+    const bool hasTextureCoords = !textureCoords.empty() && textureCoords.size() >= vertexCount * 2;
+
+    // Interleave the attributes so each vertex is fetched from one place
+    std::vector<float> interleaved(vertexCount * floatsPerVertex, 0.0f);
+    for (size_t i = 0; i < vertexCount; i++) {
+        float *vertex = &interleaved[i * floatsPerVertex];
+        vertex[0] = vertices[3 * i + 0];
+        vertex[1] = vertices[3 * i + 1];
+        vertex[2] = vertices[3 * i + 2];
+        gpu.radius = std::max(gpu.radius, std::sqrt(vertex[0] * vertex[0] + vertex[1] * vertex[1] +
+                                                     vertex[2] * vertex[2]));
+        if (hasNormals) {
+            vertex[3] = normals[3 * i + 0];
+            vertex[4] = normals[3 * i + 1];
+            vertex[5] = normals[3 * i + 2];
+        }
+        if (hasTextureCoords) {
+            vertex[6] = textureCoords[2 * i + 0];
+            vertex[7] = textureCoords[2 * i + 1];
+        }
+    }
+
+    glGenBuffers(1, &gpu.vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, gpu.vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, interleaved.size() * sizeof(float), interleaved.data(), GL_STATIC_DRAW);
+
+    const GLsizei stride = floatsPerVertex * sizeof(float);
+
+    // The index buffer binding is part of each vertex array object
+    glGenVertexArrays(1, &gpu.vao);
+    glBindVertexArray(gpu.vao);
+    glGenBuffers(1, &gpu.indexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gpu.indexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+
+    glEnableVertexAttribArray(POSITION_ATTRIBUTE);
+    glVertexAttribPointer(POSITION_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<const void *>(0));
+    if (hasNormals) {
+        glEnableVertexAttribArray(NORMAL_ATTRIBUTE);
+        glVertexAttribPointer(NORMAL_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, stride,
+                              reinterpret_cast<const void *>(3 * sizeof(float)));
+    }
+    if (hasTextureCoords) {
+        glEnableVertexAttribArray(TEXCOORD_ATTRIBUTE);
+        glVertexAttribPointer(TEXCOORD_ATTRIBUTE, 2, GL_FLOAT, GL_FALSE, stride,
+                              reinterpret_cast<const void *>(6 * sizeof(float)));
+    }
+    for (GLuint attribute = MODEL_ATTRIBUTE; attribute <= COLOR_ATTRIBUTE; attribute++) {
+        glEnableVertexAttribArray(attribute);
+        glVertexAttribDivisor(attribute, 1);
+    }
+
+    glGenVertexArrays(1, &gpu.legacyVao);
+    glBindVertexArray(gpu.legacyVao);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gpu.indexBuffer);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(3, GL_FLOAT, stride, reinterpret_cast<const void *>(0));
+    if (hasNormals) {
+        glEnableClientState(GL_NORMAL_ARRAY);
+        glNormalPointer(GL_FLOAT, stride, reinterpret_cast<const void *>(3 * sizeof(float)));
+    }
+    if (hasTextureCoords) {
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+        glTexCoordPointer(2, GL_FLOAT, stride, reinterpret_cast<const void *>(6 * sizeof(float)));
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return gpu;
+}
+
+void MeshCache::destroy(GpuMesh &gpu) {
+    if (gpu.vao) {
+        glDeleteVertexArrays(1, &gpu.vao);
+        glDeleteVertexArrays(1, &gpu.legacyVao);
+        glDeleteBuffers(1, &gpu.vertexBuffer);
+        glDeleteBuffers(1, &gpu.indexBuffer);
+    }
+    gpu = GpuMesh();
+}
@@ -0,0 +1,76 @@
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include <GL/glew.h>
+#include <unordered_map>
+
+#include "Mesh.h"
+
+// Generic vertex attribute locations used by the shader path. The model
+// matrix takes four locations, one per column. Particles are placed by a
+// centre and radius of their own instead of a model matrix.
+enum MeshAttribute {
+    POSITION_ATTRIBUTE = 0,
+    NORMAL_ATTRIBUTE = 1,
+    TEXCOORD_ATTRIBUTE = 2,
+    MODEL_ATTRIBUTE = 3,
+    COLOR_ATTRIBUTE = 7,
+    PARTICLE_ATTRIBUTE = 8,
+    PARTICLE_COLOR_ATTRIBUTE = 9
+};
+
+// A mesh uploaded to the GPU. Its vertex array objects hold the whole
+// vertex layout, so drawing it takes a single bind: one feeds the
+// fixed-function client arrays, the other the generic attributes of the
+// shader path, with the per-instance attributes enabled ready to be
+// pointed at the frame's instance data. The mesh's levels of detail share
+// its vertices, and sit one after another in its index buffer.
+struct GpuMesh {
+    static const unsigned maxLevels = 4;
+
+    unsigned id = 0; // Small number used in render queue sort keys
+    GLuint vao = 0;
+    GLuint legacyVao = 0;
+    GLuint vertexBuffer = 0;
+    GLuint indexBuffer = 0;
+    GLsizei indexCount = 0; // Indices in the full mesh, level 0
+    unsigned levels = 1;
+    GLsizei levelFirst[maxLevels] = {0, 0, 0, 0}; // Where each level starts in the index buffer
+    GLsizei levelCount[maxLevels] = {0, 0, 0, 0};
+    float radius = 0; // Of a sphere about the mesh's origin holding every vertex
+};
+
+// Uploads each Mesh to the GPU the first time it is drawn and keeps the
+// buffers after that. Meshes are looked up by address, so a mesh must stay
+// where it is while it is being drawn, and one whose contents change must
+// be released before it is drawn again.
+class MeshCache {
+public:
+    MeshCache() = default;
+    ~MeshCache();
+
+    MeshCache(const MeshCache &) = delete;
+    MeshCache &operator=(const MeshCache &) = delete;
+
+    // Returns the uploaded copy of the mesh, uploading it if needed. An
+    // empty mesh gives a GpuMesh with no indices and no buffers.
+    const GpuMesh &get(const Mesh &mesh);
+
+    // Frees the buffers of one mesh, if it has been uploaded
+    void release(const Mesh &mesh);
+
+    // Frees every uploaded mesh
+    void clear();
+
+private:
+    // Position, normal and texture coordinate of each vertex, interleaved
+    static const unsigned floatsPerVertex = 8;
+
+    std::unordered_map<const Mesh *, GpuMesh> meshes;
+    unsigned nextId = 1;
+
+    static GpuMesh upload(const Mesh &mesh, unsigned id);
+    static void destroy(GpuMesh &gpu);
+};
+
+#endif // MESHCACHE_H
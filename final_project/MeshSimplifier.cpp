@@ -0,0 +1,406 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <queue>
+#include <unordered_map>
+
+// Boundary edges are held in place by planes this much stiffer than the
+// surface's own, so open edges such as leaves keep their outline
+static const double boundaryWeight = 100.0;
+
+// A collapse may turn a triangle by no more than this (the cosine of the
+// angle between its old and new normals), so the surface doesn't fold over
+static const double minNormalAgreement = 0.2;
+
+namespace {
+
+// Sum of squared distances to a set of planes, as the symmetric 4x4 matrix
+// of Garland and Heckbert's quadric error metric
+struct Quadric {
+    double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+
+    void addPlane(double a, double b, double c, double d, double weight) {
+        a2 += weight * a * a;
+        ab += weight * a * b;
+        ac += weight * a * c;
+        ad += weight * a * d;
+        b2 += weight * b * b;
+        bc += weight * b * c;
+        bd += weight * b * d;
+        c2 += weight * c * c;
+        cd += weight * c * d;
+        d2 += weight * d * d;
+    }
+
+    Quadric &operator+=(const Quadric &other) {
+        a2 += other.a2;
+        ab += other.ab;
+        ac += other.ac;
+        ad += other.ad;
+        b2 += other.b2;
+        bc += other.bc;
+        bd += other.bd;
+        c2 += other.c2;
+        cd += other.cd;
+        d2 += other.d2;
+        return *this;
+    }
+
+    double error(const double p[3]) const {
+        const double x = p[0], y = p[1], z = p[2];
+        return a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x + b2 * y * y + 2 * bc * y * z +
+               2 * bd * y + c2 * z * z + 2 * cd * z + d2;
+    }
+};
+
+struct Triangle {
+    unsigned position[3]; // Welded vertices
+    unsigned corner[3]; // Mesh vertices the corners started as, for their attributes
+    bool removed;
+};
+
+// A possible collapse of one vertex into another, valid while neither has
+// changed since it was costed
+struct Collapse {
+    double cost;
+    unsigned from, to;
+    unsigned fromVersion, toVersion;
+
+    bool operator>(const Collapse &other) const { return cost > other.cost; }
+};
+
+class Simplifier {
+public:
+    explicit Simplifier(const Mesh &mesh);
+
+    // Collapses edges until at most target triangles are left. Returns false
+    // if no more collapses were possible before then.
+    bool simplify(size_t target);
+
+    size_t getTriangleCount() const { return liveTriangles; }
+
+    // Appends the current triangles to indices, adding any vertices they
+    // need to the mesh
+    void emit(Mesh &mesh, std::vector<unsigned int> &indices);
+
+private:
+    std::vector<double> points; // Welded positions, three per vertex
+    std::vector<unsigned> weldOf; // Welded vertex of each mesh vertex
+    std::vector<Quadric> quadrics;
+    std::vector<std::vector<unsigned>> vertexTriangles;
+    std::vector<unsigned> versions;
+    std::vector<bool> alive;
+    std::vector<Triangle> triangles;
+    size_t liveTriangles = 0;
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap;
+
+    // Mesh vertex standing for a welded vertex with a corner's attributes
+    std::unordered_map<uint64_t, unsigned> movedCorners;
+
+    const double *point(unsigned v) const { return &points[3 * v]; }
+    void queueEdges(unsigned v);
+    void queueEdge(unsigned a, unsigned b);
+    bool flips(unsigned from, unsigned to) const;
+    void collapse(unsigned from, unsigned to);
+};
+
+Simplifier::Simplifier(const Mesh &mesh) {
+    const std::vector<float> &vertices = mesh.getVertices();
+    const std::vector<unsigned int> &indices = mesh.getIndices();
+    const size_t vertexCount = vertices.size() / 3;
+
+    // Weld vertices at the same position, whatever their other attributes
+    struct PositionHash {
+        size_t operator()(const std::array<float, 3> &p) const {
+            uint32_t bits[3];
+            std::memcpy(bits, p.data(), sizeof(bits));
+            return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+        }
+    };
+    std::unordered_map<std::array<float, 3>, unsigned, PositionHash> welded;
+    weldOf.resize(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++) {
+        const std::array<float, 3> p = {vertices[3 * i], vertices[3 * i + 1], vertices[3 * i + 2]};
+        auto found = welded.emplace(p, static_cast<unsigned>(points.size() / 3));
+        if (found.second) {
+            points.insert(points.end(), p.begin(), p.end());
+        }
+        weldOf[i] = found.first->second;
+    }
+
+    const size_t weldedCount = points.size() / 3;
+    quadrics.resize(weldedCount);
+    vertexTriangles.resize(weldedCount);
+    versions.assign(weldedCount, 0);
+    alive.assign(weldedCount, true);
+
+    // Each triangle's plane, weighted by its area, goes into its corners
+    std::unordered_map<uint64_t, int> edgeUses;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        Triangle triangle;
+        triangle.removed = false;
+        for (int k = 0; k < 3; k++) {
+            triangle.corner[k] = indices[i + k];
+            triangle.position[k] = weldOf[indices[i + k]];
+        }
+        const unsigned a = triangle.position[0], b = triangle.position[1], c = triangle.position[2];
+        if (a == b || b == c || a == c) {
+            continue;
+        }
+
+        const double *p0 = point(a), *p1 = point(b), *p2 = point(c);
+        const double e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+        const double e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+        double n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+        const double doubleArea = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (doubleArea > 0) {
+            for (double &component: n) {
+                component /= doubleArea;
+            }
+            const double d = -(n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2]);
+            Quadric plane;
+            plane.addPlane(n[0], n[1], n[2], d, doubleArea * 0.5);
+            for (unsigned v: triangle.position) {
+                quadrics[v] += plane;
+            }
+        }
+
+        const unsigned index = static_cast<unsigned>(triangles.size());
+        for (int k = 0; k < 3; k++) {
+            vertexTriangles[triangle.position[k]].push_back(index);
+            const unsigned u = triangle.position[k], v = triangle.position[(k + 1) % 3];
+            edgeUses[(uint64_t(std::min(u, v)) << 32) | std::max(u, v)]++;
+        }
+        triangles.push_back(triangle);
+    }
+    liveTriangles = triangles.size();
+
+    // Hold boundary edges with planes standing up from them
+    for (const Triangle &triangle: triangles) {
+        const double *p0 = point(triangle.position[0]), *p1 = point(triangle.position[1]),
+                     *p2 = point(triangle.position[2]);
+        const double e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+        const double e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+        const double n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2],
+                             e1[0] * e2[1] - e1[1] * e2[0]};
+        for (int k = 0; k < 3; k++) {
+            const unsigned u = triangle.position[k], v = triangle.position[(k + 1) % 3];
+            if (edgeUses[(uint64_t(std::min(u, v)) << 32) | std::max(u, v)] != 1) {
+                continue;
+            }
+            const double *pu = point(u), *pv = point(v);
+            const double edge[3] = {pv[0] - pu[0], pv[1] - pu[1], pv[2] - pu[2]};
+            double side[3] = {edge[1] * n[2] - edge[2] * n[1], edge[2] * n[0] - edge[0] * n[2],
+                              edge[0] * n[1] - edge[1] * n[0]};
+            const double length = std::sqrt(side[0] * side[0] + side[1] * side[1] + side[2] * side[2]);
+            if (length <= 0) {
+                continue;
+            }
+            for (double &component: side) {
+                component /= length;
+            }
+            const double d = -(side[0] * pu[0] + side[1] * pu[1] + side[2] * pu[2]);
+            const double edgeLengthSquared = edge[0] * edge[0] + edge[1] * edge[1] + edge[2] * edge[2];
+            Quadric plane;
+            plane.addPlane(side[0], side[1], side[2], d, boundaryWeight * edgeLengthSquared);
+            quadrics[u] += plane;
+            quadrics[v] += plane;
+        }
+    }
+
+    for (unsigned v = 0; v < weldedCount; v++) {
+        queueEdges(v);
+    }
+}
+
+void Simplifier::queueEdges(unsigned v) {
+    for (unsigned t: vertexTriangles[v]) {
+        const Triangle &triangle = triangles[t];
+        if (triangle.removed) {
+            continue;
+        }
+        for (unsigned other: triangle.position) {
+            // Queue each edge once, from its lower end
+            if (other > v) {
+                queueEdge(v, other);
+            }
+        }
+    }
+}
+
+void Simplifier::queueEdge(unsigned a, unsigned b) {
+    Quadric combined = quadrics[a];
+    combined += quadrics[b];
+
+    // The merged vertex goes to whichever end fits the combined planes best
+    const double costA = combined.error(point(a));
+    const double costB = combined.error(point(b));
+    Collapse collapse;
+    if (costA <= costB) {
+        collapse = {costA, b, a, versions[b], versions[a]};
+    } else {
+        collapse = {costB, a, b, versions[a], versions[b]};
+    }
+    heap.push(collapse);
+}
+
+bool Simplifier::flips(unsigned from, unsigned to) const {
+    for (unsigned t: vertexTriangles[from]) {
+        const Triangle &triangle = triangles[t];
+        if (triangle.removed || std::find(triangle.position, triangle.position + 3, to) != triangle.position + 3) {
+            continue;
+        }
+
+        const double *before[3], *after[3];
+        for (int k = 0; k < 3; k++) {
+            before[k] = point(triangle.position[k]);
+            after[k] = triangle.position[k] == from ? point(to) : before[k];
+        }
+        double normals[2][3];
+        const double *const *corners[2] = {before, after};
+        for (int i = 0; i < 2; i++) {
+            const double *p0 = corners[i][0], *p1 = corners[i][1], *p2 = corners[i][2];
+            const double e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+            const double e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+            normals[i][0] = e1[1] * e2[2] - e1[2] * e2[1];
+            normals[i][1] = e1[2] * e2[0] - e1[0] * e2[2];
+            normals[i][2] = e1[0] * e2[1] - e1[1] * e2[0];
+        }
+        const double lengths = std::sqrt(normals[0][0] * normals[0][0] + normals[0][1] * normals[0][1] +
+                                         normals[0][2] * normals[0][2]) *
+                               std::sqrt(normals[1][0] * normals[1][0] + normals[1][1] * normals[1][1] +
+                                         normals[1][2] * normals[1][2]);
+        const double agreement =
+            normals[0][0] * normals[1][0] + normals[0][1] * normals[1][1] + normals[0][2] * normals[1][2];
+        if (lengths <= 0 || agreement < minNormalAgreement * lengths) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Simplifier::collapse(unsigned from, unsigned to) {
+    for (unsigned t: vertexTriangles[from]) {
+        Triangle &triangle = triangles[t];
+        if (triangle.removed) {
+            continue;
+        }
+        if (std::find(triangle.position, triangle.position + 3, to) != triangle.position + 3) {
+            // The collapsed edge's own triangles vanish
+            triangle.removed = true;
+            liveTriangles--;
+            continue;
+        }
+        for (unsigned &v: triangle.position) {
+            if (v == from) {
+                v = to;
+            }
+        }
+        vertexTriangles[to].push_back(t);
+    }
+    vertexTriangles[from].clear();
+    alive[from] = false;
+    quadrics[to] += quadrics[from];
+
+    // Drop the removed triangles from the survivor's list as it grows
+    std::vector<unsigned> &list = vertexTriangles[to];
+    list.erase(std::remove_if(list.begin(), list.end(), [&](unsigned t) { return triangles[t].removed; }),
+               list.end());
+
+    // Only the edges meeting the survivor have changed cost
+    versions[to]++;
+    for (unsigned t: list) {
+        for (unsigned v: triangles[t].position) {
+            if (v != to) {
+                queueEdge(to, v);
+            }
+        }
+    }
+}
+
+bool Simplifier::simplify(size_t target) {
+    while (liveTriangles > target) {
+        if (heap.empty()) {
+            return false;
+        }
+        const Collapse next = heap.top();
+        heap.pop();
+        if (!alive[next.from] || !alive[next.to] || versions[next.from] != next.fromVersion ||
+            versions[next.to] != next.toVersion) {
+            continue;
+        }
+        if (flips(next.from, next.to)) {
+            continue;
+        }
+        collapse(next.from, next.to);
+    }
+    return true;
+}
+
+void Simplifier::emit(Mesh &mesh, std::vector<unsigned int> &indices) {
+    for (const Triangle &triangle: triangles) {
+        if (triangle.removed) {
+            continue;
+        }
+        for (int k = 0; k < 3; k++) {
+            const unsigned position = triangle.position[k];
+            const unsigned corner = triangle.corner[k];
+            if (weldOf[corner] == position) {
+                indices.push_back(corner);
+                continue;
+            }
+
+            // The corner has moved: give it a vertex at its new position
+            // that keeps its own attributes
+            const uint64_t key = (uint64_t(position) << 32) | corner;
+            auto found = movedCorners.find(key);
+            if (found == movedCorners.end()) {
+                const unsigned vertex = static_cast<unsigned>(mesh.getVertices().size() / 3);
+                const double *p = point(position);
+                mesh.addVertex(static_cast<float>(p[0]), static_cast<float>(p[1]), static_cast<float>(p[2]));
+                const std::vector<float> &normals = mesh.getNormals();
+                if (normals.size() >= 3 * (size_t(corner) + 1)) {
+                    mesh.addNormal(normals[3 * corner], normals[3 * corner + 1], normals[3 * corner + 2]);
+                }
+                const std::vector<float> &textureCoords = mesh.getTextureCoords();
+                if (textureCoords.size() >= 2 * (size_t(corner) + 1)) {
+                    mesh.addTextureCoord(textureCoords[2 * corner], textureCoords[2 * corner + 1]);
+                }
+                found = movedCorners.emplace(key, vertex).first;
+            }
+            indices.push_back(found->second);
+        }
+    }
+}
+
+} // namespace
+
+void buildLevelsOfDetail(Mesh &mesh, unsigned levels, float ratio) {
+    std::vector<std::vector<unsigned int>> coarser;
+    if (mesh.getIndices().size() < 3 || levels < 2) {
+        mesh.setLevelsOfDetail(coarser);
+        return;
+    }
+
+    // Each level carries on collapsing from the one before
+    Simplifier simplifier(mesh);
+    size_t target = simplifier.getTriangleCount();
+    for (unsigned level = 1; level < levels; level++) {
+        const size_t before = simplifier.getTriangleCount();
+        target = static_cast<size_t>(target * ratio);
+        const bool reached = simplifier.simplify(target);
+        if (simplifier.getTriangleCount() == 0 || simplifier.getTriangleCount() == before) {
+            break;
+        }
+        coarser.emplace_back();
+        simplifier.emit(mesh, coarser.back());
+        if (!reached) {
+            break;
+        }
+    }
+    mesh.setLevelsOfDetail(coarser);
+}
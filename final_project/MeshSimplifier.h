@@ -0,0 +1,14 @@
+#ifndef MESHSIMPLIFIER_H
+#define MESHSIMPLIFIER_H
+
+#include "Mesh.h"
+
+// Builds the mesh's coarser levels of detail by collapsing edges in order of
+// quadric error, each level keeping about ratio of the triangles of the one
+// before. Simplification runs on the welded positions, so the surface stays
+// closed across texture seams. Corners that move keep their own normal and
+// texture coordinate, which takes a few vertices appended to the mesh. Gives
+// up early, with fewer levels, once a mesh can't be simplified any further.
+void buildLevelsOfDetail(Mesh &mesh, unsigned levels = 4, float ratio = 0.5f);
+
+#endif // MESHSIMPLIFIER_H
@@ -102,23 +102,15 @@ Mover::~Mover() {
     delete m_spring;
 }
 
-void Mover::draw(const int shadow) const {
+void Mover::queueDraw(RenderQueue &queue) const {
     cyclone::Vector3 position;
     m_particle->getPosition(&position); // get the current pos of particle
 
-    if (shadow) {
-        glColor4f(0.1f, 0.1f, 0.1f, 0.5f);
-    } else {
-        glLoadName(_id);
-        glColor3f(static_cast<float>(ballColor.x), static_cast<float>(ballColor.y), static_cast<float>(ballColor.z));
-    }
-
-    glPushMatrix();
-
-    glTranslatef(static_cast<float>(position.x), static_cast<float>(position.y), static_cast<float>(position.z));
-    glutSolidSphere(size, 30, 30); // size = 2.0
-
-    glPopMatrix();
+    const float center[3] = {static_cast<float>(position.x), static_cast<float>(position.y),
+                             static_cast<float>(position.z)};
+    const float color[4] = {static_cast<float>(ballColor.x), static_cast<float>(ballColor.y),
+                            static_cast<float>(ballColor.z), 1.0f};
+    queue.addParticle(ParticleRenderer::SPHERE, center, size, color); // size = 2.0
 }
 
 void Mover::checkEdges() const {
@@ -166,9 +158,23 @@ void Mover::checkEdges() const {
 }
 
 void Mover::update(float duration) {
-    m_forces->updateForces(duration);
-    m_particle->integrate(duration);
-    checkEdges();
+    // Fast projectiles (laser, pistol, artillery) can travel further than
+    // their own size in one step. Those are sub-stepped, so the edges are
+    // checked everywhere the particle could have crossed them.
+    unsigned steps = 1;
+    const cyclone::real travel = m_particle->getVelocity().magnitude() * duration;
+    if (travel > size) {
+        steps = static_cast<unsigned>(ceil(travel / size));
+        if (steps > maxSubSteps)
+            steps = maxSubSteps;
+    }
+
+    const float step = duration / steps;
+    for (unsigned i = 0; i < steps; i++) {
+        m_forces->updateForces(step);
+        m_particle->integrate(step);
+        checkEdges();
+    }
 }
 
 void Mover::updateColor(float duration) {
@@ -32,11 +32,11 @@
 #include "windows.h"
 #endif
 
-#include <GL/glut.h>
 #include <functional>
 #include <map>
 
 #include "MySpring.h"
+#include "RenderQueue.h"
 #include "core.h"
 #include "iostream"
 #include "particle.h"
@@ -51,7 +51,9 @@ public:
 
     ~Mover();
 
-    void draw(int shadow) const;
+    // Queues the mover as a sphere particle, drawn with every other
+    // particle in one instanced call
+    void queueDraw(RenderQueue &queue) const;
 
     void update(float duration);
     void updateColor(float duration);
@@ -83,6 +85,7 @@ public:
 private:
     int _id;
     static int idProvider;
+    static const unsigned maxSubSteps = 16;
     float size = 2.0;
     projectileType projectileType = BASE;
     cyclone::Vector3 m_position = cyclone::Vector3(0, 0, 0);
@@ -54,6 +54,11 @@ MyGlWindow::MyGlWindow(int x, int y, int w, int h) : Fl_Gl_Window(x, y, w, h) {
     Mover *first_object = factory.createMover(cyclone::Vector3(0, 2, 0));
     m_movers = factory.getMovers();
 
+    // Explosion dust falls under gravity and drag, and settles on the floor
+    dust.getStoreForceGenerators().push_back(&dustGravity);
+    dust.getStoreForceGenerators().push_back(&dustDrag);
+    dust.setStoreGround(0, 0.3f);
+
     TimingData::init();
     run = 0;
     selected = -1;
@@ -61,23 +66,38 @@ MyGlWindow::MyGlWindow(int x, int y, int w, int h) : Fl_Gl_Window(x, y, w, h) {
     // Create game objects
     createGameObjects();
 
+    // From here on the game steps on its own thread. The first snapshot is
+    // taken here, so there is one to draw before the first step.
+    publishSnapshot();
+    snapshots.update();
+    simulation.start([this](float duration) { step(duration); });
+
     textureLoaded = false;
 }
 
 MyGlWindow::~MyGlWindow() {
-    // Clean up rigid bodies
-    for (auto body: gameRigidBodies) {
-        if (body != playerCube->getBody() && body != floor->getBody()) {
-            delete body;
-        }
+    // Nothing the simulation uses may go before it stops
+    simulation.stop();
+
+    // The render queue and HUD text free their GPU buffers, which needs the context
+    if (context()) {
+        make_current();
     }
+
+    // The game bodies belong to the floor and player cube
     delete playerCube;
     delete floor;
 }
 
 void MyGlWindow::toggleHitboxes()
 {
-    simplePhysics->toggleHitboxes();
+    drawHitboxes = !drawHitboxes;
+}
+
+void MyGlWindow::toggleRenderer()
+{
+    renderQueue.setBackend(renderQueue.getBackend() == RenderQueue::SHADER_BACKEND ?
+                           RenderQueue::LEGACY_BACKEND : RenderQueue::SHADER_BACKEND);
 }
 
 void MyGlWindow::createGameObjects() {
@@ -120,7 +140,7 @@ void MyGlWindow::AddModelToRigidBodies(SimplePhysics& physics) {
     // Iterate through all rigid bodies in the physics system
     for (auto& box : physics.getBoxes()) {
         // Set the mesh for the rigid body
-        box->setMesh((rand() % 2 == 0) ? aptMesh : treeMesh);
+        box->setMesh((rand() % 2 == 0) ? &aptMesh : &treeMesh);
     }
 
     std::cout << "Model added to all rigid bodies in the physics system." << std::endl;
@@ -174,7 +194,8 @@ void MyGlWindow::LoadModel(std::string filename, Mesh &newMesh) {
     float centerY = (minY + maxY) * 0.5f;
     float centerZ = (minZ + maxZ) * 0.5f;
 
-    // Clear any previous data
+    // Clear any previous data, along with its copy on the GPU
+    renderQueue.releaseMesh(newMesh);
     newMesh.clear();
 
     for (const auto &shape: shapes) {
@@ -200,6 +221,9 @@ void MyGlWindow::LoadModel(std::string filename, Mesh &newMesh) {
             newMesh.addIndex(static_cast<unsigned int>(newMesh.getIndices().size()));
         }
     }
+
+    // Coarser versions for when the model is small on screen
+    buildLevelsOfDetail(newMesh);
 }
 
 
@@ -225,39 +249,26 @@ void MyGlWindow::LoadTexture(std::string filename, GLuint &newTextureID) {
 }
 
 void MyGlWindow::setupLight(float x, float y, float z) {
-    // set up the lighting
-    GLfloat lightPosition[] = {500.0f, 900.0f, 500.0f, 1.0f};
-    GLfloat lightPosition2[] = {1.0f, 0.0f, 0.0f, 0.0f};
-    GLfloat lightPosition3[] = {0.0f, -1.0f, 0.0f, 0.0f};
-
-    GLfloat violetLight[] = {0.5f, 0.1f, 0.5f, 1.0f};
-    GLfloat whiteLight[] = {1.0f, 1.0f, 1.0f, 1.0f};
-    GLfloat whiteLight2[] = {0.3f, 0.3f, 0.3f, 1.0f};
-    GLfloat blueLight[] = {0.1f, 0.1f, 0.3f, 1.0f};
+    // set up the lighting. The render queue hands the lights to whichever
+    // backend draws the scene: fixed-function lights or the shader's
+    // uniform buffer.
+    const SceneLight viewLight = {{x, y, z, 1.0f}, {0.0f, 0.0f, 0.0f, 1.0f}, {1.0f, 1.0f, 1.0f, 1.0f}};
+    const SceneLight ambientLight = {{1.0f, 0.0f, 0.0f, 0.0f}, {0.3f, 0.3f, 0.3f, 1.0f}, {0.0f, 0.0f, 0.0f, 1.0f}};
+    const SceneLight underLight = {{0.0f, -1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f, 1.0f}, {1.0f, 1.0f, 1.0f, 1.0f}};
+    renderQueue.setLight(0, viewLight);
+    renderQueue.setLight(1, ambientLight);
+    renderQueue.setLight(2, underLight);
+
+    // The light at the view point casts shadows, onto the ground and the
+    // lower storeys of the buildings, from anything up to where boxes spawn
+    renderQueue.setShadows(0, -0.1f, 10.0f, 60.0f);
 
     glEnable(GL_COLOR_MATERIAL);
     glEnable(GL_DEPTH_TEST);
-    glEnable(GL_LIGHTING);
-    glEnable(GL_LIGHT0);
-    glEnable(GL_LIGHT1);
-    glEnable(GL_LIGHT2);
     glEnable(GL_DEPTH);
 
     glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
 
-    lightPosition[0] = x;
-    lightPosition[1] = y;
-    lightPosition[2] = z;
-
-    glLightfv(GL_LIGHT0, GL_POSITION, lightPosition);
-    glLightfv(GL_LIGHT0, GL_DIFFUSE, whiteLight);
-
-    glLightfv(GL_LIGHT1, GL_POSITION, lightPosition2);
-    glLightfv(GL_LIGHT1, GL_AMBIENT, whiteLight2);
-
-    glLightfv(GL_LIGHT2, GL_POSITION, lightPosition3);
-    glLightfv(GL_LIGHT2, GL_DIFFUSE, whiteLight);
-
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 }
@@ -270,48 +281,16 @@ void setupObjects() {
     glStencilMask(0x1); // only deal with the 1st bit
 }
 
-void MyGlWindow::drawModel(const Mesh &modelMesh) {
-    glEnable(GL_TEXTURE_2D);
-    glEnable(GL_LIGHTING);
-    glColor3f(1.0f, 1.0f, 1.0f); // Set color to white for texture mapping
-    glBindTexture(GL_TEXTURE_2D, textureID); // <-- bind your texture
-
-    glEnableClientState(GL_VERTEX_ARRAY);
-    glVertexPointer(3, GL_FLOAT, 0, modelMesh.getVertices().data());
-
-    if (!modelMesh.getNormals().empty()) {
-        glEnableClientState(GL_NORMAL_ARRAY);
-        glNormalPointer(GL_FLOAT, 0, modelMesh.getNormals().data());
-    }
-
-    if (!modelMesh.getTextureCoords().empty()) {
-        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-        glTexCoordPointer(2, GL_FLOAT, 0, modelMesh.getTextureCoords().data()); // <-- setup UVs
-    }
-
-    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(modelMesh.getIndices().size()), GL_UNSIGNED_INT, modelMesh.getIndices().data());
-
-    glDisableClientState(GL_VERTEX_ARRAY);
-    if (!modelMesh.getNormals().empty())
-        glDisableClientState(GL_NORMAL_ARRAY);
-    if (!modelMesh.getTextureCoords().empty())
-        glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-
-
-    glDisable(GL_TEXTURE_2D);
-    glDisable(GL_LIGHTING); // Disable lighting after drawing the model
-}
-
-
-
 void MyGlWindow::draw() {
     make_current(); // Ensure context is current (usually already is in FLTK draw())
-    if (glewInit() != GLEW_OK) {
-        std::cerr << "Failed to initialize GLEW\n";
-        exit(1);
-    }
 
     if (!textureLoaded) {
+        // GLEW only needs loading once, before the first buffers are made
+        if (glewInit() != GLEW_OK) {
+            std::cerr << "Failed to initialize GLEW\n";
+            exit(1);
+        }
+
         const std::string currentPath = std::filesystem::current_path().string();
         LoadTexture(currentPath + "/Models/apartment_texture.png", textureID);
         LoadTexture(currentPath + "/Models/Grass.png", floorTextureID);
@@ -320,6 +299,15 @@ void MyGlWindow::draw() {
         textureLoaded = true;
     }
 
+    TimingData::update();
+
+    // Draw from the latest state the simulation has published
+    if (snapshots.update()) {
+        pickTreeStale = true;
+    }
+    const SceneSnapshot &frame = snapshots.front();
+    m_viewer->clearChanged();
+
     glViewport(0, 0, w(), h());
 
     // clear the window, be sure to clear the Z-Buffer too
@@ -356,29 +344,65 @@ void MyGlWindow::draw() {
     glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
 
 
-    floor->draw(floorTextureID);
-    outFloor->draw(outFloorTextureID);
-
     glEnable(GL_COLOR_MATERIAL);
-    for (auto body: gameRigidBodies) {
-        if (body == playerCube->getBody()) {
-            playerCube->draw(holeTextureID);
-        }
+
+    // Queue the whole scene, then draw it grouped by texture and mesh
+    renderQueue.clear();
+    floor->queueDraw(renderQueue, floorTextureID);
+    outFloor->queueDraw(renderQueue, outFloorTextureID);
+    PlayerHole::queueDraw(renderQueue, frame.hole, holeTextureID);
+    SimplePhysics::render(renderQueue, frame.boxes, textureID, drawHitboxes);
+
+    // Movers belong to the window rather than the game, and are drawn as
+    // they are now rather than from the snapshot
+    for (auto mover: m_movers) {
+        mover.second->queueDraw(renderQueue);
     }
 
-    simplePhysics->render(0, textureID);
+    // Dust fades from a pale brown to nothing over its lifetime
+    static const float dustStart[4] = {0.8f, 0.75f, 0.65f, 0.9f};
+    static const float dustEnd[4] = {0.5f, 0.45f, 0.4f, 0.0f};
+    stepDust();
+    renderQueue.addParticles(ParticleRenderer::BILLBOARD, dust.getStore(), 0.4f, dustStart, dustEnd);
+    renderQueue.flush();
+
+    // Queue the HUD, to be drawn in one batch over everything else
+    hudText.clear();
 
     // Draw timer above the score
     char timerStr[64];
     int timerY = 35; // Y position above the score
-    snprintf(timerStr, sizeof(timerStr), "Time: %.2f s", timerSeconds);
+    snprintf(timerStr, sizeof(timerStr), "Time: %.2f s", frame.timerSeconds);
     putText(timerStr, 10, timerY, 1, 1, 0.5f);
 
     putText("Score :", 10, 10, 0.5, 0.5, 1);
-    putText(score->getScoreString().c_str(), 125, 10, 0.5, 0.5, 1);
+    putText(std::to_string(frame.score).c_str(), 125, 10, 0.5, 0.5, 1);
+
+    // Scene submission cost, to compare the two rendering backends
+    char rendererStr[128];
+    snprintf(rendererStr, sizeof(rendererStr),
+             "%s: %u draws, %u triangles, %zu particles, CPU %.2f ms, GPU %.2f ms",
+             renderQueue.getBackend() == RenderQueue::SHADER_BACKEND ? "GLSL 3.3" : "Legacy GL",
+             renderQueue.getDrawCount(), renderQueue.getTriangleCount(), renderQueue.getParticleCount(),
+             renderQueue.getCpuTime(), renderQueue.getGpuTime());
+    putText(rendererStr, 10, 60, 0.7f, 0.7f, 0.7f);
+
+    // How evenly the frames come, over the last few seconds
+    const FrameTimeStats frameTimes = framePacer.getStats();
+    char frameStr[128];
+    snprintf(frameStr, sizeof(frameStr), "Frame time at %d FPS: p50 %.2f ms, p99 %.2f ms, max %.2f ms",
+             framePacer.getFrameRate(), frameTimes.p50, frameTimes.p99, frameTimes.max);
+    putText(frameStr, 10, 85, 0.7f, 0.7f, 0.7f);
 
     if (!run) {
         // print a white background
+        glMatrixMode(GL_PROJECTION);
+        glLoadIdentity();
+        glMatrixMode(GL_MODELVIEW);
+        glLoadIdentity();
+        ortho();
+        glDisable(GL_LIGHTING);
+        glDisable(GL_DEPTH_TEST);
         glColor4f(0.2f, 0.2f, 0.2f, 0.5f);
         glBegin(GL_QUADS);
         glVertex2f(0, 0);
@@ -391,113 +415,194 @@ void MyGlWindow::draw() {
         putText("Game is not running press on the run button", w() / 2 - 300, h() / 2 - 20, 1, 1, 1);
         putText("Press 'R' to reset the game", w() / 2 - 175, h() / 2 + 20, 1, 1, 1);
     }
+
+    hudText.draw(w(), h());
 }
 
 void MyGlWindow::reset() {
     run = 0;
     ui->value(0);
 
-    // Reset timer
-    resetTimer();
+    // Optionally, reset movement flags
+    moveForward = moveBackward = moveLeft = moveRight = false;
+    selectedBox = -1;
+
+    postToGame([this] {
+        // Reset timer
+        resetTimer();
 
-    // Reset score
-    if (score) score->setScore(0);
+        // Reset score
+        if (score) score->setScore(0);
 
-    // Reset playerCube and physics state
-    if (playerCube) playerCube->setPosition(cyclone::Vector3(0, 2, 0));
-    for (auto body: gameRigidBodies) {
-        if (body != playerCube->getBody() && body != floor->getBody()) {
-            delete body;
-        }
-    }
-    gameRigidBodies.clear();
-    delete simplePhysics;
+        // Reset the physics world in place: the boxes take new bodies from its
+        // pool and keep their meshes, so nothing is reloaded or reallocated
+        simplePhysics->reset();
 
-    createGameObjects();
+        // A fresh player cube starts again with the initial swallow radius
+        delete playerCube;
+        playerCube = new PlayerHole();
+        playerCube->setSimplePhysics(simplePhysics);
+        playerCube->setScore(score);
 
-    // Optionally, reset movement flags
-    moveForward = moveBackward = moveLeft = moveRight = false;
+        gameRigidBodies.clear();
+        gameRigidBodies.push_back(floor->getBody());
+        gameRigidBodies.push_back(playerCube->getBody());
+    });
 
     // Redraw window
     redraw();
 }
 
-void MyGlWindow::update() {
-    TimingData::update();
-
-    // const float duration = static_cast<float>(TimingData::get().lastFrameDuration) * 0.003f;
-    // Convert milliseconds to seconds with proper scaling and add maximum time step
-    float duration = static_cast<float>(TimingData::get().lastFrameDuration) * 0.001f;  // Proper conversion from ms to seconds
-    const float maxTimeStep = 1.0f;
-    if (duration > maxTimeStep) {
-        duration = maxTimeStep;
-    }
-
+void MyGlWindow::step(float duration) {
     if (!run) {
         // If not running, just update the player cube
         playerCube->setMovement(moveForward, moveBackward, moveLeft, moveRight);
         playerCube->update(duration);
-        return;
+    } else {
+        if (!isTimerRunning()) {
+            // The timer on the HUD changes every step
+            timerSeconds += duration;
+            gameChanged = true;
+        }
+
+        playerCube->setMovement(moveForward, moveBackward, moveLeft, moveRight);
+        playerCube->update(duration);
+
+        std::vector<cyclone::RigidBody *> boxes = simplePhysics->getRigidBoxes();
+        playerCube->checkSwallowObjects(boxes);
+
+        simplePhysics->update(duration);
     }
 
-    if (!isTimerRunning()) {
-        timerSeconds += duration;
+    // Take both, so neither change is left over for the next step
+    const bool holeChanged = playerCube->takeChanges();
+    const bool physicsChanged = simplePhysics->takeChanges();
+
+    // A snapshot nothing has changed in isn't published, so the window
+    // sees nothing new and draws nothing
+    if (gameChanged || holeChanged || physicsChanged) {
+        publishSnapshot();
+        gameChanged = false;
     }
+}
 
-    playerCube->setMovement(moveForward, moveBackward, moveLeft, moveRight);
-    playerCube->update(duration);
+void MyGlWindow::postToGame(std::function<void()> command) {
+    // Anything a command does may show, so it is treated as a change
+    simulation.post([this, command] {
+        command();
+        gameChanged = true;
+    });
+}
 
-    std::vector<cyclone::RigidBody *> boxes = simplePhysics->getRigidBoxes();
-    playerCube->checkSwallowObjects(boxes);
+bool MyGlWindow::needsFrame() const {
+    return snapshots.hasUpdate() || m_viewer->hasChanged() || dust.getStore().getSize() > 0;
+}
 
-    simplePhysics->update(duration);
+void MyGlWindow::publishSnapshot() {
+    SceneSnapshot &next = snapshots.back();
+    simplePhysics->snapshot(next.boxes);
+    playerCube->snapshot(next.hole);
+    next.score = score->getScore();
+    next.timerSeconds = timerSeconds;
+    snapshots.publish();
+}
 
-    // Force redraw to update visual position
-    redraw();
+void MyGlWindow::setHoleColor(float r, float g, float b) {
+    postToGame([this, r, g, b] { playerCube->setColor(r, g, b); });
 }
 
-void MyGlWindow::doPick() {
-    make_current(); // since we'll need to do some GL stuff
+void MyGlWindow::spawnDust(const cyclone::Vector3 &position) {
+    const cyclone::real lifetime = 2.0f;
 
-    const int mx = Fl::event_x(); // where is the mouse?
-    const int my = Fl::event_y();
+    std::vector<cyclone::Vector3> positions(dustPerExplosion);
+    std::vector<cyclone::Vector3> velocities(dustPerExplosion);
+    dustRandom.fillVector(positions.data(), dustPerExplosion, position - cyclone::Vector3(2, 0, 2),
+                          position + cyclone::Vector3(2, 1, 2));
+    dustRandom.fillVector(velocities.data(), dustPerExplosion, cyclone::Vector3(-10, 5, -10),
+                          cyclone::Vector3(10, 15, 10));
+    dust.getStore().spawn(dustPerExplosion, positions.data(), velocities.data(), cyclone::Vector3(), 1, lifetime);
+}
 
-    // get the viewport - most reliable way to turn mouse coords into GL coords
-    int viewport[4];
-    glGetIntegerv(GL_VIEWPORT, viewport);
-    // set up the pick matrix on the stack - remember, FlTk is
-    // upside down!
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    gluPickMatrix((double) mx, (double) (viewport[3] - my), 5, 5, viewport);
+void MyGlWindow::stepDust() {
+    cyclone::ParticleStore &store = dust.getStore();
+    if (store.getSize() == 0) {
+        return;
+    }
+
+    // Frames are skipped while nothing changes, so the first one after a
+    // pause would otherwise throw the dust a long way
+    const float maxDuration = 0.05f;
+    float duration = static_cast<float>(TimingData::get().lastFrameDuration) * 0.000001f;
+    if (duration > maxDuration) {
+        duration = maxDuration;
+    }
 
-    // now set up the projection
-    setProjection(false);
+    dust.startFrame();
+    dust.runPhysics(duration);
+    store.killExpired();
+}
+
+void MyGlWindow::doPick() {
+    selected = -1;
+    selectedBox = -1;
 
-    // now draw the objects - but really only see what we hit
-    GLuint buf[100];
-    glSelectBuffer(100, buf);
-    glRenderMode(GL_SELECT);
-    glInitNames();
-    glPushName(0);
+    // Cast a ray from the mouse with the camera of the last frame, so
+    // nothing has to be drawn or read back from GL
+    double origin[3], direction[3];
+    if (!getMouseRay(cameraView, cameraProjection, cameraViewport, origin, direction)) {
+        return;
+    }
+    const cyclone::Vector3 rayOrigin(origin[0], origin[1], origin[2]);
+    const cyclone::Vector3 rayDirection(direction[0], direction[1], direction[2]);
+
+    // Take the nearest hit, whether it's a mover or a box
+    cyclone::real nearest = REAL_MAX;
+    for (auto mover: m_movers) {
+        cyclone::real distance;
+        if (cyclone::IntersectionTests::rayAndSphere(rayOrigin, rayDirection, mover.second->m_particle->getPosition(),
+                                                     mover.second->getSize(), &distance) &&
+            distance < nearest) {
+            nearest = distance;
+            selected = mover.first;
+        }
+    }
 
-    if (!m_movers.empty()) {
-        for (auto mover: m_movers) {
-            mover.second->draw(0);
+    // Boxes are picked from the snapshot on screen, which is also what
+    // the user clicked on
+    const std::vector<BoxSnapshot> &boxes = snapshots.front().boxes;
+    if (pickTreeStale) {
+        pickTree.clear();
+        for (unsigned i = 0; i < boxes.size(); i++) {
+            if (!boxes[i].swallowed) {
+                pickTree.insert(cyclone::AABB::fromBox(boxes[i].transform, boxes[i].halfSize), i);
+            }
         }
+        pickTree.build();
+        pickTreeStale = false;
     }
 
-    // Go back to drawing mode, and see how picking did
-    if (int hits = glRenderMode(GL_RENDER)) {
-        // warning; this just grabs the first object hit - if there
-        // are multiple objects, you really want to pick the closest
-        // one - see the OpenGL manual
-        // remember: we load names that are one more than the index
-        // selected = buf[3] - 1;
-        selected = buf[3];
-    } else {
-        // nothing hit, nothing selected
+    unsigned hit;
+    cyclone::real boxDistance;
+    if (pickTree.raycast(rayOrigin, rayDirection, nearest, [&](unsigned i) -> cyclone::real {
+            cyclone::real distance;
+            if (cyclone::IntersectionTests::rayAndBox(rayOrigin, rayDirection, boxes[i].transform,
+                                                      boxes[i].halfSize, &distance)) {
+                return distance;
+            }
+            return -1;
+        }, &hit, &boxDistance)) {
         selected = -1;
+        selectedBox = boxes[hit].index;
+        dragPosition = boxes[hit].transform.getAxisVector(3);
+
+        // A box swallowed since the snapshot has lost its body
+        const int index = selectedBox;
+        postToGame([this, index] {
+            Box *box = simplePhysics->getBox(index);
+            if (box && box->isValid()) {
+                box->startDragging();
+            }
+        });
     }
 }
 
@@ -512,20 +617,31 @@ void MyGlWindow::setProjection(int clearProjection)
     // compute the aspect ratio so we don't distort things
     const double aspect = static_cast<double>(w()) / static_cast<double>(h());
     double orthoSize = 25;
-    glOrtho(-orthoSize * aspect, orthoSize * aspect, -orthoSize, orthoSize, -1000, 1000);
+
+    // The camera is built here rather than with glOrtho and gluLookAt, and
+    // kept for picking
+    cameraViewport[0] = 0;
+    cameraViewport[1] = 0;
+    cameraViewport[2] = w();
+    cameraViewport[3] = h();
+    orthoMatrix(cameraProjection, -orthoSize * aspect, orthoSize * aspect, -orthoSize, orthoSize, -1000, 1000);
+    glMultMatrixd(cameraProjection);
 
     // put the camera where we want it to be
     glMatrixMode(GL_MODELVIEW);
     glLoadIdentity();
 
+    // The camera follows the hole as of the snapshot being drawn
+    const cyclone::Vector3 holePosition = snapshots.front().hole.getPosition();
     double distance = 50;
-    double camX = playerCube->getPosition().x + distance + m_viewer->getViewPoint().x;
-    double camY = playerCube->getPosition().y + distance * 0.5 + m_viewer->getViewPoint().y;
-    double camZ = playerCube->getPosition().z + distance + m_viewer->getViewPoint().z;
+    double camX = holePosition.x + distance + m_viewer->getViewPoint().x;
+    double camY = holePosition.y + distance * 0.5 + m_viewer->getViewPoint().y;
+    double camZ = holePosition.z + distance + m_viewer->getViewPoint().z;
 
-    gluLookAt(camX, camY, camZ,
-              playerCube->getPosition().x, playerCube->getPosition().y, playerCube->getPosition().z,
-              m_viewer->getUpVector().x, m_viewer->getUpVector().y, m_viewer->getUpVector().z);
+    lookAtMatrix(cameraView, camX, camY, camZ,
+                 holePosition.x, holePosition.y, holePosition.z,
+                 m_viewer->getUpVector().x, m_viewer->getUpVector().y, m_viewer->getUpVector().z);
+    glLoadMatrixd(cameraView);
 
 
     //	glDisable(GL_BLEND);
@@ -568,6 +684,19 @@ int MyGlWindow::handle(int e) {
             };
             break;
         case FL_RELEASE:
+            if (selectedBox >= 0 && m_pressedMouseButton == 1) {
+                const int index = selectedBox;
+                postToGame([this, index] {
+                    Box *box = simplePhysics->getBox(index);
+                    if (box && box->isValid()) {
+                        box->stopDragging();
+                    }
+                });
+                selectedBox = -1;
+                m_pressedMouseButton = 0;
+                damage(1);
+                return 1;
+            }
             if (selected >= 0 && m_pressedMouseButton == 1) {
                 t2 = TimingData::get().lastFrameTimestamp;
                 p2 = m_movers[selected]->m_particle->getPosition();
@@ -594,10 +723,31 @@ int MyGlWindow::handle(int e) {
             m_pressedMouseButton = 0;
             break;
         case FL_DRAG:
-            if (selected >= 0 && m_pressedMouseButton == 1) {
+            if (selectedBox >= 0 && m_pressedMouseButton == 1) {
+                double r1x, r1y, r1z, r2x, r2y, r2z;
+                getMouseLine(cameraView, cameraProjection, cameraViewport, r1x, r1y, r1z, r2x, r2y, r2z);
+
+                double rx, ry, rz;
+                mousePoleGo(r1x, r1y, r1z, r2x, r2y, r2z, static_cast<double>(dragPosition.x),
+                            static_cast<double>(dragPosition.y), static_cast<double>(dragPosition.z), rx, ry, rz,
+                            (Fl::event_state() & FL_CTRL) != 0);
+
+                // A box swallowed while it was being dragged has lost its
+                // body, and is left alone
+                dragPosition = cyclone::Vector3(rx, ry, rz);
+                const int index = selectedBox;
+                const cyclone::Vector3 position = dragPosition;
+                postToGame([this, index, position] {
+                    Box *box = simplePhysics->getBox(index);
+                    if (box && box->isValid()) {
+                        box->setPosition(position);
+                    }
+                });
+                damage(1);
+            } else if (selected >= 0 && m_pressedMouseButton == 1) {
 
                 double r1x, r1y, r1z, r2x, r2y, r2z;
-                getMouseLine(r1x, r1y, r1z, r2x, r2y, r2z);
+                getMouseLine(cameraView, cameraProjection, cameraViewport, r1x, r1y, r1z, r2x, r2y, r2z);
 
                 double rx, ry, rz;
 
@@ -632,9 +782,9 @@ int MyGlWindow::handle(int e) {
                     }
                 }
 
+                // The view is drawn again on the next frame if it changed
                 m_lastMouseX = Fl::event_x();
                 m_lastMouseY = Fl::event_y();
-                redraw();
             }
             return 1;
         case FL_MOUSEWHEEL:
@@ -643,7 +793,6 @@ int MyGlWindow::handle(int e) {
                     m_viewer->zoom(0.1f);
                 else if (Fl::event_dy() > 0)
                     m_viewer->zoom(-0.1f);
-                redraw();
                 return 1;
             }
             break;
@@ -654,49 +803,49 @@ int MyGlWindow::handle(int e) {
                 case 'W':
                     wasPressed = true;
                     moveForward = true;
-                    playerCube->setColor(1.0f, 0.0f, 0.0f);
-                    playerCube->setColor(1.0f, 0.0f, 0.0f);
+                    setHoleColor(1.0f, 0.0f, 0.0f);
                     break;
                 case 's':
                 case 'S':
                     wasPressed = true;
                     moveBackward = true;
-                    playerCube->setColor(0.0f, 1.0f, 0.0f);
+                    setHoleColor(0.0f, 1.0f, 0.0f);
                     break;
                 case 'a':
                 case 'A':
                     wasPressed = true;
                     moveLeft = true;
-                    playerCube->setColor(0.0f, 0.0f, 1.0f);
+                    setHoleColor(0.0f, 0.0f, 1.0f);
                     break;
                 case 'd':
                 case 'D':
                     wasPressed = true;
                     moveRight = true;
-                    playerCube->setColor(1.0f, 1.0f, 0.0f);
+                    setHoleColor(1.0f, 1.0f, 0.0f);
                     break;
                 case 'r':
                     reset();
                     return 1;
+                case 'e':
+                case 'E':
+                    postToGame([this] { simplePhysics->addExplosion(playerCube->getPosition()); });
+                    spawnDust(snapshots.front().hole.getPosition());
+                    return 1;
                 case FL_Up:
                     if (cameraLocked) break;
                     m_viewer->zoom(-0.1f);
-                    redraw();
                     return 1;
                 case FL_Down:
                     if (cameraLocked) break;
                     m_viewer->zoom(0.1f);
-                    redraw();
                     return 1;
                 default:
                     moveForward = false, moveBackward = false, moveLeft = false, moveRight = false;
-                    playerCube->setColor(1.0f, 0.4f, 0.7f);
-                    redraw();
+                    setHoleColor(1.0f, 0.4f, 0.7f);
                     break;
             }
             if (wasPressed) {
-                playerCube->setMoveSpeed(1.0f);
-                redraw();
+                postToGame([this] { playerCube->setMoveSpeed(1.0f); });
                 return 1;
             }
             return 0;
@@ -706,22 +855,22 @@ int MyGlWindow::handle(int e) {
                 case 'w':
                 case 'W':
                     moveForward = false;
-                    playerCube->setColor(1.0f, 0.4f, 0.7f);
+                    setHoleColor(1.0f, 0.4f, 0.7f);
                     break;
                 case 's':
                 case 'S':
                     moveBackward = false;
-                    playerCube->setColor(1.0f, 0.4f, 0.7f);
+                    setHoleColor(1.0f, 0.4f, 0.7f);
                     break;
                 case 'a':
                 case 'A':
                     moveLeft = false;
-                    playerCube->setColor(1.0f, 0.4f, 0.7f);
+                    setHoleColor(1.0f, 0.4f, 0.7f);
                     break;
                 case 'd':
                 case 'D':
                     moveRight = false;
-                    playerCube->setColor(1.0f, 0.4f, 0.7f);
+                    setHoleColor(1.0f, 0.4f, 0.7f);
                     break;
                 default:
                     break;
@@ -752,32 +901,8 @@ void MyGlWindow::getMouseNDC(float &x, float &y) {
     y = (my / hd) * 2.0f - 1.f;
 }
 
-void drawStrokeText(const char *string, int x, int y, int z) {
-    if (string == nullptr)
-        return;
-    glPushMatrix();
-    glTranslated(x, y + 8, z);
-    glScaled(0.2, 0.2, 0.2);
-
-    for (const char *c = string; *c != '\0'; c++) {
-        glutStrokeCharacter(GLUT_STROKE_ROMAN, *c);
-    }
-    glPopMatrix();
-}
-
 void MyGlWindow::putText(const char *str, int x, int y, float r, float g, float b) {
-    glDisable(GL_LIGHTING);
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
-    ortho();
-    glDisable(GL_LIGHTING);
-    glDisable(GL_DEPTH_TEST);
-    glColor3f(r, g, b);
-    drawStrokeText(str, x, y, 0);
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_LIGHTING);
+    hudText.add(str, x, y, r, g, b);
 }
 
 // Timer control methods
@@ -57,7 +57,10 @@
 #include "world.h"
 #include "timing.h"
 #include "precision.h"
+#include "pworld.h"
+#include "random.h"
 
+#include <atomic>
 #include <ctime>
 #include <vector>
 #include <chrono>
@@ -71,12 +74,19 @@
 #include "DrawUtils.h"
 
 #include "Floor.h"
+#include "FramePacer.h"
 #include "Mesh.h"
+#include "MeshSimplifier.h"
 #include "Mover.h"
 #include "MoverFactory.h"
 #include "PlayerHole.h"
+#include "RenderQueue.h"
+#include "SceneSnapshot.h"
 #include "Score.h"
 #include "SimplePhysics.h"
+#include "SimulationThread.h"
+#include "TextRenderer.h"
+#include "TripleBuffer.h"
 
 class MyGlWindow : public Fl_Gl_Window {
 public:
@@ -86,32 +96,59 @@ public:
     Fl_Light_Button *ui;
     Fl_Slider *time;
 
-    int run;
-    void update();
+    std::atomic<int> run;
     void doPick();
+    int selectedBox = -1; // Index of the box being dragged, or -1
     void reset();
     int selected;
     void putText(const char *str, int x, int y, float r, float g, float b);
     void createGameObjects();
     void AddModelToRigidBodies(SimplePhysics &physics);
     void toggleHitboxes();
+    void toggleRenderer();
 
-    // Timer controls
+    // Timer controls, for the simulation thread
     void startTimer();
     void resetTimer();
     bool isTimerRunning();
-    float getTimerSeconds() const { return timerSeconds; }
     bool isTimerRunning() const { return timerRunning; }
 
+    // The timer as of the last frame drawn
+    float getTimerSeconds() const { return snapshots.front().timerSeconds; }
+
     void setCameraLocked(bool locked) { cameraLocked = locked; }
 
+    // Paces the redraws, and times them for the HUD
+    FramePacer &getFramePacer() { return framePacer; }
+
+    // Whether the game has published a new snapshot, the view has moved or
+    // explosion dust is still in the air since the last frame drawn. Other
+    // changes to the window, from input and the widgets, damage it and are
+    // drawn by FLTK.
+    bool needsFrame() const;
+
 private:
     void draw() override;
     int handle(int e) override;
-    void drawModel(const Mesh &modelMesh);
     void LoadModel(std::string filename, Mesh &newMesh);
     void LoadTexture(std::string filename, GLuint &newTextureID);
 
+    // Advances the game by one fixed step, on the simulation thread, and
+    // publishes the result
+    void step(float duration);
+    void publishSnapshot();
+
+    // Runs a command on the simulation thread before its next step, and
+    // marks the game as changed so the result is published
+    void postToGame(std::function<void()> command);
+
+    // Recolours the player's hole from the window's thread
+    void setHoleColor(float r, float g, float b);
+
+    // Throws up a burst of dust where an explosion went off
+    void spawnDust(const cyclone::Vector3 &position);
+    void stepDust();
+
     Viewer *m_viewer;
     float fieldOfView;
     std::map<int, Mover *> m_movers;
@@ -134,14 +171,53 @@ private:
     SimplePhysics *simplePhysics;
     std::vector<cyclone::RigidBody *> gameRigidBodies;
 
-    // Movement state flags
-    bool moveForward = false;
-    bool moveBackward = false;
-    bool moveLeft = false;
-    bool moveRight = false;
+    // The game steps on its own thread, and everything it owns (the hole,
+    // the physics, the score and the timer) is only used from there. The
+    // window reaches them by posting commands, and draws from the snapshot
+    // the simulation publishes at the end of each step.
+    SimulationThread simulation;
+    TripleBuffer<SceneSnapshot> snapshots;
+
+    // Boxes are picked through a tree over the snapshot last drawn, built
+    // the first time that snapshot is picked from
+    cyclone::AABBTree pickTree;
+    bool pickTreeStale = true;
+
+    // Where the box being dragged was last put
+    cyclone::Vector3 dragPosition;
+
+    bool drawHitboxes = false;
+
+    // Dust from explosions is only for show, so it lives with the window
+    // rather than the game: the window steps it while drawing, and asks for
+    // frames until the last of it has settled and faded
+    static const unsigned dustPerExplosion = 256;
+    static const unsigned long long dustSeed = 0xd057;
+    cyclone::ParticleWorld dust{1};
+    cyclone::ParticleGravity dustGravity{cyclone::Vector3::GRAVITY};
+    cyclone::ParticleDrag dustDrag{0.4f, 0.02f};
+    cyclone::CounterRandom dustRandom{dustSeed};
+
+    // Everything in the scene is queued here each frame and drawn sorted by state
+    RenderQueue renderQueue;
+
+    FramePacer framePacer;
+
+    // HUD strings are queued here by putText and drawn together at the end of the frame
+    TextRenderer hudText;
+
+    // Movement state flags, set by the window and read by the simulation
+    std::atomic<bool> moveForward{false};
+    std::atomic<bool> moveBackward{false};
+    std::atomic<bool> moveLeft{false};
+    std::atomic<bool> moveRight{false};
 
     bool textureLoaded = false;
 
+    // Set on the simulation thread by anything that changes the game
+    // outside the hole and the physics, until the next snapshot
+    bool gameChanged = true;
+
     // Timer state
     float timerSeconds = 0.0f;
     bool timerRunning = false;
@@ -149,6 +225,12 @@ private:
     bool cameraLocked = true;
 
     void setProjection(int clearProjection = 1);
+
+    // The camera as of the last setProjection, kept so picking can cast rays
+    // without asking GL for it
+    double cameraProjection[16];
+    double cameraView[16];
+    int cameraViewport[4] = {0, 0, 1, 1};
     void getMouseNDC(float &x, float &y);
     void setupLight(float x, float y, float z);
 };
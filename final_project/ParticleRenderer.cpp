@@ -0,0 +1,263 @@
+#include "ParticleRenderer.h"
+#include "MeshCache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static const float pi = 3.14159265358979f;
+
+ParticleRenderer::~ParticleRenderer() {
+    if (loaded) {
+        glDeleteVertexArrays(SHAPE_COUNT, vao);
+        glDeleteVertexArrays(1, &legacySphereVao);
+        glDeleteBuffers(SHAPE_COUNT, vertexBuffer);
+        glDeleteBuffers(SHAPE_COUNT, instanceBuffer);
+        glDeleteBuffers(1, &sphereIndexBuffer);
+        glDeleteTextures(1, &discTexture);
+    }
+}
+
+void ParticleRenderer::clear() {
+    for (auto &shape: instances) {
+        shape.clear();
+    }
+}
+
+void ParticleRenderer::add(Shape shape, const float position[3], float radius, const float color[4]) {
+    ParticleInstance instance;
+    std::memcpy(instance.position, position, sizeof(instance.position));
+    instance.radius = radius;
+    std::memcpy(instance.color, color, sizeof(instance.color));
+    instances[shape].push_back(instance);
+}
+
+void ParticleRenderer::add(Shape shape, const cyclone::ParticleStore &store, float radius,
+                           const float startColor[4], const float endColor[4]) {
+    const unsigned count = store.getSize();
+    const cyclone::real *x = store.getPositionX();
+    const cyclone::real *y = store.getPositionY();
+    const cyclone::real *z = store.getPositionZ();
+    const cyclone::real *ages = store.getAges();
+    const cyclone::real *lifetimes = store.getLifetimes();
+
+    std::vector<ParticleInstance> &queued = instances[shape];
+    const size_t first = queued.size();
+    queued.resize(first + count);
+    ParticleInstance *out = queued.data() + first;
+    for (unsigned i = 0; i < count; i++) {
+        // Particles that live forever have a lifetime of REAL_MAX, and
+        // keep their start colour
+        const float t = static_cast<float>(std::min(ages[i] / lifetimes[i], cyclone::real(1)));
+        out[i].position[0] = static_cast<float>(x[i]);
+        out[i].position[1] = static_cast<float>(y[i]);
+        out[i].position[2] = static_cast<float>(z[i]);
+        out[i].radius = radius;
+        for (int c = 0; c < 4; c++) {
+            out[i].color[c] = startColor[c] + (endColor[c] - startColor[c]) * t;
+        }
+    }
+}
+
+unsigned ParticleRenderer::getTriangles(Shape shape) const {
+    return shape == SPHERE ? static_cast<unsigned>(sphereIndexCount / 3) : 2;
+}
+
+void ParticleRenderer::load() {
+    loaded = true;
+
+    // Unit sphere, a ring of vertices per stack from the top down
+    std::vector<float> sphere;
+    for (int stack = 0; stack <= sphereStacks; stack++) {
+        const float polar = pi * stack / sphereStacks;
+        for (int slice = 0; slice <= sphereSlices; slice++) {
+            const float azimuth = 2.0f * pi * slice / sphereSlices;
+            sphere.push_back(std::sin(polar) * std::cos(azimuth));
+            sphere.push_back(std::cos(polar));
+            sphere.push_back(std::sin(polar) * std::sin(azimuth));
+        }
+    }
+    std::vector<unsigned short> indices;
+    for (int stack = 0; stack < sphereStacks; stack++) {
+        for (int slice = 0; slice < sphereSlices; slice++) {
+            const unsigned short first = static_cast<unsigned short>(stack * (sphereSlices + 1) + slice);
+            const unsigned short below = static_cast<unsigned short>(first + sphereSlices + 1);
+            // The pole rows would only add triangles of zero area
+            if (stack != 0) {
+                indices.insert(indices.end(), {first, below, static_cast<unsigned short>(first + 1)});
+            }
+            if (stack != sphereStacks - 1) {
+                indices.insert(indices.end(), {static_cast<unsigned short>(first + 1), below,
+                                               static_cast<unsigned short>(below + 1)});
+            }
+        }
+    }
+    sphereIndexCount = static_cast<GLsizei>(indices.size());
+
+    // Corners of the billboard quad, as a triangle strip
+    const float quad[8] = {-1, -1, 1, -1, -1, 1, 1, 1};
+
+    glGenBuffers(SHAPE_COUNT, vertexBuffer);
+    glGenBuffers(SHAPE_COUNT, instanceBuffer);
+    glGenVertexArrays(SHAPE_COUNT, vao);
+
+    glBindVertexArray(vao[SPHERE]);
+    glGenBuffers(1, &sphereIndexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphereIndexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned short), indices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer[SPHERE]);
+    glBufferData(GL_ARRAY_BUFFER, sphere.size() * sizeof(float), sphere.data(), GL_STATIC_DRAW);
+    glEnableVertexAttribArray(POSITION_ATTRIBUTE);
+    glVertexAttribPointer(POSITION_ATTRIBUTE, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), nullptr);
+
+    glBindVertexArray(vao[BILLBOARD]);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer[BILLBOARD]);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(POSITION_ATTRIBUTE);
+    glVertexAttribPointer(POSITION_ATTRIBUTE, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), nullptr);
+
+    // Each shape reads its instances from the start of its own buffer, so
+    // the pointers never change
+    const GLsizei stride = sizeof(ParticleInstance);
+    for (int shape = 0; shape < SHAPE_COUNT; shape++) {
+        glBindVertexArray(vao[shape]);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer[shape]);
+        glEnableVertexAttribArray(PARTICLE_ATTRIBUTE);
+        glVertexAttribPointer(PARTICLE_ATTRIBUTE, 4, GL_FLOAT, GL_FALSE, stride,
+                              reinterpret_cast<const void *>(offsetof(ParticleInstance, position)));
+        glVertexAttribDivisor(PARTICLE_ATTRIBUTE, 1);
+        glEnableVertexAttribArray(PARTICLE_COLOR_ATTRIBUTE);
+        glVertexAttribPointer(PARTICLE_COLOR_ATTRIBUTE, 4, GL_FLOAT, GL_FALSE, stride,
+                              reinterpret_cast<const void *>(offsetof(ParticleInstance, color)));
+        glVertexAttribDivisor(PARTICLE_COLOR_ATTRIBUTE, 1);
+    }
+
+    // The same sphere through the fixed-function client arrays
+    glGenVertexArrays(1, &legacySphereVao);
+    glBindVertexArray(legacySphereVao);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphereIndexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer[SPHERE]);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(3, GL_FLOAT, 3 * sizeof(float), nullptr);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glNormalPointer(GL_FLOAT, 3 * sizeof(float), nullptr);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // The shader draws its discs without a texture, but the fixed-function
+    // pipeline needs one to fade them out
+    std::vector<unsigned char> disc(discSize * discSize * 4);
+    for (int row = 0; row < discSize; row++) {
+        for (int column = 0; column < discSize; column++) {
+            const float u = (column + 0.5f) / discSize * 2 - 1;
+            const float v = (row + 0.5f) / discSize * 2 - 1;
+            const float alpha = std::max(1.0f - (u * u + v * v), 0.0f);
+            unsigned char *texel = &disc[(row * discSize + column) * 4];
+            texel[0] = texel[1] = texel[2] = 255;
+            texel[3] = static_cast<unsigned char>(alpha * 255.0f + 0.5f);
+        }
+    }
+    glGenTextures(1, &discTexture);
+    glBindTexture(GL_TEXTURE_2D, discTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, discSize, discSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, disc.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void ParticleRenderer::upload() {
+    if (!loaded) {
+        load();
+    }
+
+    // Orphan last frame's instances, growing a buffer when there are more
+    for (int shape = 0; shape < SHAPE_COUNT; shape++) {
+        const std::vector<ParticleInstance> &queued = instances[shape];
+        if (queued.empty()) {
+            continue;
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer[shape]);
+        if (queued.size() > instanceCapacity[shape]) {
+            instanceCapacity[shape] = queued.size() * 2;
+        }
+        glBufferData(GL_ARRAY_BUFFER, instanceCapacity[shape] * sizeof(ParticleInstance), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, queued.size() * sizeof(ParticleInstance), queued.data());
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void ParticleRenderer::draw(Shape shape) const {
+    const GLsizei count = static_cast<GLsizei>(instances[shape].size());
+    if (count == 0) {
+        return;
+    }
+
+    glBindVertexArray(vao[shape]);
+    if (shape == SPHERE) {
+        glDrawElementsInstanced(GL_TRIANGLES, sphereIndexCount, GL_UNSIGNED_SHORT, nullptr, count);
+    } else {
+        // Blended over the scene without hiding each other
+        glPushAttrib(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glDepthMask(GL_FALSE);
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+        glPopAttrib();
+    }
+    glBindVertexArray(0);
+}
+
+void ParticleRenderer::drawLegacy(const GLfloat view[16]) {
+    if (!loaded) {
+        load();
+    }
+
+    if (!instances[SPHERE].empty()) {
+        glBindVertexArray(legacySphereVao);
+        for (const ParticleInstance &particle: instances[SPHERE]) {
+            glColor4fv(particle.color);
+            glLoadMatrixf(view);
+            glTranslatef(particle.position[0], particle.position[1], particle.position[2]);
+            glScalef(particle.radius, particle.radius, particle.radius);
+            glDrawElements(GL_TRIANGLES, sphereIndexCount, GL_UNSIGNED_SHORT, nullptr);
+        }
+        glBindVertexArray(0);
+        glLoadMatrixf(view);
+    }
+
+    if (!instances[BILLBOARD].empty()) {
+        // The camera's right and up axes are the first two rows of the view
+        const float right[3] = {view[0], view[4], view[8]};
+        const float up[3] = {view[1], view[5], view[9]};
+        const float corners[4][2] = {{-1, -1}, {1, -1}, {1, 1}, {-1, 1}};
+
+        glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glDisable(GL_LIGHTING);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glDepthMask(GL_FALSE);
+        glEnable(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, discTexture);
+        glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+
+        glBegin(GL_QUADS);
+        for (const ParticleInstance &particle: instances[BILLBOARD]) {
+            glColor4fv(particle.color);
+            for (const auto &corner: corners) {
+                const float x = corner[0] * particle.radius;
+                const float y = corner[1] * particle.radius;
+                glTexCoord2f(corner[0] * 0.5f + 0.5f, corner[1] * 0.5f + 0.5f);
+                glVertex3f(particle.position[0] + right[0] * x + up[0] * y,
+                           particle.position[1] + right[1] * x + up[1] * y,
+                           particle.position[2] + right[2] * x + up[2] * y);
+            }
+        }
+        glEnd();
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glPopAttrib();
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef PARTICLERENDERER_H
+#define PARTICLERENDERER_H
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <vector>
+
+#include "pstore.h"
+
+// Per-particle data, as laid out in the instance buffers
+struct ParticleInstance {
+    float position[3];
+    float radius;
+    float color[4];
+};
+
+// Draws particles as lit spheres or as soft camera-facing discs. Each shape
+// keeps its own instance buffer, filled once a frame, and is drawn with one
+// instanced call however many particles there are, so projectiles and
+// debris cost about as much to submit as a single mesh.
+//
+// Particles are queued one at a time or a whole ParticleStore at once,
+// read straight from the store's position and age arrays.
+class ParticleRenderer {
+public:
+    enum Shape {
+        SPHERE, // Lit and shadowed like the meshes
+        BILLBOARD, // Unlit, fading out towards its edge
+        SHAPE_COUNT
+    };
+
+    ParticleRenderer() = default;
+    ~ParticleRenderer();
+
+    ParticleRenderer(const ParticleRenderer &) = delete;
+    ParticleRenderer &operator=(const ParticleRenderer &) = delete;
+
+    // Empties the queue for a new frame
+    void clear();
+
+    // Queues one particle
+    void add(Shape shape, const float position[3], float radius, const float color[4]);
+
+    // Queues every particle in the store, coloured from startColor when it
+    // is spawned to endColor at the end of its lifetime
+    void add(Shape shape, const cyclone::ParticleStore &store, float radius, const float startColor[4],
+             const float endColor[4]);
+
+    size_t getCount(Shape shape) const { return instances[shape].size(); }
+    size_t getCount() const { return instances[SPHERE].size() + instances[BILLBOARD].size(); }
+
+    // Triangles drawn for each particle of the given shape
+    unsigned getTriangles(Shape shape) const;
+
+    // Copies the queued particles into the instance buffers, creating the
+    // buffers first if needed
+    void upload();
+
+    // Draws the uploaded particles of one shape with the current program
+    void draw(Shape shape) const;
+
+    // Draws the queued particles with the fixed-function pipeline, under
+    // the given camera, each sphere on its own and the billboards as one
+    // batch of quads
+    void drawLegacy(const GLfloat view[16]);
+
+private:
+    // The sphere is a unit sphere, so each vertex is also its own normal
+    static const int sphereSlices = 16;
+    static const int sphereStacks = 12;
+
+    // Texels along each side of the legacy backend's disc texture
+    static const int discSize = 32;
+
+    std::vector<ParticleInstance> instances[SHAPE_COUNT];
+
+    GLuint vertexBuffer[SHAPE_COUNT] = {0, 0};
+    GLuint instanceBuffer[SHAPE_COUNT] = {0, 0};
+    size_t instanceCapacity[SHAPE_COUNT] = {0, 0};
+    GLuint vao[SHAPE_COUNT] = {0, 0};
+    GLuint sphereIndexBuffer = 0;
+    GLsizei sphereIndexCount = 0;
+    GLuint legacySphereVao = 0;
+    GLuint discTexture = 0;
+    bool loaded = false;
+
+    void load();
+};
+
+#endif // PARTICLERENDERER_H
@@ -29,23 +29,20 @@
 #include <windows.h>
 
 PlayerHole::PlayerHole() :
-    swallowRadius(5.0f), moveSpeed(10.0f), moveForward(false), moveBackward(false), moveLeft(false), moveRight(false),
+    body(), swallowRadius(5.0f), moveSpeed(10.0f), moveForward(false), moveBackward(false), moveLeft(false), moveRight(false),
     cubeSize(2.0f),
     colorR(1.0f), colorG(0.4f), colorB(0.7f) // Initial pink color
 {
-    // Create rigid body for the player cube
-    body = new cyclone::RigidBody();
-
     // Set cube properties
-    body->setInverseMass(0);
-    body->setInverseInertiaTensor(cyclone::Matrix3(0, 0, 0, 0, 0, 0, 0, 0, 0));
-    body->setDamping(0.9, 0.9);
-    body->setAcceleration(cyclone::Vector3::GRAVITY * 0);
-    body->setPosition(cyclone::Vector3(0, 0.1f, 0)); // Start at a more reasonable height
-    body->setVelocity(cyclone::Vector3(0, 0, 0));
+    // The hole is moved by the player, not by forces or contacts
+    body.setBodyType(cyclone::RigidBody::KINEMATIC_BODY);
+    body.setDamping(0.9, 0.9);
+    body.setAcceleration(cyclone::Vector3::GRAVITY * 0);
+    body.setPosition(cyclone::Vector3(0, 0.1f, 0)); // Start at a more reasonable height
+    body.setVelocity(cyclone::Vector3(0, 0, 0));
 }
 
-PlayerHole::~PlayerHole() { delete body; }
+PlayerHole::~PlayerHole() {}
 
 void PlayerHole::setMovement(bool forward, bool backward, bool left, bool right) {
     moveForward = forward;
@@ -82,73 +79,111 @@ void PlayerHole::update(float duration) {
             velocity.x = moveSpeed;
     }
 
-    // Update position
-    cyclone::Vector3 currentPos = body->getPosition();
-    cyclone::Vector3 newPos = currentPos + velocity * duration * 3.0f;
+    const cyclone::Vector3 oldPos = body.getPosition();
+
+    // Kinematic integration just moves the body by its velocity
+    body.setVelocity(velocity * 3.0f);
+    body.integrate(duration);
 
     // Clamp position to stay within [-100, 100] range in x and z
     // This ensures the player hole does not move out of bounds
+    cyclone::Vector3 newPos = body.getPosition();
     newPos.x = max(-100.0f + swallowRadius, min(100.0f - swallowRadius, newPos.x));
     newPos.z = max(-100.0f + swallowRadius, min(100.0f - swallowRadius, newPos.z));
 
-    // Update position and velocity
-    body->setPosition(newPos);
-    body->setVelocity(velocity);
-    body->calculateDerivedData(); // Ensure transform matrix is updated
+    body.setPosition(newPos);
+    body.calculateDerivedData(); // Ensure transform matrix is updated
+    if (newPos != oldPos) {
+        changed = true;
+    }
 }
 
+// Disc of radius one in the xz plane, shared by every hole and scaled to
+// the swallow radius when drawn
+static const Mesh &unitDisc() {
+    static Mesh disc;
+    if (disc.getIndices().empty()) {
+        const int segments = 30;
+
+        // Center vertex (at UV 0.5,0.5)
+        disc.addVertex(0.0f, 0.0f, 0.0f);
+        disc.addNormal(0, 1, 0);
+        disc.addTextureCoord(0.5f, 0.5f);
+        for (int i = 0; i <= segments; ++i) {
+            float angle = 2.0f * M_PI * float(i) / float(segments);
+            disc.addVertex(std::cos(angle), 0.0f, std::sin(angle));
+            disc.addNormal(0, 1, 0);
+            disc.addTextureCoord(0.5f + 0.5f * std::cos(angle), 0.5f + 0.5f * std::sin(angle));
+        }
+        for (int i = 1; i <= segments; ++i) {
+            disc.addIndex(0);
+            disc.addIndex(i);
+            disc.addIndex(i + 1);
+        }
+    }
+    return disc;
+}
 
-void PlayerHole::draw(GLuint textureID) {
-    glEnable(GL_TEXTURE_2D);
-    glEnable(GL_LIGHTING);
-    glBindTexture(GL_TEXTURE_2D, textureID);
+// Small sphere marking the center of the hole
+static const Mesh &centerSphere() {
+    static Mesh sphere;
+    if (sphere.getIndices().empty()) {
+        const float radius = 0.2f;
+        const int slices = 10;
+        const int stacks = 10;
+        for (int stack = 0; stack <= stacks; ++stack) {
+            float polar = M_PI * float(stack) / float(stacks);
+            for (int slice = 0; slice <= slices; ++slice) {
+                float azimuth = 2.0f * M_PI * float(slice) / float(slices);
+                float x = std::sin(polar) * std::cos(azimuth);
+                float y = std::cos(polar);
+                float z = std::sin(polar) * std::sin(azimuth);
+                sphere.addVertex(x * radius, y * radius, z * radius);
+                sphere.addNormal(x, y, z);
+            }
+        }
+        for (int stack = 0; stack < stacks; ++stack) {
+            for (int slice = 0; slice < slices; ++slice) {
+                unsigned first = stack * (slices + 1) + slice;
+                unsigned below = first + slices + 1;
+                sphere.addIndex(first);
+                sphere.addIndex(below);
+                sphere.addIndex(first + 1);
+                sphere.addIndex(first + 1);
+                sphere.addIndex(below);
+                sphere.addIndex(below + 1);
+            }
+        }
+    }
+    return sphere;
+}
+
+void PlayerHole::snapshot(HoleSnapshot &hole) const {
+    hole.transform = body.getTransform();
+    hole.swallowRadius = swallowRadius;
+}
 
-    glColor3f(1, 1, 1);
+void PlayerHole::queueDraw(RenderQueue &queue, const HoleSnapshot &hole, GLuint textureID) {
+    static const float white[4] = {1, 1, 1, 1};
 
     // Transform
     float transform[16];
-    body->getGLTransform(transform);
-    glPushMatrix();
-    glMultMatrixf(transform);
-
-    // Draw textured disc
-    glBegin(GL_TRIANGLE_FAN);
-    // Center vertex (at UV 0.5,0.5)
-    glNormal3f(0, 1, 0);
-    glTexCoord2f(0.5f, 0.5f);
-    glVertex3f(0.0f, 0.0f, 0.0f);
-
-    const int segments = 30;
-    for (int i = 0; i <= segments; ++i) {
-        float angle = 2.0f * M_PI * float(i) / float(segments);
-        float x = std::cos(angle) * swallowRadius;
-        float z = std::sin(angle) * swallowRadius;
-
-        // compute UV on circle
-        float u = 0.5f + 0.5f * std::cos(angle);
-        float v = 0.5f + 0.5f * std::sin(angle);
-
-        glNormal3f(0, 1, 0);
-        glTexCoord2f(u, v);
-        glVertex3f(x, 0.0f, z);
-    }
-    glEnd();
-
-    // Small white sphere at center
-    glDisable(GL_TEXTURE_2D);
-    glColor4f(1, 1, 1, 1);
-    glutSolidSphere(0.2f, 10, 10);
+    hole.transform.fillGLArray(transform);
+    queue.add(centerSphere(), 0, transform, white);
 
-    glPopMatrix();
-
-    glDisable(GL_LIGHTING);
-    glDisable(GL_TEXTURE_2D);
+    // Textured disc, stretched to the swallow radius
+    for (int i = 0; i < 3; i++) {
+        transform[i] *= hole.swallowRadius;
+        transform[8 + i] *= hole.swallowRadius;
+    }
+    queue.add(unitDisc(), textureID, transform, white);
 }
 
 
 void PlayerHole::setPosition(const cyclone::Vector3 &pos) {
-    body->setPosition(pos);
-    body->calculateDerivedData(); // Ensure transform matrix is updated
+    body.setPosition(pos);
+    body.calculateDerivedData(); // Ensure transform matrix is updated
+    changed = true;
 }
 
 void PlayerHole::setColor(float r, float g, float b) {
@@ -158,13 +193,13 @@ void PlayerHole::setColor(float r, float g, float b) {
 }
 
 void PlayerHole::checkSwallowObjects(std::vector<cyclone::RigidBody *> &objects) {
-    cyclone::Vector3 holePosition = body->getPosition();
+    cyclone::Vector3 holePosition = body.getPosition();
 
     for (auto it = objects.begin(); it != objects.end();) {
         cyclone::RigidBody *currentBody = *it;
 
         // Don't check for swallowing with the hole itself
-        if (currentBody == body) {
+        if (currentBody == &body) {
             ++it;
             continue;
         }
@@ -200,6 +235,7 @@ void PlayerHole::checkSwallowObjects(std::vector<cyclone::RigidBody *> &objects)
                  it = objects.erase(it);
                 swallowRadius += 0.1f;
                 score->addToScore(1);
+                changed = true;
                 continue;
             }
         }
@@ -209,6 +245,7 @@ void PlayerHole::checkSwallowObjects(std::vector<cyclone::RigidBody *> &objects)
             it = objects.erase(it);
              swallowRadius += 0.1f;
             score->addToScore(1);
+            changed = true;
             continue;
         }
 
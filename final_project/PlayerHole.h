@@ -30,10 +30,13 @@
 
 #define M_PI 3.14159265358979323846
 
+#include "RenderQueue.h"
+
 #include <FL/Fl.H>
 #include <cyclone.h>
 #include <GL/glut.h>
 
+#include "SceneSnapshot.h"
 #include "Score.h"
 #include "SimplePhysics.h"
 
@@ -45,12 +48,23 @@ class PlayerHole {
         // Movement control
         void setMovement(bool forward, bool backward, bool left, bool right);
         void update(float duration);
-        void draw(GLuint textureID);
+
+        // Copies out what's needed to draw the hole, and queues a copy
+        void snapshot(HoleSnapshot &hole) const;
+        static void queueDraw(RenderQueue &queue, const HoleSnapshot &hole, GLuint textureID);
+
+        // Whether anything drawn of the hole has changed since the last
+        // call, so a new snapshot is worth taking
+        bool takeChanges() {
+            const bool wasChanged = changed;
+            changed = false;
+            return wasChanged;
+        }
 
         // Getters
-        cyclone::RigidBody *getBody() const { return body; }
+        cyclone::RigidBody *getBody() { return &body; }
         float getSwallowRadius() const { return swallowRadius; }
-        cyclone::Vector3 getPosition() const { return body->getPosition(); }
+        cyclone::Vector3 getPosition() const { return body.getPosition(); }
 
         // Setters
         void setPosition(const cyclone::Vector3 &pos);
@@ -64,7 +78,8 @@ class PlayerHole {
 
     private:
         Score *score;
-        cyclone::RigidBody *body;
+        // Held in place rather than on the heap
+        cyclone::RigidBody body;
         SimplePhysics *simplePhysics;
         float swallowRadius;
         float moveSpeed;
@@ -74,6 +89,9 @@ class PlayerHole {
         bool moveRight;
         float cubeSize; // Size of the cube for drawing
         float colorR, colorG, colorB; // Added color components
+
+        // Set when the hole moves or grows
+        bool changed = true;
 };
 
 #endif // PLAYERCUBE_H
@@ -0,0 +1,343 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+// The fixed-function pipeline's default scene ambient light
+static const float defaultSceneAmbient[4] = {0.2f, 0.2f, 0.2f, 1.0f};
+
+// out = a * b, all column-major
+static void multiplyMatrices(const float a[16], const float b[16], float out[16]) {
+    for (int column = 0; column < 4; column++) {
+        for (int row = 0; row < 4; row++) {
+            float sum = 0;
+            for (int k = 0; k < 4; k++) {
+                sum += a[k * 4 + row] * b[column * 4 + k];
+            }
+            out[column * 4 + row] = sum;
+        }
+    }
+}
+
+RenderQueue::RenderQueue() {
+    std::memset(lights, 0, sizeof(lights));
+}
+
+RenderQueue::~RenderQueue() {
+    if (timerQueries[0]) {
+        glDeleteQueries(2, timerQueries);
+    }
+}
+
+void RenderQueue::clear() {
+    items.clear();
+    keys.clear();
+    particles.clear();
+}
+
+void RenderQueue::add(const Mesh &mesh, GLuint texture, const float transform[16], const float color[4],
+                      GLuint name) {
+    const GpuMesh &gpu = meshes.get(mesh);
+    if (gpu.indexCount == 0) {
+        return;
+    }
+    assert(items.size() <= indexMask);
+
+    DrawItem item;
+    item.mesh = &gpu;
+    item.texture = texture;
+    item.name = name;
+    item.level = 0;
+    std::memcpy(item.transform, transform, sizeof(item.transform));
+    std::memcpy(item.color, color, sizeof(item.color));
+
+    const uint64_t index = items.size();
+    keys.push_back((uint64_t(texture) << (meshBits + levelBits + indexBits)) |
+                   ((uint64_t(gpu.id) & meshMask) << (levelBits + indexBits)) | index);
+    items.push_back(item);
+}
+
+void RenderQueue::setLight(unsigned index, const SceneLight &light) {
+    assert(index < SceneFrame::maxLights);
+    lights[index] = light;
+    lightCount = std::max(lightCount, index + 1);
+}
+
+void RenderQueue::setShadows(int light, float floorHeight, float receiverTop, float casterTop) {
+    assert(light < static_cast<int>(SceneFrame::maxLights));
+    shadowLight = light;
+    shadowFloor = floorHeight;
+    shadowReceiverTop = receiverTop;
+    shadowCasterTop = casterTop;
+}
+
+void RenderQueue::flush(bool withNames) {
+    const auto start = std::chrono::steady_clock::now();
+    beginTimer();
+
+    GLfloat view[16];
+    glGetFloatv(GL_MODELVIEW_MATRIX, view);
+
+    selectLevels(view);
+    std::sort(keys.begin(), keys.end());
+
+    if (backend == SHADER_BACKEND && !shaderTried) {
+        shaderTried = true;
+        if (shader.load()) {
+            shadowMap.load(shadowMapSize);
+        }
+    }
+
+    drawCount = 0;
+    stateChanges = 0;
+    triangleCount = 0;
+    if (backend == SHADER_BACKEND && shader.isLoaded() && !withNames) {
+        flushShader(view);
+    } else {
+        flushLegacy(withNames, view);
+    }
+
+    endTimer();
+    cpuTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void RenderQueue::selectLevels(const GLfloat view[16]) {
+    GLfloat projection[16], viewProjection[16];
+    glGetFloatv(GL_PROJECTION_MATRIX, projection);
+    multiplyMatrices(projection, view, viewProjection);
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    // Pixels per world unit at unit clip w. The camera's view has no
+    // scale, so this is the projection's own vertical scale.
+    const float pixelsPerUnit = std::fabs(projection[5]) * viewport[3] * 0.5f;
+
+    for (uint64_t &key: keys) {
+        DrawItem &item = items[key & indexMask];
+        const GpuMesh &mesh = *item.mesh;
+
+        // The bounding sphere's size on screen. An orthographic camera has
+        // w = 1 everywhere, so only the model's own size counts.
+        const float *m = item.transform;
+        float scale = 0;
+        for (int column = 0; column < 3; column++) {
+            scale = std::max(scale, m[column * 4] * m[column * 4] + m[column * 4 + 1] * m[column * 4 + 1] +
+                                    m[column * 4 + 2] * m[column * 4 + 2]);
+        }
+        const float w = viewProjection[3] * m[12] + viewProjection[7] * m[13] + viewProjection[11] * m[14] +
+                        viewProjection[15];
+        const float pixels = 2 * mesh.radius * std::sqrt(scale) * pixelsPerUnit / std::max(w, 1e-6f);
+
+        unsigned level = 0;
+        for (float size = detailSize; level + 1 < mesh.levels && pixels < size; size *= 0.5f) {
+            level++;
+        }
+        item.level = level;
+        key |= uint64_t(level) << indexBits;
+    }
+}
+
+void RenderQueue::flushLegacy(bool withNames, const GLfloat view[16]) {
+    // Lights are given in world space, so set them under the camera alone
+    glLightModelfv(GL_LIGHT_MODEL_AMBIENT, defaultSceneAmbient);
+    for (unsigned i = 0; i < lightCount; i++) {
+        glEnable(GL_LIGHT0 + i);
+        glLightfv(GL_LIGHT0 + i, GL_POSITION, lights[i].position);
+        glLightfv(GL_LIGHT0 + i, GL_AMBIENT, lights[i].ambient);
+        glLightfv(GL_LIGHT0 + i, GL_DIFFUSE, lights[i].diffuse);
+    }
+
+    glEnable(GL_LIGHTING);
+    glDisable(GL_TEXTURE_2D);
+    GLuint boundTexture = 0;
+    const GpuMesh *boundMesh = nullptr;
+
+    for (uint64_t key: keys) {
+        const DrawItem &item = items[key & indexMask];
+
+        if (item.texture != boundTexture) {
+            if (!boundTexture) {
+                glEnable(GL_TEXTURE_2D);
+            } else if (!item.texture) {
+                glDisable(GL_TEXTURE_2D);
+            }
+            glBindTexture(GL_TEXTURE_2D, item.texture);
+            boundTexture = item.texture;
+            stateChanges++;
+        }
+        if (item.mesh != boundMesh) {
+            glBindVertexArray(item.mesh->legacyVao);
+            boundMesh = item.mesh;
+            stateChanges++;
+        }
+
+        if (withNames) {
+            glLoadName(item.name);
+        }
+        glColor4fv(item.color);
+        glLoadMatrixf(view);
+        glMultMatrixf(item.transform);
+        glDrawElements(GL_TRIANGLES, item.mesh->levelCount[item.level], GL_UNSIGNED_INT,
+                       reinterpret_cast<const void *>(item.mesh->levelFirst[item.level] * sizeof(unsigned int)));
+        drawCount++;
+        triangleCount += item.mesh->levelCount[item.level] / 3;
+    }
+
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glDisable(GL_TEXTURE_2D);
+
+    if (!withNames && particles.getCount() > 0) {
+        particles.drawLegacy(view);
+        const size_t spheres = particles.getCount(ParticleRenderer::SPHERE);
+        const size_t billboards = particles.getCount(ParticleRenderer::BILLBOARD);
+        drawCount += static_cast<unsigned>(spheres + (billboards > 0 ? 1 : 0));
+        triangleCount += static_cast<unsigned>(spheres * particles.getTriangles(ParticleRenderer::SPHERE) +
+                                               billboards * particles.getTriangles(ParticleRenderer::BILLBOARD));
+    }
+    glDisable(GL_LIGHTING);
+    glLoadMatrixf(view);
+}
+
+void RenderQueue::flushShader(const GLfloat view[16]) {
+    SceneFrame frame;
+    std::memset(&frame, 0, sizeof(frame));
+    GLfloat projection[16];
+    glGetFloatv(GL_PROJECTION_MATRIX, projection);
+    multiplyMatrices(projection, view, frame.viewProjection);
+    for (int axis = 0; axis < 3; axis++) {
+        // The camera's right and up axes are the first two rows of the view
+        frame.cameraRight[axis] = view[axis * 4];
+        frame.cameraUp[axis] = view[axis * 4 + 1];
+    }
+    std::memcpy(frame.sceneAmbient, defaultSceneAmbient, sizeof(frame.sceneAmbient));
+    for (unsigned i = 0; i < lightCount; i++) {
+        std::memcpy(frame.lightPosition[i], lights[i].position, sizeof(lights[i].position));
+        std::memcpy(frame.lightAmbient[i], lights[i].ambient, sizeof(lights[i].ambient));
+        std::memcpy(frame.lightDiffuse[i], lights[i].diffuse, sizeof(lights[i].diffuse));
+    }
+    frame.lightCount = static_cast<int>(lightCount);
+
+    const bool shadowed = shadowMap.isLoaded() && shadowLight >= 0 && shadowLight < static_cast<int>(lightCount);
+    frame.shadowLight = shadowed ? shadowLight : -1;
+    if (shadowed) {
+        shadowMap.fit(frame.viewProjection, lights[shadowLight].position, shadowFloor, shadowReceiverTop,
+                      shadowCasterTop, frame.shadowViewProjection);
+    }
+
+    // Lay the instances out in sorted order, so each batch is a contiguous
+    // run of the instance buffer
+    const size_t count = keys.size();
+    instances.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        const DrawItem &item = items[keys[i] & indexMask];
+        std::memcpy(instances[i].model, item.transform, sizeof(item.transform));
+        std::memcpy(instances[i].color, item.color, sizeof(item.color));
+    }
+    // The particles go first, since the batches expect the mesh instances
+    // to be left bound
+    if (particles.getCount() > 0) {
+        particles.upload();
+    }
+    shader.upload(frame, instances.data(), count);
+
+    if (shadowed) {
+        shadowMap.begin();
+        shader.beginDepth();
+        drawBatches(false);
+        shadowMap.end();
+    }
+
+    shader.begin(shadowed ? shadowMap.getTexture() : 0);
+    drawBatches(true);
+    if (particles.getCount(ParticleRenderer::SPHERE) > 0) {
+        shader.beginSpheres(shadowed ? shadowMap.getTexture() : 0);
+        drawParticles(ParticleRenderer::SPHERE);
+    }
+    if (particles.getCount(ParticleRenderer::BILLBOARD) > 0) {
+        shader.beginBillboards();
+        drawParticles(ParticleRenderer::BILLBOARD);
+    }
+    shader.end();
+}
+
+void RenderQueue::drawBatches(bool textured) {
+    const size_t count = keys.size();
+    GLuint boundTexture = 0;
+    const GpuMesh *boundMesh = nullptr;
+    for (size_t first = 0; first < count;) {
+        const DrawItem &item = items[keys[first] & indexMask];
+
+        // Items sharing a texture, mesh and level of detail sit next to each
+        // other after the sort, and are drawn as one instanced call
+        size_t last = first + 1;
+        while (last < count) {
+            const DrawItem &next = items[keys[last] & indexMask];
+            if (next.texture != item.texture || next.mesh != item.mesh || next.level != item.level) {
+                break;
+            }
+            last++;
+        }
+
+        const GLuint texture = item.texture ? item.texture : shader.getWhiteTexture();
+        if (textured && texture != boundTexture) {
+            glBindTexture(GL_TEXTURE_2D, texture);
+            boundTexture = texture;
+            stateChanges++;
+        }
+        if (item.mesh != boundMesh) {
+            glBindVertexArray(item.mesh->vao);
+            boundMesh = item.mesh;
+            stateChanges++;
+        }
+
+        shader.bindInstances(first);
+        const GLsizei indexCount = item.mesh->levelCount[item.level];
+        glDrawElementsInstanced(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT,
+                                reinterpret_cast<const void *>(item.mesh->levelFirst[item.level] * sizeof(unsigned int)),
+                                static_cast<GLsizei>(last - first));
+        drawCount++;
+        if (textured) {
+            triangleCount += static_cast<unsigned>(indexCount / 3 * (last - first));
+        }
+        first = last;
+    }
+
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void RenderQueue::drawParticles(ParticleRenderer::Shape shape) {
+    particles.draw(shape);
+    drawCount++;
+    stateChanges++;
+    triangleCount += static_cast<unsigned>(particles.getCount(shape) * particles.getTriangles(shape));
+}
+
+void RenderQueue::beginTimer() {
+    if (!timerQueries[0]) {
+        glGenQueries(2, timerQueries);
+    }
+
+    // This query was last used two frames ago, which is usually long enough
+    // for the GPU to have finished with it
+    const GLuint query = timerQueries[timerFrame % 2];
+    if (timerFrame >= 2) {
+        GLint available = 0;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available) {
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+            gpuTime = elapsed / 1.0e6;
+        }
+    }
+    glBeginQuery(GL_TIME_ELAPSED, query);
+}
+
+void RenderQueue::endTimer() {
+    glEndQuery(GL_TIME_ELAPSED);
+    timerFrame++;
+}
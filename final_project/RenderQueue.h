@@ -0,0 +1,168 @@
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <vector>
+
+#include "MeshCache.h"
+#include "ParticleRenderer.h"
+#include "SceneShader.h"
+#include "ShadowMap.h"
+
+// One mesh to draw this frame, with the state it needs
+struct DrawItem {
+    const GpuMesh *mesh;
+    GLuint texture; // 0 for an untextured mesh
+    GLuint name; // Selection name, loaded when flushing for picking
+    unsigned level; // Level of detail, chosen when the queue is flushed
+    float transform[16]; // Column-major model matrix, as from getGLTransform
+    float color[4];
+};
+
+// A light shining on the queued meshes
+struct SceneLight {
+    float position[4]; // World space, w = 0 for a directional light
+    float ambient[4];
+    float diffuse[4];
+};
+
+// Collects everything drawn in a frame, then sorts it by the state each
+// item needs and submits it with as few state changes as possible. Meshes
+// are drawn from their cached GPU buffers. The queue keeps its storage
+// from frame to frame, so filling it doesn't allocate once it has warmed up.
+//
+// Two backends draw the same queue. The shader backend draws each run of
+// items sharing a texture and mesh as one instanced call through a GLSL
+// 3.3 program. The legacy backend draws each item with the fixed-function
+// pipeline, and is kept so the two can be compared on the same scene.
+//
+// The shader backend can also shadow one light. Before the scene is lit,
+// the same instanced batches are drawn depth-only into a shadow map from
+// that light, so shadows cost one pass at the map's resolution. The legacy
+// backend draws without shadows.
+//
+// Each item is drawn at a level of detail picked from how big it will be
+// on screen, so small or distant models cost fewer triangles.
+//
+// Particles are queued apart from the meshes and drawn after them, one
+// instanced call per particle shape with the shader backend. They are lit
+// and shadowed, but don't cast shadows themselves.
+class RenderQueue {
+public:
+    enum Backend {
+        LEGACY_BACKEND,
+        SHADER_BACKEND
+    };
+
+    RenderQueue();
+    ~RenderQueue();
+
+    // Empties the queue for a new frame
+    void clear();
+
+    // Queues a mesh to be drawn with the given texture and model matrix
+    void add(const Mesh &mesh, GLuint texture, const float transform[16], const float color[4],
+             GLuint name = 0);
+
+    // Queues one particle, or every particle in a store, coloured from
+    // startColor to endColor over its lifetime; see ParticleRenderer
+    void addParticle(ParticleRenderer::Shape shape, const float position[3], float radius, const float color[4]) {
+        particles.add(shape, position, radius, color);
+    }
+    void addParticles(ParticleRenderer::Shape shape, const cyclone::ParticleStore &store, float radius,
+                      const float startColor[4], const float endColor[4]) {
+        particles.add(shape, store, radius, startColor, endColor);
+    }
+
+    // Sorts the queued items and draws them, lit, with the current
+    // projection and modelview matrices as the camera. Picking with
+    // selection names needs the fixed-function pipeline, so it always
+    // uses the legacy backend, and leaves the particles out.
+    void flush(bool withNames = false);
+
+    // Frees the GPU copy of a mesh whose contents are about to change
+    void releaseMesh(const Mesh &mesh) { meshes.release(mesh); }
+
+    // Sets one of the lights, which stay set until changed
+    void setLight(unsigned index, const SceneLight &light);
+
+    // Shadows the given light, or none for -1. Shadows fall on whatever
+    // the camera sees between floorHeight and receiverTop, and are cast by
+    // anything up to casterTop; see ShadowMap::fit.
+    void setShadows(int light, float floorHeight, float receiverTop, float casterTop);
+
+    // Chooses the backend. The shader backend falls back to the legacy one
+    // if its program can't be built.
+    void setBackend(Backend backend) { this->backend = backend; }
+    Backend getBackend() const { return backend; }
+
+    // Sets how many pixels across an item must be to be drawn in full.
+    // Each coarser level of detail is used below half the size of the one
+    // before it.
+    void setDetailSize(float pixels) { detailSize = pixels; }
+
+    // Statistics for the last flush
+    unsigned getDrawCount() const { return drawCount; }
+    unsigned getStateChanges() const { return stateChanges; }
+    unsigned getTriangleCount() const { return triangleCount; }
+    size_t getParticleCount() const { return particles.getCount(); }
+
+    // Milliseconds spent submitting the last flush on the CPU, and running
+    // the most recent one whose timing the GPU has reported
+    double getCpuTime() const { return cpuTime; }
+    double getGpuTime() const { return gpuTime; }
+
+private:
+    // Sort keys hold, from the top bit down, the texture, the mesh, its
+    // level of detail and the index of the item. Sorting the keys groups
+    // the items by state without moving the items themselves.
+    static const unsigned indexBits = 20;
+    static const unsigned levelBits = 2;
+    static const unsigned meshBits = 18;
+    static const uint64_t indexMask = (uint64_t(1) << indexBits) - 1;
+    static const uint64_t meshMask = (uint64_t(1) << meshBits) - 1;
+
+    MeshCache meshes;
+    std::vector<DrawItem> items;
+    std::vector<uint64_t> keys;
+
+    Backend backend = SHADER_BACKEND;
+    SceneShader shader;
+    bool shaderTried = false;
+    std::vector<SceneInstance> instances;
+    ParticleRenderer particles;
+
+    // Texels along each side of the shadow map
+    static const unsigned shadowMapSize = 2048;
+    ShadowMap shadowMap;
+    int shadowLight = -1;
+    float shadowFloor = 0;
+    float shadowReceiverTop = 0;
+    float shadowCasterTop = 0;
+
+    float detailSize = 128;
+
+    SceneLight lights[SceneFrame::maxLights];
+    unsigned lightCount = 0;
+
+    // Timer queries are read a frame late, so the CPU never waits on them
+    GLuint timerQueries[2] = {0, 0};
+    unsigned timerFrame = 0;
+
+    unsigned drawCount = 0;
+    unsigned stateChanges = 0;
+    unsigned triangleCount = 0;
+    double cpuTime = 0;
+    double gpuTime = 0;
+
+    void selectLevels(const GLfloat view[16]);
+    void flushLegacy(bool withNames, const GLfloat view[16]);
+    void flushShader(const GLfloat view[16]);
+    void drawBatches(bool textured);
+    void drawParticles(ParticleRenderer::Shape shape);
+    void beginTimer();
+    void endTimer();
+};
+
+#endif // RENDERQUEUE_H
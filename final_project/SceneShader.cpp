@@ -0,0 +1,332 @@
+#include "SceneShader.h"
+#include "MeshCache.h"
+
+#include <iostream>
+
+// Binding point of the per-frame uniform block
+static const GLuint frameBinding = 0;
+
+// Texture units the lit program samples from
+static const GLint diffuseUnit = 0;
+static const GLint shadowUnit = 1;
+
+// Every shader starts with the version and the per-frame uniform block
+static const char *header = R"(#version 330 core
+layout(std140) uniform Frame {
+    mat4 viewProjection;
+    mat4 shadowViewProjection;
+    vec4 cameraRight;
+    vec4 cameraUp;
+    vec4 sceneAmbient;
+    vec4 lightPosition[4];
+    vec4 lightAmbient[4];
+    vec4 lightDiffuse[4];
+    int lightCount;
+    int shadowLight;
+};
+)";
+
+static const char *vertexSource = R"(
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 normal;
+layout(location = 2) in vec2 texCoord;
+layout(location = 3) in mat4 model;
+layout(location = 7) in vec4 color;
+
+out vec3 worldPosition;
+out vec3 worldNormal;
+out vec2 uv;
+out vec4 baseColor;
+out vec4 shadowPosition;
+
+void main() {
+    vec4 world = model * vec4(position, 1.0);
+    worldPosition = world.xyz;
+    // Models are scaled unevenly, so normals need the inverse transpose
+    worldNormal = transpose(inverse(mat3(model))) * normal;
+    uv = texCoord;
+    baseColor = color;
+    shadowPosition = shadowViewProjection * world;
+    gl_Position = viewProjection * world;
+}
+)";
+
+static const char *fragmentSource = R"(
+uniform sampler2D diffuseTexture;
+uniform sampler2DShadow shadowMap;
+
+in vec3 worldPosition;
+in vec3 worldNormal;
+in vec2 uv;
+in vec4 baseColor;
+in vec4 shadowPosition;
+
+out vec4 fragmentColor;
+
+// How much of the shadowing light reaches this point, from 0 to 1
+float shadowFactor() {
+    vec3 p = shadowPosition.xyz / shadowPosition.w * 0.5 + 0.5;
+    if (any(lessThan(p, vec3(0.0))) || any(greaterThan(p, vec3(1.0)))) {
+        return 1.0;
+    }
+    // Four filtered lookups half a texel apart give a 3x3 texel blur
+    vec2 texel = 0.5 / vec2(textureSize(shadowMap, 0));
+    float lit = texture(shadowMap, vec3(p.xy + vec2(-texel.x, -texel.y), p.z)) +
+                texture(shadowMap, vec3(p.xy + vec2(texel.x, -texel.y), p.z)) +
+                texture(shadowMap, vec3(p.xy + vec2(-texel.x, texel.y), p.z)) +
+                texture(shadowMap, vec3(p.xy + vec2(texel.x, texel.y), p.z));
+    return lit * 0.25;
+}
+
+void main() {
+    vec3 n = normalize(worldNormal);
+    float shadow = shadowLight >= 0 ? shadowFactor() : 1.0;
+    vec3 light = sceneAmbient.rgb;
+    for (int i = 0; i < lightCount; i++) {
+        vec3 toLight = lightPosition[i].w == 0.0 ?
+            lightPosition[i].xyz : lightPosition[i].xyz - worldPosition;
+        float diffuse = max(dot(n, normalize(toLight)), 0.0);
+        if (i == shadowLight) {
+            diffuse *= shadow;
+        }
+        light += lightAmbient[i].rgb + diffuse * lightDiffuse[i].rgb;
+    }
+    vec4 lit = vec4(min(baseColor.rgb * light, vec3(1.0)), baseColor.a);
+    fragmentColor = lit * texture(diffuseTexture, uv);
+}
+)";
+
+// Only depth is written into the shadow map
+static const char *depthVertexSource = R"(
+layout(location = 0) in vec3 position;
+layout(location = 3) in mat4 model;
+
+void main() {
+    gl_Position = shadowViewProjection * model * vec4(position, 1.0);
+}
+)";
+
+static const char *depthFragmentSource = R"(
+void main() {
+}
+)";
+
+// Sphere particles feed the mesh fragment shader. The sphere is a unit
+// sphere, so each vertex is also its own normal.
+static const char *sphereVertexSource = R"(
+layout(location = 0) in vec3 position;
+layout(location = 8) in vec4 particle; // Centre, and radius in w
+layout(location = 9) in vec4 color;
+
+out vec3 worldPosition;
+out vec3 worldNormal;
+out vec2 uv;
+out vec4 baseColor;
+out vec4 shadowPosition;
+
+void main() {
+    vec4 world = vec4(particle.xyz + position * particle.w, 1.0);
+    worldPosition = world.xyz;
+    worldNormal = position;
+    uv = vec2(0.0);
+    baseColor = color;
+    shadowPosition = shadowViewProjection * world;
+    gl_Position = viewProjection * world;
+}
+)";
+
+// Billboards are spread along the camera's axes, so they always face it
+static const char *billboardVertexSource = R"(
+layout(location = 0) in vec2 corner;
+layout(location = 8) in vec4 particle; // Centre, and radius in w
+layout(location = 9) in vec4 color;
+
+out vec2 offset;
+out vec4 baseColor;
+
+void main() {
+    vec3 world = particle.xyz + (cameraRight.xyz * corner.x + cameraUp.xyz * corner.y) * particle.w;
+    offset = corner;
+    baseColor = color;
+    gl_Position = viewProjection * vec4(world, 1.0);
+}
+)";
+
+static const char *billboardFragmentSource = R"(
+in vec2 offset;
+in vec4 baseColor;
+
+out vec4 fragmentColor;
+
+void main() {
+    // A disc, fading out towards its edge
+    float distance = dot(offset, offset);
+    if (distance > 1.0) {
+        discard;
+    }
+    fragmentColor = vec4(baseColor.rgb, baseColor.a * (1.0 - distance));
+}
+)";
+
+SceneShader::~SceneShader() {
+    if (program) {
+        glDeleteProgram(program);
+        glDeleteProgram(depthProgram);
+        glDeleteProgram(sphereProgram);
+        glDeleteProgram(billboardProgram);
+        glDeleteBuffers(1, &frameBuffer);
+        glDeleteBuffers(1, &instanceBuffer);
+        glDeleteTextures(1, &whiteTexture);
+    }
+}
+
+GLuint SceneShader::compile(GLenum type, const char *source) {
+    GLuint shader = glCreateShader(type);
+    const char *sources[2] = {header, source};
+    glShaderSource(shader, 2, sources, nullptr);
+    glCompileShader(shader);
+
+    GLint compiled = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (!compiled) {
+        char log[1024];
+        glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+        std::cerr << "Failed to compile scene shader: " << log << std::endl;
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+GLuint SceneShader::link(const char *vertexSource, const char *fragmentSource) {
+    GLuint vertex = compile(GL_VERTEX_SHADER, vertexSource);
+    GLuint fragment = compile(GL_FRAGMENT_SHADER, fragmentSource);
+    if (!vertex || !fragment) {
+        glDeleteShader(vertex);
+        glDeleteShader(fragment);
+        return 0;
+    }
+
+    GLuint linked = glCreateProgram();
+    glAttachShader(linked, vertex);
+    glAttachShader(linked, fragment);
+    glLinkProgram(linked);
+    glDeleteShader(vertex);
+    glDeleteShader(fragment);
+
+    GLint status = GL_FALSE;
+    glGetProgramiv(linked, GL_LINK_STATUS, &status);
+    if (!status) {
+        char log[1024];
+        glGetProgramInfoLog(linked, sizeof(log), nullptr, log);
+        std::cerr << "Failed to link scene shader: " << log << std::endl;
+        glDeleteProgram(linked);
+        return 0;
+    }
+    glUniformBlockBinding(linked, glGetUniformBlockIndex(linked, "Frame"), frameBinding);
+    return linked;
+}
+
+bool SceneShader::load() {
+    program = link(vertexSource, fragmentSource);
+    depthProgram = link(depthVertexSource, depthFragmentSource);
+    sphereProgram = link(sphereVertexSource, fragmentSource);
+    billboardProgram = link(billboardVertexSource, billboardFragmentSource);
+    if (!program || !depthProgram || !sphereProgram || !billboardProgram) {
+        glDeleteProgram(program);
+        glDeleteProgram(depthProgram);
+        glDeleteProgram(sphereProgram);
+        glDeleteProgram(billboardProgram);
+        program = 0;
+        depthProgram = 0;
+        sphereProgram = 0;
+        billboardProgram = 0;
+        return false;
+    }
+
+    for (GLuint lit: {program, sphereProgram}) {
+        glUseProgram(lit);
+        glUniform1i(glGetUniformLocation(lit, "diffuseTexture"), diffuseUnit);
+        glUniform1i(glGetUniformLocation(lit, "shadowMap"), shadowUnit);
+    }
+    glUseProgram(0);
+
+    glGenBuffers(1, &frameBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, frameBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(SceneFrame), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    glGenBuffers(1, &instanceBuffer);
+
+    const unsigned char white[4] = {255, 255, 255, 255};
+    glGenTextures(1, &whiteTexture);
+    glBindTexture(GL_TEXTURE_2D, whiteTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return true;
+}
+
+void SceneShader::upload(const SceneFrame &frame, const SceneInstance *instances, size_t count) {
+    glBindBuffer(GL_UNIFORM_BUFFER, frameBuffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(SceneFrame), &frame);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, frameBinding, frameBuffer);
+
+    // Orphan the old instance data rather than wait for the GPU to finish
+    // reading it, growing the buffer when the frame has more instances
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    if (count > instanceCapacity) {
+        instanceCapacity = count * 2;
+    }
+    glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(SceneInstance), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(SceneInstance), instances);
+
+    // Meshes without normals use the fixed-function default normal
+    glVertexAttrib3f(NORMAL_ATTRIBUTE, 0.0f, 0.0f, 1.0f);
+    glVertexAttrib2f(TEXCOORD_ATTRIBUTE, 0.0f, 0.0f);
+}
+
+void SceneShader::beginDepth() const {
+    glUseProgram(depthProgram);
+}
+
+void SceneShader::begin(GLuint shadowMap) const {
+    glUseProgram(program);
+    glActiveTexture(GL_TEXTURE0 + shadowUnit);
+    glBindTexture(GL_TEXTURE_2D, shadowMap);
+    glActiveTexture(GL_TEXTURE0 + diffuseUnit);
+}
+
+void SceneShader::beginSpheres(GLuint shadowMap) const {
+    glUseProgram(sphereProgram);
+    glActiveTexture(GL_TEXTURE0 + shadowUnit);
+    glBindTexture(GL_TEXTURE_2D, shadowMap);
+    glActiveTexture(GL_TEXTURE0 + diffuseUnit);
+    glBindTexture(GL_TEXTURE_2D, whiteTexture);
+}
+
+void SceneShader::beginBillboards() const {
+    glUseProgram(billboardProgram);
+}
+
+void SceneShader::bindInstances(size_t first) const {
+    // The instance buffer stays bound to GL_ARRAY_BUFFER from begin()
+    const GLsizei stride = sizeof(SceneInstance);
+    const size_t base = first * sizeof(SceneInstance);
+    for (GLuint column = 0; column < 4; column++) {
+        glVertexAttribPointer(MODEL_ATTRIBUTE + column, 4, GL_FLOAT, GL_FALSE, stride,
+                              reinterpret_cast<const void *>(base + column * 4 * sizeof(float)));
+    }
+    glVertexAttribPointer(COLOR_ATTRIBUTE, 4, GL_FLOAT, GL_FALSE, stride,
+                          reinterpret_cast<const void *>(base + offsetof(SceneInstance, color)));
+}
+
+void SceneShader::end() const {
+    glActiveTexture(GL_TEXTURE0 + shadowUnit);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0 + diffuseUnit);
+    glUseProgram(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -0,0 +1,92 @@
+#ifndef SCENESHADER_H
+#define SCENESHADER_H
+
+#include <GL/glew.h>
+#include <cstddef>
+
+// Per-instance data, as laid out in the instance buffer
+struct SceneInstance {
+    float model[16]; // Column-major model matrix
+    float color[4];
+};
+
+// Per-frame camera and light data, as laid out in the uniform buffer
+// (std140: every array element is a whole vec4)
+struct SceneFrame {
+    static const unsigned maxLights = 4;
+
+    float viewProjection[16];
+    float shadowViewProjection[16]; // World to shadow map clip space
+    float cameraRight[4]; // World space axes of the camera, for billboards
+    float cameraUp[4];
+    float sceneAmbient[4];
+    float lightPosition[maxLights][4]; // World space, w = 0 for a directional light
+    float lightAmbient[maxLights][4];
+    float lightDiffuse[maxLights][4];
+    int lightCount;
+    int shadowLight; // Light whose diffuse term is shadowed, or -1 for none
+    int padding[2];
+};
+
+// GLSL 3.3 core program that lights and textures the scene the way the
+// fixed-function pipeline did, with diffuse lights and colour material.
+// Camera and lights come from a uniform buffer updated once a frame, and
+// each instance's model matrix and colour from instanced attributes.
+// A second, depth-only program draws the same instances into a shadow map,
+// which the first looks up to shadow one of the lights. Two more draw
+// particles from their own instance data: spheres, lit and shadowed by the
+// same fragment shader as the meshes, and unlit camera-facing discs.
+class SceneShader {
+public:
+    SceneShader() = default;
+    ~SceneShader();
+
+    SceneShader(const SceneShader &) = delete;
+    SceneShader &operator=(const SceneShader &) = delete;
+
+    // Compiles the program and creates its buffers. Returns false, after
+    // reporting why, if the program couldn't be built.
+    bool load();
+    bool isLoaded() const { return program != 0; }
+
+    // Uploads the frame and instance data for both programs
+    void upload(const SceneFrame &frame, const SceneInstance *instances, size_t count);
+
+    // Makes the depth-only program current, for drawing into a shadow map
+    void beginDepth() const;
+
+    // Makes the lit program current, with the given shadow map bound
+    void begin(GLuint shadowMap) const;
+
+    // Makes the sphere particle program current, lit like the meshes with
+    // the given shadow map bound
+    void beginSpheres(GLuint shadowMap) const;
+
+    // Makes the billboard particle program current
+    void beginBillboards() const;
+
+    // Points the instance attributes of the bound vertex array object at
+    // the instances from the given one onwards
+    void bindInstances(size_t first) const;
+
+    // Restores the fixed-function pipeline
+    void end() const;
+
+    // 1x1 white texture, bound for untextured items
+    GLuint getWhiteTexture() const { return whiteTexture; }
+
+private:
+    GLuint program = 0;
+    GLuint depthProgram = 0;
+    GLuint sphereProgram = 0;
+    GLuint billboardProgram = 0;
+    GLuint frameBuffer = 0;
+    GLuint instanceBuffer = 0;
+    size_t instanceCapacity = 0;
+    GLuint whiteTexture = 0;
+
+    static GLuint compile(GLenum type, const char *source);
+    static GLuint link(const char *vertexSource, const char *fragmentSource);
+};
+
+#endif // SCENESHADER_H
@@ -0,0 +1,38 @@
+#ifndef SCENESNAPSHOT_H
+#define SCENESNAPSHOT_H
+
+#include <vector>
+
+#include "Mesh.h"
+#include "core.h"
+
+// A box as the simulation left it at the end of a step
+struct BoxSnapshot {
+    int index; // In SimplePhysics' boxes, for commands about this box
+    const Mesh *mesh;
+    cyclone::Matrix4 transform;
+    cyclone::Vector3 halfSize;
+    bool awake;
+    bool dragged;
+    bool swallowed; // Falling into the hole, and no longer pickable
+};
+
+// The player's hole as the simulation left it at the end of a step
+struct HoleSnapshot {
+    cyclone::Matrix4 transform;
+    float swallowRadius = 0;
+
+    cyclone::Vector3 getPosition() const { return transform.getAxisVector(3); }
+};
+
+// Everything the window draws of the game, copied out by the simulation
+// thread at the end of each step. Once published it is only read, so the
+// window can draw it and pick from it while the simulation carries on.
+struct SceneSnapshot {
+    std::vector<BoxSnapshot> boxes;
+    HoleSnapshot hole;
+    int score = 0;
+    float timerSeconds = 0;
+};
+
+#endif // SCENESNAPSHOT_H
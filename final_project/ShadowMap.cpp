@@ -0,0 +1,246 @@
+#include "ShadowMap.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <iostream>
+
+// How far the depth pass pushes depths back, so surfaces don't shadow
+// themselves
+static const GLfloat depthSlopeBias = 2.0f;
+static const GLfloat depthUnitBias = 4.0f;
+
+// Farthest the frustum is stretched towards the light to take in casters
+static const double maxCasterReach = 1000.0;
+
+// out = inverse of m, both column-major. Returns false for a singular m.
+static bool invertMatrix(const float m[16], double out[16]) {
+    double inv[16];
+    inv[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] + m[9] * m[7] * m[14] +
+             m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+    inv[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] - m[8] * m[7] * m[14] -
+             m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+    inv[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] + m[8] * m[7] * m[13] +
+             m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+    inv[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] - m[8] * m[6] * m[13] -
+              m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+    inv[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] - m[9] * m[3] * m[14] -
+             m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+    inv[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] + m[8] * m[3] * m[14] +
+             m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+    inv[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] - m[8] * m[3] * m[13] -
+             m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+    inv[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] + m[8] * m[2] * m[13] +
+              m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+    inv[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] - m[5] * m[2] * m[15] + m[5] * m[3] * m[14] +
+             m[13] * m[2] * m[7] - m[13] * m[3] * m[6];
+    inv[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] + m[4] * m[2] * m[15] - m[4] * m[3] * m[14] -
+             m[12] * m[2] * m[7] + m[12] * m[3] * m[6];
+    inv[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] - m[4] * m[1] * m[15] + m[4] * m[3] * m[13] +
+              m[12] * m[1] * m[7] - m[12] * m[3] * m[5];
+    inv[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] + m[4] * m[1] * m[14] - m[4] * m[2] * m[13] -
+              m[12] * m[1] * m[6] + m[12] * m[2] * m[5];
+    inv[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] + m[5] * m[2] * m[11] - m[5] * m[3] * m[10] -
+             m[9] * m[2] * m[7] + m[9] * m[3] * m[6];
+    inv[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] - m[4] * m[2] * m[11] + m[4] * m[3] * m[10] +
+             m[8] * m[2] * m[7] - m[8] * m[3] * m[6];
+    inv[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] + m[4] * m[1] * m[11] - m[4] * m[3] * m[9] -
+              m[8] * m[1] * m[7] + m[8] * m[3] * m[5];
+    inv[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] - m[4] * m[1] * m[10] + m[4] * m[2] * m[9] +
+              m[8] * m[1] * m[6] - m[8] * m[2] * m[5];
+
+    const double determinant = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+    if (determinant == 0) {
+        return false;
+    }
+    for (int i = 0; i < 16; i++) {
+        out[i] = inv[i] / determinant;
+    }
+    return true;
+}
+
+// Maps a point from normalized device coordinates back to the world
+static void unproject(const double inverse[16], double x, double y, double z, double out[3]) {
+    double world[4];
+    for (int row = 0; row < 4; row++) {
+        world[row] = inverse[row] * x + inverse[4 + row] * y + inverse[8 + row] * z + inverse[12 + row];
+    }
+    for (int i = 0; i < 3; i++) {
+        out[i] = world[i] / world[3];
+    }
+}
+
+static double dot(const double a[3], const double b[3]) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static void normalize(double v[3]) {
+    const double length = std::sqrt(dot(v, v));
+    for (int i = 0; i < 3; i++) {
+        v[i] /= length;
+    }
+}
+
+ShadowMap::~ShadowMap() {
+    if (framebuffer) {
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteTextures(1, &texture);
+    }
+}
+
+bool ShadowMap::load(unsigned size) {
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+    // Linear filtering of a comparison texture blends the four nearest
+    // results, softening the edges for free
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    GLint bound = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &bound);
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, texture, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, bound);
+
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Shadow map framebuffer is incomplete: " << status << std::endl;
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteTextures(1, &texture);
+        framebuffer = 0;
+        texture = 0;
+        return false;
+    }
+    this->size = size;
+    return true;
+}
+
+void ShadowMap::fit(const float cameraViewProjection[16], const float lightPosition[4], float floorHeight,
+                    float receiverTop, float casterTop, float lightViewProjection[16]) const {
+    double inverse[16];
+    if (!invertMatrix(cameraViewProjection, inverse)) {
+        return;
+    }
+
+    // Follow each corner of the screen into the world, and find where it
+    // crosses the bottom and the top of the receivers
+    double corners[8][3];
+    double centre[3] = {0, 0, 0};
+    int count = 0;
+    const double heights[2] = {floorHeight, receiverTop};
+    for (int corner = 0; corner < 4; corner++) {
+        const double x = (corner & 1) ? 1.0 : -1.0;
+        const double y = (corner & 2) ? 1.0 : -1.0;
+        double nearPoint[3], farPoint[3];
+        unproject(inverse, x, y, -1.0, nearPoint);
+        unproject(inverse, x, y, 1.0, farPoint);
+
+        const double rise = farPoint[1] - nearPoint[1];
+        for (double height: heights) {
+            double t = std::fabs(rise) > 1e-9 ? (height - nearPoint[1]) / rise : 0.0;
+            t = std::min(std::max(t, 0.0), 1.0);
+            double *point = corners[count++];
+            for (int i = 0; i < 3; i++) {
+                point[i] = nearPoint[i] + (farPoint[i] - nearPoint[i]) * t;
+                centre[i] += point[i] / 8;
+            }
+        }
+    }
+
+    // The direction the light shines in
+    double forward[3];
+    for (int i = 0; i < 3; i++) {
+        forward[i] = lightPosition[3] == 0 ? -lightPosition[i] : centre[i] - lightPosition[i];
+    }
+    if (dot(forward, forward) < 1e-12) {
+        forward[0] = 0;
+        forward[1] = -1;
+        forward[2] = 0;
+    }
+    normalize(forward);
+
+    // Side and up axes of the light's view, as gluLookAt builds them
+    const double worldUp[3] = {0, std::fabs(forward[1]) > 0.99 ? 0.0 : 1.0, std::fabs(forward[1]) > 0.99 ? 1.0 : 0.0};
+    double side[3] = {forward[1] * worldUp[2] - forward[2] * worldUp[1],
+                      forward[2] * worldUp[0] - forward[0] * worldUp[2],
+                      forward[0] * worldUp[1] - forward[1] * worldUp[0]};
+    normalize(side);
+    const double up[3] = {side[1] * forward[2] - side[2] * forward[1], side[2] * forward[0] - side[0] * forward[2],
+                          side[0] * forward[1] - side[1] * forward[0]};
+
+    // Bound the receivers in the light's view. Depth is measured along the
+    // light, increasing away from it.
+    double minX = DBL_MAX, maxX = -DBL_MAX, minY = DBL_MAX, maxY = -DBL_MAX;
+    double minDepth = DBL_MAX, maxDepth = -DBL_MAX;
+    double reach = 0;
+    for (const auto &point: corners) {
+        const double x = dot(side, point), y = dot(up, point), depth = dot(forward, point);
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+        minDepth = std::min(minDepth, depth);
+        maxDepth = std::max(maxDepth, depth);
+
+        // How far back towards the light a caster up to casterTop can be
+        if (forward[1] < -1e-6) {
+            reach = std::max(reach, (casterTop - point[1]) / -forward[1]);
+        }
+    }
+    reach = std::min(reach, maxCasterReach);
+
+    // Snap the frustum to whole texels, so the shadows' edges don't crawl
+    // as the camera moves
+    const double texelX = (maxX - minX) / size;
+    const double texelY = (maxY - minY) / size;
+    if (texelX > 0 && texelY > 0) {
+        minX = std::floor(minX / texelX) * texelX;
+        maxX = minX + texelX * size;
+        minY = std::floor(minY / texelY) * texelY;
+        maxY = minY + texelY * size;
+    }
+
+    // An orthographic projection of the light's view box, with the view's
+    // rows folded in: x along side, y along up, z along the light
+    const double nearDepth = minDepth - reach - 1.0;
+    const double farDepth = maxDepth + 1.0;
+    const double scaleX = 2 / (maxX - minX), scaleY = 2 / (maxY - minY), scaleZ = 2 / (farDepth - nearDepth);
+    for (int i = 0; i < 3; i++) {
+        lightViewProjection[i * 4 + 0] = static_cast<float>(side[i] * scaleX);
+        lightViewProjection[i * 4 + 1] = static_cast<float>(up[i] * scaleY);
+        lightViewProjection[i * 4 + 2] = static_cast<float>(forward[i] * scaleZ);
+        lightViewProjection[i * 4 + 3] = 0.0f;
+    }
+    lightViewProjection[12] = static_cast<float>(-(maxX + minX) / (maxX - minX));
+    lightViewProjection[13] = static_cast<float>(-(maxY + minY) / (maxY - minY));
+    lightViewProjection[14] = static_cast<float>(-(farDepth + nearDepth) / (farDepth - nearDepth));
+    lightViewProjection[15] = 1.0f;
+}
+
+void ShadowMap::begin() {
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, previousViewport);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, size, size);
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_TRUE);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(depthSlopeBias, depthUnitBias);
+}
+
+void ShadowMap::end() const {
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+    glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+}
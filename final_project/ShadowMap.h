@@ -0,0 +1,51 @@
+#ifndef SHADOWMAP_H
+#define SHADOWMAP_H
+
+#include <GL/glew.h>
+
+// Depth texture that the scene is rendered into from a light, to be looked
+// up when the scene is lit. The light's view is an orthographic frustum fitted
+// each frame to what the camera can see, so the shadows cost a depth-only
+// pass at the map's resolution, however big the world is.
+class ShadowMap {
+public:
+    ShadowMap() = default;
+    ~ShadowMap();
+
+    ShadowMap(const ShadowMap &) = delete;
+    ShadowMap &operator=(const ShadowMap &) = delete;
+
+    // Creates the depth texture and its framebuffer, size texels square.
+    // Returns false, after reporting why, if the framebuffer isn't usable.
+    bool load(unsigned size);
+    bool isLoaded() const { return framebuffer != 0; }
+
+    // Builds the light's view and projection, column-major.
+    //
+    // The receivers are whatever the camera sees between floorHeight and
+    // receiverTop: the frustum is fitted around where the camera's corner
+    // rays cross those two heights. It is then stretched towards the light
+    // far enough to take in anything up to casterTop that can shade them.
+    // A point light is treated as shining along the line to the middle of
+    // that region, which is a fair match for a region small next to its
+    // distance from the light.
+    void fit(const float cameraViewProjection[16], const float lightPosition[4], float floorHeight,
+             float receiverTop, float casterTop, float lightViewProjection[16]) const;
+
+    // Renders into the map until end(), which restores the framebuffer and
+    // viewport in use before
+    void begin();
+    void end() const;
+
+    GLuint getTexture() const { return texture; }
+
+private:
+    GLuint framebuffer = 0;
+    GLuint texture = 0;
+    unsigned size = 0;
+
+    GLint previousFramebuffer = 0;
+    GLint previousViewport[4] = {0, 0, 0, 0};
+};
+
+#endif // SHADOWMAP_H
@@ -1,90 +1,362 @@
+#define NOMINMAX
+
 #include "SimplePhysics.h"
 
+#include <algorithm>
 #include <iostream>
-#include <random>
 
 void SimplePhysics::reset() {
-    // Random number generator for box sizes and positions
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<float> sizeDist(1.0f, 2.0f);
-    std::uniform_real_distribution<float> posDist(-100.0f, 100.0f);
-    std::uniform_real_distribution<float> heightDist(10.0f, 50.0f);
+    changed = true;
 
-    for (auto box: boxData) {
-        const float scale = sizeDist(gen);
+    // Every body goes back to the pool at once, and the boxes take new
+    // ones in order so they fill the slabs contiguously again
+    bodyPool.rewind();
+    for (Box* box : boxData) {
+        box->revive(bodyPool.create());
+    }
+
+    // Draw every box's size and position in bulk from the scene stream
+    const unsigned count = static_cast<unsigned>(boxData.size());
+    std::vector<cyclone::real> scales(count);
+    std::vector<cyclone::Vector3> positions(count);
+    sceneRandom.fillReal(scales.data(), count, 1, 2);
+    sceneRandom.fillVector(positions.data(), count, cyclone::Vector3(-100, 10, -100),
+                           cyclone::Vector3(100, 50, 100));
+
+    for (unsigned i = 0; i < count; i++) {
         cyclone::Vector3 extents(1.0f, 2.0f, 1.0f);
-        extents *= scale;
-        cyclone::Vector3 position(posDist(gen), heightDist(gen), posDist(gen));
+        extents *= scales[i];
         cyclone::Quaternion orientation;
 
-        box->setState(position, orientation, extents, cyclone::Vector3(0, 0, 0));
+        boxData[i]->setState(positions[i], orientation, extents, cyclone::Vector3(0, 0, 0));
     }
+    explosions.clear();
 }
 
-void SimplePhysics::generateContacts() {
+void SimplePhysics::generateContacts(cyclone::real duration) {
     // Set up the collision data structure
     cData->reset(maxContacts);
     cData->friction = 0.5f;  // Increased friction for better stability
     cData->restitution = 0.1f;  // Reduced restitution to minimize bouncing
     cData->tolerance = 0.05f;  // Increased tolerance to prevent micro-collisions
+    cData->speculativeTime = duration;  // Stop closing bodies before they overlap
 
-    // Create the ground plane
-    cyclone::CollisionPlane plane;
-    plane.direction = cyclone::Vector3(0, 1, 0);
-    plane.offset = 0;
+    // Static boxes only need a new tree when the scenery itself changed
+    if (staticTreeDirty) {
+        staticTree.clear();
+        for (unsigned i = 0; i < staticBoxes.size(); i++) {
+            staticTree.insert(cyclone::AABB::fromBox(*staticBoxes[i]), i);
+        }
+        staticTree.build();
+        staticTreeDirty = false;
+    }
 
-    // Check collisions with ground and between boxes
+    // Gather every box that can touch anything, with contiguous copies of
+    // their transforms for the batched ground test
+    active.clear();
+    groundTransforms.clear();
+    groundHalfSizes.clear();
+    groundBodies.clear();
     for (auto box: boxData) {
-        if (!box->isValid())
-            continue;
-
-        // Check for collisions with the ground plane
-        if (!cData->hasMoreContacts())
-            return;
-        if (!box->isSwallowed()) {
-            // Only generate contacts if the box is close to or below the ground
-            cyclone::Vector3 position = box->getPosition();
-            cyclone::Vector3 extents = box->halfSize;
-            if (position.y - extents.y <= cData->tolerance) {
-                cyclone::CollisionDetector::boxAndHalfSpace(*box, plane, cData);
+        if (box->isValid() && !box->isSwallowed()) {
+            active.push_back(box);
+            groundTransforms.push_back(box->getTransform());
+            groundHalfSizes.push_back(box->halfSize);
+            groundBodies.push_back(box->body);
+        }
+    }
+    const unsigned activeCount = static_cast<unsigned>(active.size());
+    const unsigned boxTasks = (activeCount + boxesPerTask - 1) / boxesPerTask;
+
+    // The boxes all move, so their tree is rebuilt every step
+    dynamicTree.clear();
+    for (unsigned i = 0; i < activeCount; i++) {
+        dynamicTree.insert(cyclone::AABB::fromBox(*active[i]), i);
+    }
+    dynamicTree.build();
+
+    // Find the candidate pairs. Each task keeps its own list, so the merged
+    // list comes out in the same order however the tasks were scheduled
+    if (taskPairs.size() < boxTasks)
+        taskPairs.resize(boxTasks);
+    pool.run(boxTasks, [this, activeCount](unsigned task, unsigned worker) {
+        NarrowphaseWorker &w = workers[worker];
+        std::vector<BoxPair> &found = taskPairs[task];
+        found.clear();
+
+        const unsigned begin = task * boxesPerTask;
+        const unsigned end = begin + boxesPerTask < activeCount ? begin + boxesPerTask : activeCount;
+        for (unsigned i = begin; i < end; i++) {
+            w.candidates.clear();
+            dynamicTree.query(cyclone::AABB::fromBox(*active[i]), w.candidates);
+            for (unsigned j : w.candidates) {
+                // Each pair once, and never two sleeping boxes
+                if (j <= i)
+                    continue;
+                if (!active[i]->body->getAwake() && !active[j]->body->getAwake())
+                    continue;
+                found.push_back({i, j});
+            }
+        }
+    });
+    pairs.clear();
+    for (unsigned t = 0; t < boxTasks; t++) {
+        pairs.insert(pairs.end(), taskPairs[t].begin(), taskPairs[t].end());
+    }
+
+    // Narrowphase: the first tasks test runs of boxes against the ground and
+    // the scenery, the rest test runs of pairs. Every worker writes into its
+    // own buffer and each task records where its contacts went
+    const unsigned pairCount = static_cast<unsigned>(pairs.size());
+    const unsigned pairTasks = (pairCount + pairsPerTask - 1) / pairsPerTask;
+    taskOutputs.resize(boxTasks + pairTasks);
+    for (auto &w: workers) {
+        w.data.reset(maxContacts);
+        w.data.friction = cData->friction;
+        w.data.restitution = cData->restitution;
+        w.data.tolerance = cData->tolerance;
+        w.data.speculativeTime = cData->speculativeTime;
+    }
+
+    pool.run(boxTasks + pairTasks, [this, activeCount, boxTasks, pairCount](unsigned task, unsigned worker) {
+        NarrowphaseWorker &w = workers[worker];
+        TaskOutput &output = taskOutputs[task];
+        output.worker = worker;
+        output.first = w.data.contactCount;
+
+        if (task < boxTasks) {
+            const unsigned begin = task * boxesPerTask;
+            const unsigned end = begin + boxesPerTask < activeCount ? begin + boxesPerTask : activeCount;
+            cyclone::CollisionDetector::boxesAndHalfSpace(&groundTransforms[begin], &groundHalfSizes[begin],
+                                                          &groundBodies[begin], end - begin, ground, &w.data);
+            for (unsigned i = begin; i < end; i++) {
+                generateSceneryContacts(active[i], &w.data, w.candidates);
+            }
+        } else {
+            const unsigned begin = (task - boxTasks) * pairsPerTask;
+            const unsigned end = begin + pairsPerTask < pairCount ? begin + pairsPerTask : pairCount;
+            for (unsigned i = begin; i < end; i++) {
+                if (!w.data.hasMoreContacts())
+                    break;
+                cyclone::CollisionDetector::boxAndBox(*active[pairs[i].one], *active[pairs[i].two], &w.data);
             }
         }
 
-         //Check for collisions with each other box
-         //for (auto other: boxData) {
-         //    if (!other->isValid())
-         //        continue;
-         //    if (!cData->hasMoreContacts())
-         //        return;
-         //    cyclone::CollisionDetector::boxAndBox(*box, *other, cData);
-         //}
+        output.count = w.data.contactCount - output.first;
+    });
+
+    // Merge the buffers in task order, so the resolver always sees the same
+    // contacts in the same order
+    for (const TaskOutput &output: taskOutputs) {
+        unsigned count = output.count;
+        if (count > static_cast<unsigned>(cData->contactsLeft))
+            count = cData->contactsLeft;
+        const cyclone::Contact *first = &workers[output.worker].contacts[output.first];
+        std::copy(first, first + count, cData->contacts);
+        cData->addContacts(count);
+    }
+}
+
+void SimplePhysics::generateBoxContacts(Box* box, cyclone::CollisionData* data) {
+    cyclone::CollisionDetector::boxesAndHalfSpace(&box->getTransform(), &box->halfSize, &box->body, 1, ground, data);
+    generateSceneryContacts(box, data, candidates);
+}
+
+void SimplePhysics::generateSceneryContacts(Box* box, cyclone::CollisionData* data,
+                                            std::vector<unsigned>& found) const {
+    // Check for collisions with the static scenery near the box
+    if (staticTree.getSize() > 0) {
+        found.clear();
+        staticTree.query(cyclone::AABB::fromBox(*box), found);
+        for (unsigned id : found) {
+            if (!data->hasMoreContacts())
+                return;
+            cyclone::CollisionDetector::boxAndBox(*box, *staticBoxes[id], data);
+        }
+    }
+}
+
+void SimplePhysics::integrateSwept(Box* box, cyclone::real duration) {
+    // Advance the box to its earliest possible impact, resolve whatever it
+    // touches there and carry on, so it cannot pass through the ground or
+    // the scenery however far it travels in the step
+    sweepData.friction = cData->friction;
+    sweepData.restitution = cData->restitution;
+    sweepData.tolerance = cData->tolerance;
+    sweepData.speculativeTime = 0;  // Each sweep already stops short of the impact
+
+    const cyclone::real minAdvance = duration / maxSweepSteps;
+    cyclone::real remaining = duration;
+    for (unsigned step = 0; remaining > 0; step++) {
+        cyclone::real advance = cyclone::ContinuousDetector::getSafeStep(*box);
+        advance = std::min(advance,
+                           cyclone::ContinuousDetector::boxAndHalfSpace(*box, ground, remaining, cData->tolerance));
+
+        if (staticTree.getSize() > 0) {
+            // Only scenery inside the volume swept this step can be hit
+            cyclone::AABB swept = cyclone::AABB::fromBox(*box);
+            cyclone::Vector3 travel = box->body->getVelocity() * remaining;
+            swept.enclose(cyclone::AABB(swept.min + travel, swept.max + travel));
+
+            candidates.clear();
+            staticTree.query(swept, candidates);
+            for (unsigned id : candidates) {
+                cyclone::real impact = cyclone::ContinuousDetector::boxAndStatic(
+                        *box, cyclone::AABB::fromBox(*staticBoxes[id]), remaining);
+                // Scenery we already overlap is left to the contacts
+                if (impact > 0)
+                    advance = std::min(advance, impact);
+            }
+        }
+
+        // Always make some progress, and finish the step in the last sweep
+        advance = std::max(advance, minAdvance);
+        const bool last = advance >= remaining || step + 1 == maxSweepSteps;
+        if (last)
+            advance = remaining;
+
+        box->body->integrate(advance, last);
+        box->calculateInternals();
+        remaining -= advance;
+        if (last)
+            break;
+
+        sweepData.reset(maxSweepContacts);
+        generateBoxContacts(box, &sweepData);
+        resolver->resolveContacts(sweepData.contactArray, sweepData.contactCount, advance);
     }
 }
 
 void SimplePhysics::update(cyclone::real duration) {
     // Generate contacts
-    generateContacts();
+    generateContacts(duration);
 
     // Resolve the contacts
     resolver->resolveContacts(cData->contactArray, cData->contactCount, duration);
 
-    // Update the physics of each box
+    // Push the boxes caught by any explosion. The tree and body list were
+    // built by generateContacts this step
+    explosions.update(dynamicTree, groundBodies.data(), duration);
+
+    // Update the physics of each box. Sleeping boxes don't move, so the
+    // scene only changes while one is awake
     for (auto box: boxData) {
         if (box->isValid()) {
-            box->body->integrate(duration);
-            box->calculateInternals();
+            if (box->body->getAwake()) {
+                changed = true;
+            }
+            // Swallowed boxes are meant to fall through the floor
+            if (!box->isSwallowed() && cyclone::ContinuousDetector::needsSweep(*box, duration)) {
+                integrateSwept(box, duration);
+            } else {
+                box->body->integrate(duration);
+                box->calculateInternals();
+            }
         }
     }
 }
 
-void SimplePhysics::render(int shadow, const GLuint textureID) {
+void SimplePhysics::snapshot(std::vector<BoxSnapshot>& boxes) const {
+    boxes.clear();
     for (int i = 0; i < boxData.size(); i++) {
-        if (boxData[i]->isValid()) {
-            boxData[i]->draw(i + 1, shadow, textureID);
-            if (m_drawHitboxes) {
-                boxData[i]->drawHitbox(i + 1, shadow);
+        const Box* box = boxData[i];
+        if (box->isValid()) {
+            BoxSnapshot copy;
+            copy.index = i;
+            copy.mesh = box->getMesh();
+            copy.transform = box->getTransform();
+            copy.halfSize = box->halfSize;
+            copy.awake = box->body->getAwake();
+            copy.dragged = box->isDragged();
+            copy.swallowed = box->isSwallowed();
+            boxes.push_back(copy);
+        }
+    }
+}
+
+void SimplePhysics::render(RenderQueue& queue, const std::vector<BoxSnapshot>& boxes, const GLuint textureID,
+                           bool hitboxes) {
+    // Textured models are drawn white, so the texture shows as it is
+    static const float white[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+
+    // Models go through the queue; the debug hitboxes are drawn directly
+    for (const BoxSnapshot& box : boxes) {
+        GLfloat mat[16];
+        box.transform.fillGLArray(mat);
+
+        if (box.mesh) {
+            const Mesh* mesh = box.mesh;
+            float modelExtentX = mesh->bboxMax.x - mesh->bboxMin.x;
+            float modelExtentY = mesh->bboxMax.y - mesh->bboxMin.y;
+            float modelExtentZ = mesh->bboxMax.z - mesh->bboxMin.z;
+
+            float scaleX = (box.halfSize.x * 2) / modelExtentX;
+            float scaleY = (box.halfSize.y * 2) / modelExtentY;
+            float scaleZ = (box.halfSize.z * 2) / modelExtentZ;
+
+            // Scale the model to the box along each of its own axes
+            GLfloat model[16];
+            std::copy(mat, mat + 16, model);
+            for (int i = 0; i < 3; i++) {
+                model[i] *= scaleX;
+                model[4 + i] *= scaleY;
+                model[8 + i] *= scaleZ;
+            }
+            queue.add(*mesh, textureID, model, white, box.index + 1);
+        }
+
+        if (hitboxes) {
+            if (box.dragged) {
+                glColor3f(1.0f, 0.5f, 0.5f);
+            } else if (box.awake) {
+                glColor3f(0.7f, 0.7f, 1.0f);
+            } else {
+                glColor3f(1.0f, 0.7f, 0.7f);
             }
+
+            glPushMatrix();
+            glMultMatrixf(mat);
+            glScalef(static_cast<GLfloat>(box.halfSize.x) * 2, static_cast<GLfloat>(box.halfSize.y) * 2,
+                     static_cast<GLfloat>(box.halfSize.z) * 2);
+            glutWireCube(1.0f); // Draw a wireframe cube for the hitbox
+            glPopMatrix();
+        }
+    }
+}
+
+void SimplePhysics::addExplosion(const cyclone::Vector3& position) {
+    // Boxes weigh one unit, so the forces are much gentler than the
+    // defaults, which are meant for heavier bodies
+    cyclone::Explosion explosion;
+    explosion.detonation = position;
+    explosion.implosionMaxRadius = 12;
+    explosion.implosionMinRadius = 2;
+    explosion.implosionForce = 20;
+    explosion.shockwaveSpeed = 40;
+    explosion.shockwaveThickness = 4;
+    explosion.peakConcussionForce = 400;
+    explosion.concussionDuration = 0.5f;
+    explosion.peakConvectionForce = 30;
+    explosion.chimneyRadius = 6;
+    explosion.chimneyHeight = 15;
+    explosion.convectionDuration = 1.5f;
+    explosions.add(explosion);
+}
+
+void SimplePhysics::addStaticBox(cyclone::CollisionBox* box) {
+    box->body->setBodyType(cyclone::RigidBody::STATIC_BODY);
+    box->body->calculateDerivedData();
+    box->calculateInternals();
+    staticBoxes.push_back(box);
+    staticTreeDirty = true;
+}
+
+void SimplePhysics::removeStaticBox(cyclone::CollisionBox* box) {
+    for (size_t i = 0; i < staticBoxes.size(); i++) {
+        if (staticBoxes[i] == box) {
+            staticBoxes.erase(staticBoxes.begin() + i);
+            staticTreeDirty = true;
+            break;
         }
     }
 }
@@ -1,30 +1,38 @@
 #pragma once
+#include "RenderQueue.h"
+
 #include <FL/glut.H>
 #include <GL/gl.h>
 #include <vector>
 
 #include "Mesh.h"
+#include "SceneSnapshot.h"
+#include "pool.h"
+#include "broadphase.h"
+#include "collide_continuous.h"
 #include "collide_fine.h"
 #include "contacts.h"
+#include "explosion.h"
+#include "random.h"
+#include "threadpool.h"
 #include "world.h"
 
 class Box : public cyclone::CollisionBox {
 public:
+    // Bodies live in SimplePhysics' pool, so a box starts without one
     Box() {
-        body = new cyclone::RigidBody();
-        body->setCanSleep(true);
-        body->setAwake(true);
+        body = nullptr;
         isBeingDragged = false;
-        mesh = Mesh(
-            {},
-            {},
-            {},
-            {}
-        );
     }
 
-    ~Box() {
-        delete body;
+    // Gives the box a freshly created body and puts it back in play
+    void revive(cyclone::RigidBody* newBody) {
+        body = newBody;
+        body->setCanSleep(true);
+        body->setAwake(true);
+        isBeingDragged = false;
+        valid = true;
+        swallowed = false;
     }
 
     void setState(const cyclone::Vector3& position,
@@ -53,7 +61,8 @@ public:
         calculateInternals();
     }
 
-    void setMesh(const Mesh& mesh) {
+    // Boxes share the window's model meshes rather than holding copies
+    void setMesh(const Mesh* mesh) {
         this->mesh = mesh;
     }
 
@@ -78,6 +87,7 @@ public:
             body->setVelocity(cyclone::Vector3(0, 0, 0));
             body->setRotation(cyclone::Vector3(0, 0, 0));
         }
+        body->calculateDerivedData();
         calculateInternals();
     }
 
@@ -112,64 +122,13 @@ public:
         }
     }
 
-    void drawHitbox(int name, int shadow) const {
-        GLfloat mat[16];
-        body->getGLTransform(mat);
-
-        if (shadow) {
-            glColor4f(0.2f, 0.2f, 0.2f, 0.5f);
-        } else if (isBeingDragged) {
-            glColor3f(1.0f, 0.5f, 0.5f);
-        } else if (body->getAwake()) {
-            glColor3f(0.7f, 0.7f, 1.0f);
-        } else {
-            glColor3f(1.0f, 0.7f, 0.7f);
-        }
-
-        glLoadName(name);
-        glPushMatrix();
-        glMultMatrixf(mat);
-        glScalef(static_cast<GLfloat>(halfSize.x) * 2, static_cast<GLfloat>(halfSize.y) * 2, static_cast<GLfloat>(halfSize.z) * 2);
-        glutWireCube(1.0f); // Draw a wireframe cube for the hitbox
-        glPopMatrix();
-    }
-
-    void draw(int name, int shadow, const GLuint textureID) {
-        GLfloat mat[16];
-        body->getGLTransform(mat);
-        const cyclone::Vector3 position = body->getPosition();
-
-        if (shadow) {
-            glColor4f(0.2f, 0.2f, 0.2f, 0.5f);
-        } else if (isBeingDragged) {
-            glColor3f(1.0f, 0.5f, 0.5f);
-        } else if (body->getAwake()) {
-            glColor3f(0.7f, 0.7f, 1.0f);
-        } else {
-            glColor3f(1.0f, 0.7f, 0.7f);
-        }
-
-        float modelExtentX = mesh.bboxMax.x - mesh.bboxMin.x;
-        float modelExtentY = mesh.bboxMax.y - mesh.bboxMin.y;
-        float modelExtentZ = mesh.bboxMax.z - mesh.bboxMin.z;
+    const Mesh* getMesh() const { return mesh; }
+    bool isDragged() const { return isBeingDragged; }
 
-        float scaleX = (halfSize.x * 2) / modelExtentX;
-        float scaleY = (halfSize.y * 2) / modelExtentY;
-        float scaleZ = (halfSize.z * 2) / modelExtentZ;
-
-        glLoadName(name);
-        glPushMatrix();
-        glMultMatrixf(mat);
-        glScalef(static_cast<GLfloat>(scaleX), static_cast<GLfloat>(scaleY), static_cast<GLfloat>(scaleZ));
-        mesh.drawModel(mesh, textureID);
-        glPopMatrix();
-    }
-    
     bool isValid() const { return valid; }
     bool isSwallowed() const { return swallowed; }
     void invalidate() {
         valid = false;
-        delete body;
         body = nullptr;
     }
     void setSwallowed(bool swallowed) { this->swallowed = swallowed; }
@@ -178,27 +137,109 @@ private:
     bool isBeingDragged;
     bool valid = true;
     bool swallowed = false;
-    Mesh mesh;
+    const Mesh* mesh = nullptr;
     bool awake = true;
 };
 
 class SimplePhysics {
 public:
     static const unsigned maxContacts = 5096;
+    // Speculative contacts stop most overlaps before they happen, so the
+    // position pass only has small leftovers to clean up. Each iteration
+    // fixes the deepest contact and rescans them all, so the cap bounds a
+    // step's worst case rather than its usual cost. Whatever is left over
+    // is still penetrating next step, when the contacts are generated
+    // again, and is fixed then.
+    static const unsigned positionIterations = 256;
     std::vector<Box*> boxData;
+    // Boxes and their bodies come from pools, so the bodies the step walks
+    // through sit together in memory and a reset reuses the same slabs
+    static const unsigned boxCount = 500;
+    cyclone::ObjectPool<Box> boxPool{boxCount};
+    cyclone::ObjectPool<cyclone::RigidBody> bodyPool{boxCount};
     cyclone::Contact* contacts;
     cyclone::CollisionData* cData;
     cyclone::ContactResolver* resolver;
-    bool m_drawHitboxes = false;
+    cyclone::CollisionPlane ground;
+
+    // Fast boxes are integrated in several sweeps per step, each checked
+    // against the ground and scenery with these few contacts of their own.
+    static const unsigned maxSweepSteps = 8;
+    static const unsigned maxSweepContacts = 64;
+    cyclone::Contact sweepContacts[maxSweepContacts];
+    cyclone::CollisionData sweepData;
+
+    // Static scenery boxes are owned by the caller. They never move, so their
+    // tree is only rebuilt when one is added or removed. The floors are
+    // covered by the ground plane, so the game has no scenery here yet.
+    std::vector<cyclone::CollisionBox*> staticBoxes;
+    cyclone::AABBTree staticTree;
+    bool staticTreeDirty = false;
+    std::vector<unsigned> candidates;
+
+    // Contiguous copies of the boxes' transforms for the batched ground test
+    std::vector<cyclone::Matrix4> groundTransforms;
+    std::vector<cyclone::Vector3> groundHalfSizes;
+    std::vector<cyclone::RigidBody*> groundBodies;
+
+    // Narrowphase work is shared out in tasks of this many boxes or pairs
+    static const unsigned boxesPerTask = 64;
+    static const unsigned pairsPerTask = 128;
+
+    struct BoxPair {
+        unsigned one;
+        unsigned two;
+    };
+
+    // Where the contacts of one narrowphase task were written
+    struct TaskOutput {
+        unsigned worker;
+        unsigned first;
+        unsigned count;
+    };
+
+    // Scratch space owned by one worker thread
+    struct NarrowphaseWorker {
+        std::vector<cyclone::Contact> contacts;
+        cyclone::CollisionData data;
+        std::vector<unsigned> candidates;
+    };
+
+    cyclone::ThreadPool pool;
+    std::vector<NarrowphaseWorker> workers;
+    std::vector<Box*> active;
+    cyclone::AABBTree dynamicTree;
+    std::vector<std::vector<BoxPair>> taskPairs;
+    std::vector<BoxPair> pairs;
+    std::vector<TaskOutput> taskOutputs;
+
+    // Explosions find the boxes they reach through the dynamic tree
+    cyclone::ExplosionSystem explosions;
+
+    // Box layouts come from one counter-based stream, so every run starts
+    // from the same scene and each reset moves on to the next one
+    static const unsigned long long sceneSeed = 0x5eed;
+    cyclone::CounterRandom sceneRandom{sceneSeed};
+
+    // Set when a box moves or leaves play, until the change is taken
+    bool changed = true;
 
     SimplePhysics() {
         contacts = new cyclone::Contact[maxContacts];
         cData = new cyclone::CollisionData();
         cData->contactArray = contacts;
-        resolver = new cyclone::ContactResolver(maxContacts * 2, maxContacts * 2, 0.001f, 0.001f);
-        // Initialize vector with new Box objects
-        for (int i = 0; i < 500; i++) {
-            boxData.push_back(new Box());
+        sweepData.contactArray = sweepContacts;
+        ground.direction = cyclone::Vector3(0, 1, 0);
+        ground.offset = 0;
+        resolver = new cyclone::ContactResolver(maxContacts * 2, positionIterations, 0.001f, 0.001f);
+        workers.resize(pool.getWorkerCount());
+        for (auto &w: workers) {
+            w.contacts.resize(maxContacts);
+            w.data.contactArray = w.contacts.data();
+        }
+        // Initialize vector with pooled Box objects
+        for (unsigned i = 0; i < boxCount; i++) {
+            boxData.push_back(boxPool.create());
         }
         reset();
     }
@@ -206,7 +247,7 @@ public:
     ~SimplePhysics() {
         // Clean up Box objects
         for (Box* box : boxData) {
-            delete box;
+            boxPool.destroy(box);
         }
         boxData.clear();
         
@@ -216,18 +257,34 @@ public:
     }
 
     void reset();
-    void generateContacts();
+    void generateContacts(cyclone::real duration);
+    void generateBoxContacts(Box* box, cyclone::CollisionData* data);
+    void generateSceneryContacts(Box* box, cyclone::CollisionData* data, std::vector<unsigned>& found) const;
+    void integrateSwept(Box* box, cyclone::real duration);
     void update(cyclone::real duration);
-    void render(int shadow, const GLuint textureID);
 
-    void toggleHitboxes() { m_drawHitboxes = !m_drawHitboxes; }
+    // Copies out every box still in play, for drawing and picking away
+    // from the simulation
+    void snapshot(std::vector<BoxSnapshot>& boxes) const;
 
-    void drawWithNames(const GLuint textureID) {
-        for (int i = 0; i < boxData.size(); i++) {
-            boxData[i]->draw(i + 1, 0, textureID); // Use 1-based indices for picking
-        }
+    // Queues the boxes of a snapshot, drawing their hitboxes straight away
+    // if asked to
+    static void render(RenderQueue& queue, const std::vector<BoxSnapshot>& boxes, const GLuint textureID,
+                       bool hitboxes);
+
+    void addExplosion(const cyclone::Vector3& position);
+
+    // Whether any box has moved, settled or left play since the last
+    // call, so a new snapshot is worth taking
+    bool takeChanges() {
+        const bool wasChanged = changed;
+        changed = false;
+        return wasChanged;
     }
 
+    void addStaticBox(cyclone::CollisionBox* box);
+    void removeStaticBox(cyclone::CollisionBox* box);
+
     Box *getBox(int index) {
         if (boxData.size() > index) {
             return boxData[index];
@@ -252,7 +309,9 @@ public:
     void removeBox(cyclone::RigidBody* body) {
         for (int i = 0; i < boxData.size(); i++) {
             if (boxData[i]->getBody() == body) {
+                bodyPool.destroy(body);
                 boxData[i]->invalidate();
+                changed = true;
                 break;
             }
         }
@@ -262,6 +321,7 @@ public:
         for (int i = 0; i < boxData.size(); i++) {
             if (boxData[i]->getBody() == body) {
                 boxData[i]->setSwallowed(swallowed);
+                changed = true;
                 break;
             }
         }
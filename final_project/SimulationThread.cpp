@@ -0,0 +1,61 @@
+#include "SimulationThread.h"
+
+SimulationThread::SimulationThread(double stepsPerSecond) :
+    stepDuration(static_cast<float>(1.0 / stepsPerSecond)),
+    period(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(1.0 / stepsPerSecond))) {}
+
+SimulationThread::~SimulationThread() {
+    stop();
+}
+
+void SimulationThread::start(std::function<void(float)> step) {
+    stop();
+    this->step = std::move(step);
+    running = true;
+    thread = std::thread(&SimulationThread::run, this);
+}
+
+void SimulationThread::stop() {
+    running = false;
+    if (thread.joinable()) {
+        thread.join();
+    }
+    std::lock_guard<std::mutex> lock(commandMutex);
+    commands.clear();
+}
+
+void SimulationThread::post(std::function<void()> command) {
+    std::lock_guard<std::mutex> lock(commandMutex);
+    commands.push_back(std::move(command));
+}
+
+void SimulationThread::runCommands() {
+    // Swap the queue out, so commands posted while these run wait for the
+    // next step rather than for the lock
+    {
+        std::lock_guard<std::mutex> lock(commandMutex);
+        runningCommands.swap(commands);
+    }
+    for (auto &command: runningCommands) {
+        command();
+    }
+    runningCommands.clear();
+}
+
+void SimulationThread::run() {
+    auto deadline = std::chrono::steady_clock::now();
+    while (running) {
+        runCommands();
+        step(stepDuration);
+
+        deadline += period;
+        const auto now = std::chrono::steady_clock::now();
+        if (now > deadline + period * maxCatchUpSteps) {
+            // Too far behind to catch up: carry on from now
+            deadline = now;
+        } else if (now < deadline) {
+            std::this_thread::sleep_until(deadline);
+        }
+    }
+}
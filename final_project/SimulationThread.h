@@ -0,0 +1,61 @@
+#ifndef SIMULATIONTHREAD_H
+#define SIMULATIONTHREAD_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs a simulation step at a fixed rate on a thread of its own, so the
+// simulation neither waits for the window to draw nor makes it wait.
+//
+// Other threads hand the simulation work through post(). Posted commands
+// run on the simulation thread, in order, before the next step, so
+// anything they touch is only ever used from that thread. The queue's lock
+// is only held to add or take commands, never while a step runs.
+//
+// A step that runs late is caught up with back-to-back steps, up to a
+// limit. After a longer stall the lost time is dropped rather than
+// replayed, so the simulation slows down instead of falling further behind.
+class SimulationThread {
+public:
+    explicit SimulationThread(double stepsPerSecond = 60);
+    ~SimulationThread();
+
+    SimulationThread(const SimulationThread &) = delete;
+    SimulationThread &operator=(const SimulationThread &) = delete;
+
+    // Starts calling step with the fixed step duration, in seconds
+    void start(std::function<void(float)> step);
+
+    // Waits for the step in progress, if any, and stops the thread.
+    // Commands not yet run are dropped.
+    void stop();
+
+    // Queues a command to run on the simulation thread before the next step
+    void post(std::function<void()> command);
+
+    float getStepDuration() const { return stepDuration; }
+
+private:
+    // Steps run back to back to catch up before the lost time is dropped
+    static const unsigned maxCatchUpSteps = 4;
+
+    float stepDuration;
+    std::chrono::steady_clock::duration period;
+
+    std::function<void(float)> step;
+    std::thread thread;
+    std::atomic<bool> running{false};
+
+    std::mutex commandMutex;
+    std::vector<std::function<void()>> commands;
+    std::vector<std::function<void()>> runningCommands;
+
+    void run();
+    void runCommands();
+};
+
+#endif // SIMULATIONTHREAD_H
@@ -0,0 +1,190 @@
+#include "TextRenderer.h"
+#include "3DUtils.h"
+
+#include <FL/glut.H>
+#include <cmath>
+#include <cstddef>
+
+// Scale of the stroke font, in pixels per font unit
+static const float strokeScale = 0.2f;
+
+TextRenderer::~TextRenderer() {
+    if (loaded) {
+        glDeleteTextures(1, &texture);
+        glDeleteVertexArrays(1, &vao);
+        glDeleteBuffers(1, &vertexBuffer);
+    }
+}
+
+void TextRenderer::clear() {
+    vertices.clear();
+}
+
+void TextRenderer::add(const char *text, int x, int y, float r, float g, float b) {
+    if (text == nullptr) {
+        return;
+    }
+
+    Vertex corner;
+    corner.color[0] = static_cast<unsigned char>(r * 255.0f + 0.5f);
+    corner.color[1] = static_cast<unsigned char>(g * 255.0f + 0.5f);
+    corner.color[2] = static_cast<unsigned char>(b * 255.0f + 0.5f);
+    corner.color[3] = 255;
+
+    const float atlasWidth = static_cast<float>(columns * cellWidth);
+    const float atlasHeight = static_cast<float>(rows * cellHeight);
+
+    // Each glyph's cell is placed so its baseline sits where the stroke font
+    // put it, snapped to whole pixels so the atlas texels map one to one
+    float pen = static_cast<float>(x);
+    for (const char *c = text; *c != '\0'; c++) {
+        const int glyph = static_cast<unsigned char>(*c) - firstGlyph;
+        if (glyph < 0 || glyph >= glyphCount) {
+            continue;
+        }
+
+        const float left = std::floor(pen + 0.5f) - margin;
+        const float bottom = static_cast<float>(y);
+        const float u = (glyph % columns) * cellWidth / atlasWidth;
+        const float v = (glyph / columns) * cellHeight / atlasHeight;
+        const float du = cellWidth / atlasWidth;
+        const float dv = cellHeight / atlasHeight;
+
+        const float quad[6][4] = {
+            {left, bottom, u, v},
+            {left + cellWidth, bottom, u + du, v},
+            {left + cellWidth, bottom + cellHeight, u + du, v + dv},
+            {left, bottom, u, v},
+            {left + cellWidth, bottom + cellHeight, u + du, v + dv},
+            {left, bottom + cellHeight, u, v + dv}
+        };
+        for (const auto &point: quad) {
+            corner.x = point[0];
+            corner.y = point[1];
+            corner.u = point[2];
+            corner.v = point[3];
+            vertices.push_back(corner);
+        }
+
+        pen += glutStrokeWidth(GLUT_STROKE_ROMAN, *c) * strokeScale;
+    }
+}
+
+void TextRenderer::load() {
+    loaded = true;
+    const int atlasWidth = columns * cellWidth;
+    const int atlasHeight = rows * cellHeight;
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, atlasWidth, atlasHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // Stroke every glyph into its cell, once, through a framebuffer on the
+    // atlas. The window's framebuffer, viewport and matrices are put back
+    // afterwards.
+    GLint previousFramebuffer = 0;
+    GLint previousViewport[4];
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, previousViewport);
+
+    GLuint framebuffer;
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+    glViewport(0, 0, atlasWidth, atlasHeight);
+    glClearColor(0, 0, 0, 0);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    double projection[16];
+    orthoMatrix(projection, 0, atlasWidth, 0, atlasHeight, -1, 1);
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadMatrixd(projection);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+
+    glPushAttrib(GL_ENABLE_BIT | GL_CURRENT_BIT);
+    glDisable(GL_LIGHTING);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_TEXTURE_2D);
+    glDisable(GL_BLEND);
+    glColor4f(1, 1, 1, 1);
+    for (int glyph = 0; glyph < glyphCount; glyph++) {
+        glLoadIdentity();
+        glTranslatef(static_cast<float>((glyph % columns) * cellWidth + margin),
+                     static_cast<float>((glyph / columns) * cellHeight + baseline), 0);
+        glScalef(strokeScale, strokeScale, strokeScale);
+        glutStrokeCharacter(GLUT_STROKE_ROMAN, firstGlyph + glyph);
+    }
+    glPopAttrib();
+
+    glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+    glDeleteFramebuffers(1, &framebuffer);
+    glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+
+    // Quads come from one streamed buffer, through fixed-function arrays
+    glGenBuffers(1, &vertexBuffer);
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(2, GL_FLOAT, sizeof(Vertex), reinterpret_cast<const void *>(offsetof(Vertex, x)));
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), reinterpret_cast<const void *>(offsetof(Vertex, u)));
+    glEnableClientState(GL_COLOR_ARRAY);
+    glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), reinterpret_cast<const void *>(offsetof(Vertex, color)));
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void TextRenderer::draw(int width, int height) {
+    if (vertices.empty()) {
+        return;
+    }
+    if (!loaded) {
+        load();
+    }
+
+    // Orphan last frame's text, growing the buffer when there is more
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    if (vertices.size() > vertexCapacity) {
+        vertexCapacity = vertices.size() * 2;
+    }
+    glBufferData(GL_ARRAY_BUFFER, vertexCapacity * sizeof(Vertex), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(Vertex), vertices.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    double projection[16];
+    orthoMatrix(projection, 0, width, 0, height, -1, 1);
+    glMatrixMode(GL_PROJECTION);
+    glLoadMatrixd(projection);
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+
+    glDisable(GL_LIGHTING);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+
+    glBindVertexArray(vao);
+    glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(vertices.size()));
+    glBindVertexArray(0);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glDisable(GL_TEXTURE_2D);
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_LIGHTING);
+}
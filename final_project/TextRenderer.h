@@ -0,0 +1,63 @@
+#ifndef TEXTRENDERER_H
+#define TEXTRENDERER_H
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <vector>
+
+// Draws heads-up display text from a glyph atlas. Strings are queued through
+// the frame and drawn together at the end, as textured quads from one vertex
+// buffer in a single draw call.
+//
+// The atlas is made from the GLUT Roman stroke font, rasterized once at the
+// size the HUD has always used, so the text looks as it did when each
+// string was stroked line by line.
+class TextRenderer {
+public:
+    TextRenderer() = default;
+    ~TextRenderer();
+
+    TextRenderer(const TextRenderer &) = delete;
+    TextRenderer &operator=(const TextRenderer &) = delete;
+
+    // Empties the queue for a new frame
+    void clear();
+
+    // Queues a string starting at (x, y), in pixels from the bottom left of
+    // the window. Its baseline is a little above y, leaving room for
+    // descenders.
+    void add(const char *text, int x, int y, float r, float g, float b);
+
+    // Draws the queued text over a window of the given size, building the
+    // atlas first if needed
+    void draw(int width, int height);
+
+private:
+    // Printable ASCII, laid out in a grid of cells
+    static const int firstGlyph = 32;
+    static const int glyphCount = 95;
+    static const int columns = 16;
+    static const int rows = 6;
+    static const int cellWidth = 24;
+    static const int cellHeight = 32;
+    static const int baseline = 8; // Pixels below the baseline in each cell
+    static const int margin = 2; // Pixels left of each glyph's origin in its cell
+
+    struct Vertex {
+        float x, y;
+        float u, v;
+        unsigned char color[4];
+    };
+
+    GLuint texture = 0;
+    GLuint vao = 0;
+    GLuint vertexBuffer = 0;
+    size_t vertexCapacity = 0;
+    bool loaded = false;
+
+    std::vector<Vertex> vertices;
+
+    void load();
+};
+
+#endif // TEXTRENDERER_H
@@ -0,0 +1,64 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <atomic>
+
+// Hands values from one writer thread to one reader thread without locks.
+// The writer fills the back slot and publishes it; the reader takes the
+// most recently published slot whenever it likes. Neither ever waits for
+// the other: a third slot sits between them, swapped atomically, so the
+// writer can always start on a new value while the reader holds its last.
+//
+// A published value belongs to the reader until it takes a newer one, so
+// it can be read for as long as needed without being copied. Values the
+// reader never takes are overwritten. The writer gets slots back holding
+// old values, and must fill them completely.
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() = default;
+
+    TripleBuffer(const TripleBuffer &) = delete;
+    TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+    // The slot the writer fills next. Only the writer may use it.
+    T &back() { return slots[backIndex]; }
+
+    // Hands the back slot to the reader, taking the middle slot in exchange
+    void publish() {
+        const unsigned previous = middle.exchange(backIndex | freshBit, std::memory_order_acq_rel);
+        backIndex = previous & indexMask;
+    }
+
+    // Whether a slot has been published since the reader last took one
+    bool hasUpdate() const { return (middle.load(std::memory_order_acquire) & freshBit) != 0; }
+
+    // Takes the most recently published slot, if the reader hasn't already.
+    // Returns whether the front slot changed.
+    bool update() {
+        if (!(middle.load(std::memory_order_acquire) & freshBit)) {
+            return false;
+        }
+        // Only the reader clears the fresh bit, so it is still set here,
+        // although the writer may have published again since the check
+        const unsigned previous = middle.exchange(frontIndex, std::memory_order_acq_rel);
+        frontIndex = previous & indexMask;
+        return true;
+    }
+
+    // The slot the reader took last. Only the reader may use it.
+    const T &front() const { return slots[frontIndex]; }
+
+private:
+    // The middle slot's index, with a bit set while it holds a value the
+    // reader hasn't taken
+    static const unsigned indexMask = 3;
+    static const unsigned freshBit = 4;
+
+    T slots[3];
+    unsigned backIndex = 0;
+    std::atomic<unsigned> middle{1};
+    unsigned frontIndex = 2;
+};
+
+#endif // TRIPLEBUFFER_H
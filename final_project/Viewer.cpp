@@ -15,7 +15,7 @@ Viewer::Viewer(const glm::vec3 &viewPoint, const glm::vec3 &viewCenter, const gl
                float aspectRatio) :
     m_viewPoint(viewPoint), m_viewCenter(viewCenter), m_upVector(upVector), m_fieldOfView(fieldOfView),
     m_aspectRatio(aspectRatio), m_translateSpeed(DEFAULT_TRANSLATE_SPEED), m_zoomFraction(DEFAULT_ZOOM_FRACTION),
-    m_rotateSpeed(DEFAULT_ROTATE_SPEED) {
+    m_rotateSpeed(DEFAULT_ROTATE_SPEED), m_changed(true) {
     m_upVector = glm::normalize(m_upVector);
 
     getFrustrumInfo();
@@ -36,6 +36,7 @@ void Viewer::translate(float changeHoriz, float changeVert, bool inImagePlane) {
     translateVec *= m_translateSpeed;
     m_viewPoint += translateVec;
     m_viewCenter += translateVec; // Ensure the camera's focus moves with it
+    m_changed = true;
 }
 
 void Viewer::zoom(float changeVert) {
@@ -162,6 +163,9 @@ double Convert(double degree) {
 
 
 void Viewer::getFrustrumInfo() {
+    // Everything that changes the view comes through here, bar translate
+    m_changed = true;
+
     // Get the viewing direction
 
     m_viewDir = m_viewCenter - m_viewPoint;
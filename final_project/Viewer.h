@@ -126,6 +126,11 @@ public:
     /** Set up the roation speed */
     void setRotateSpeed(float rotateSpeed);
 
+    /** Whether the view has changed since clearChanged, and needs drawing again */
+    bool hasChanged() const { return m_changed; }
+    /** Marks the view as drawn */
+    void clearChanged() { m_changed = false; }
+
 private:
     glm::vec3 m_viewPoint;
     glm::vec3 m_viewCenter;
@@ -152,6 +157,9 @@ private:
     float m_displayWidth;
     float m_displayHeight;
 
+    /** Set by anything that moves the view, until it is drawn */
+    bool m_changed;
+
     /** These are used for tracking */
 
     float m_lastDesired[3];
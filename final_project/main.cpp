@@ -28,9 +28,6 @@
 
 #include "MyGlWindow.h"
 
-long lastRedraw;
-int frameRate = 60;
-
 Fl_Group *widgets;
 Fl_Light_Button *run_btn;
 
@@ -38,21 +35,36 @@ void changeFrameCB(Fl_Widget *w, void *data) {
     const Fl_Choice *widget = static_cast<Fl_Choice *>(w);
     int i = widget->value();
     const char *menu = widget->text(i);
-    frameRate = atoi(menu);
 
     MyGlWindow *win = static_cast<MyGlWindow *>(data);
+    win->getFramePacer().setFrameRate(atoi(menu));
     win->redraw();
     win->take_focus();
 }
 
-void idleCB(void *w) {
-    MyGlWindow *win = static_cast<MyGlWindow *>(w);
-    if (clock() - lastRedraw > CLOCKS_PER_SEC / frameRate) {
-        lastRedraw = clock();
-        win->update();
+// Draws a frame on each of the pacer's deadlines, handling events in
+// between. The game steps on its own thread, so the frame rate only paces
+// drawing. While there is time to spare the loop sleeps in Fl::wait, which
+// wakes early for events, and the pacer only spins the last moment.
+// Deadlines with nothing new to show are let pass without spinning or
+// drawing, so a paused or idle game leaves the CPU and GPU alone.
+void runFrames(Fl_Window *wind, MyGlWindow *win) {
+    FramePacer &pacer = win->getFramePacer();
+    while (wind->shown()) {
+        const double sleepSeconds = pacer.getSecondsToSleep();
+        if (sleepSeconds > 0) {
+            Fl::wait(sleepSeconds);
+            continue;
+        }
+        if (!win->needsFrame()) {
+            pacer.skipFrame();
+            continue;
+        }
+        pacer.waitForFrame();
+        win->redraw();
+        win->take_focus();
+        Fl::flush();
     }
-    win->redraw();
-    win->take_focus();
 }
 
 void runGame(Fl_Widget *o, void *data) {
@@ -80,6 +92,13 @@ void toggleHitboxCB(Fl_Widget *o, void *data) {
     win->take_focus();
 }
 
+void toggleRendererCB(Fl_Widget *o, void *data) {
+    MyGlWindow *win = static_cast<MyGlWindow *>(data);
+    win->toggleRenderer();
+    win->damage(1);
+    win->take_focus();
+}
+
 int main() {
     // plastic
     Fl::scheme("plastic");
@@ -94,7 +113,6 @@ int main() {
     widgets->begin();
 
     MyGlWindow *gl = new MyGlWindow(10, 10, width - 20, height - 50);
-    Fl::add_idle((void (*)(void *)) idleCB, gl); //
 
     widgets->end();
     Fl_Group::current()->resizable(widgets);
@@ -124,12 +142,15 @@ int main() {
     Fl_Button *hitboxButton = new Fl_Button(width - buttonWidth * 2 - 40, height - 40, buttonWidth, buttonHeight, "Toggle Hitbox");
     hitboxButton->callback(toggleHitboxCB, gl);
 
+    Fl_Button *rendererButton = new Fl_Button(width - buttonWidth * 3 - 60, height - 40, buttonWidth, buttonHeight, "Toggle Renderer");
+    rendererButton->callback(toggleRendererCB, gl);
+
     wind->end();
 
     // this actually opens the window
     wind->show();
 
-    Fl::run();
+    runFrames(wind, gl);
     delete wind;
 
     return 1;
@@ -10,106 +10,25 @@
  * software licence.
  */
 
-#define NOMINMAX
-
 #include "timing.h"
 
-#if defined(_WIN32) || defined(_WIN64)
-#include <windows.h>
-#endif
-
-#define rdtsc(x) {__asm __emit 0fh __asm __emit 031h __asm mov x, eax}
-#define rdtscEx(low, high) {__asm __emit 0fh __asm __emit 031h __asm mov low, eax _asm mov high, edx}
-#define cpuid {__asm __emit 0fh __asm __emit 0a2h}
-
-
-#pragma comment(lib, "winmm.lib")
-
-
-// Hold internal timing data for the performance counter.
-static bool qpcFlag;
-
-#if (__APPLE__ || __unix)
-#define TIMING_UNIX 1
-
-#include <stdlib.h>
-#include <sys/time.h>
-
-// assume unix based OS
-typedef unsigned long long LONGLONG;
-#else
-#define TIMING_WINDOWS 1
-// assume windows
-
-// Import the high performance timer (c. 4ms).
-#include <mmsystem.h>
-#include <windows.h>
-
-static double qpcFrequency;
-#endif
+#include <chrono>
 
+// Both the time and the clock come from the monotonic clock: the wall
+// clock can be stepped by the system, and the process clock only counts
+// CPU time, which stops while the process sleeps.
+typedef std::chrono::steady_clock TimingClock;
 
 // Internal time and clock access functions
-unsigned systemTime() {
-#if TIMING_UNIX
-    struct timeval tv;
-    gettimeofday(&tv, 0);
-
-    return tv.tv_sec * 1000 + tv.tv_usec / 1000;
-#else
-
-    if (qpcFlag) {
-        static LONGLONG qpcMillisPerTick;
-        QueryPerformanceCounter((LARGE_INTEGER *) &qpcMillisPerTick);
-        return (unsigned) (qpcMillisPerTick * qpcFrequency);
-    } else {
-        return unsigned(timeGetTime());
-    }
-
-    return 1;
-#endif
-}
-
-unsigned TimingData::getTime() { return systemTime(); }
-
-#if TIMING_WINDOWS
-unsigned long systemClock() {
-    unsigned __int64 i;
-    i = __rdtsc();
-
-    /*__asm {
-        rdtsc;
-    }
-    */
-    return i;
+static unsigned long long systemTime() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            TimingClock::now().time_since_epoch()).count();
 }
-#endif
 
-unsigned long TimingData::getClock() {
-#if TIMING_UNIX
-    struct timeval tv;
-    gettimeofday(&tv, 0);
+unsigned long long TimingData::getTime() { return systemTime(); }
 
-    return tv.tv_sec * 1000 + tv.tv_usec / 1000;
-#else
-    return systemClock();
-#endif
-}
-
-// Sets up the timing system and registers the performance timer.
-void initTime() {
-#if TIMING_UNIX
-    qpcFlag = false;
-#else
-    LONGLONG time;
-
-    qpcFlag = (QueryPerformanceFrequency((LARGE_INTEGER *) &time) > 0);
-
-    // Check if we have access to the performance counter at this
-    // resolution.
-    if (qpcFlag)
-        qpcFrequency = 1000.0 / time;
-#endif
+unsigned long long TimingData::getClock() {
+    return TimingClock::now().time_since_epoch().count();
 }
 
 // Holds the global frame time that is passed around
@@ -128,12 +47,12 @@ void TimingData::update() {
         timingData->frameNumber++;
 
     // Update the timing information.
-    unsigned thisTime = systemTime();
+    unsigned long long thisTime = systemTime();
     timingData->lastFrameDuration = thisTime - timingData->lastFrameTimestamp;
     timingData->lastFrameTimestamp = thisTime;
 
     // Update the tick information.
-    unsigned long thisClock = getClock();
+    unsigned long long thisClock = getClock();
     timingData->lastFrameClockTicks = thisClock - timingData->lastFrameClockstamp;
     timingData->lastFrameClockstamp = thisClock;
 
@@ -147,15 +66,12 @@ void TimingData::update() {
             timingData->averageFrameDuration += 0.01 * (double) timingData->lastFrameDuration;
 
             // Invert to get FPS
-            timingData->fps = (float) (1000.0 / timingData->averageFrameDuration);
+            timingData->fps = (float) (1000000.0 / timingData->averageFrameDuration);
         }
     }
 }
 
 void TimingData::init() {
-    // Set up the timing system.
-    initTime();
-
     // Create the frame info object
     if (!timingData)
         timingData = new TimingData();
@@ -31,24 +31,24 @@ struct TimingData {
 
     /**
      * The timestamp when the last frame ended. Times are
-     * given in milliseconds since some undefined time.
+     * given in microseconds since some undefined time.
      */
-    unsigned lastFrameTimestamp;
+    unsigned long long lastFrameTimestamp;
 
     /**
-     * The duration of the last frame in milliseconds.
+     * The duration of the last frame in microseconds.
      */
-    unsigned lastFrameDuration;
+    unsigned long long lastFrameDuration;
 
     /**
      * The clockstamp of the end of the last frame.
      */
-    unsigned long lastFrameClockstamp;
+    unsigned long long lastFrameClockstamp;
 
     /**
      * The duration of the last frame in clock ticks.
      */
-    unsigned long lastFrameClockTicks;
+    unsigned long long lastFrameClockTicks;
 
     /**
      * Keeps track of whether the rendering is paused.
@@ -59,7 +59,7 @@ struct TimingData {
 
     /**
      * This is a recency weighted average of the frame time, calculated
-     * from frame durations.
+     * from frame durations, in microseconds.
      */
     double averageFrameDuration;
 
@@ -91,15 +91,15 @@ struct TimingData {
     static void deinit();
 
     /**
-     * Gets the global system time, in the best resolution possible.
-     * Timing is in milliseconds.
+     * Gets the global system time from a monotonic clock, so it never
+     * jumps when the wall clock is adjusted. Timing is in microseconds.
      */
-    static unsigned getTime();
+    static unsigned long long getTime();
 
     /**
-     * Gets the clock ticks since process start.
+     * Gets the ticks of the monotonic clock, at its native resolution.
      */
-    static unsigned long getClock();
+    static unsigned long long getClock();
 
 
 private: